@@ -30,6 +30,8 @@ setlocal
 	
 	if NOT DEFINED debug 			set debug=0
 	if NOT DEFINED debug_coverage	set debug_coverage=0
+	if NOT DEFINED stats			set stats=0
+	if NOT DEFINED trace			set trace=0
 	
 	
 	@REM --------------------------------------------------------------------
@@ -50,6 +52,11 @@ setlocal
 		if %debug_coverage% EQU 1 set attrib=%attrib% -coverage
 	)
 	
+	@REM 1 builds in per binding call counters, see al.stats()
+	if %stats% EQU 1 set attrib=%attrib% -DOPENLUAL_STATS
+	@REM 1 builds in call tracing, see al.trace() and res/replay.lua
+	if %trace% EQU 1 set attrib=%attrib% -DOPENLUAL_TRACE
+	
 	set objdir=obj
 	set libdir=lib
 	set resdir=res
@@ -70,7 +77,7 @@ setlocal
 	
 	
 	echo Compiling...
-	gcc %attrib% %dirs% -D__USE_MINGW_ANSI_STDIO=1 -c %srcdir%\*.c
+	gcc %attrib% %dirs% -D__USE_MINGW_ANSI_STDIO=1 -pthread -c %srcdir%\*.c
 	if %errorlevel% NEQ 0 (
 		set error=1
 		goto error
@@ -78,7 +85,7 @@ setlocal
 	
 	
 	echo Linking...
-	gcc %attrib% %dirs% -shared -o libopenlual.dll *.o %libs% %dlldir%\*.dll
+	gcc %attrib% %dirs% -pthread -shared -o libopenlual.dll *.o %libs% %dlldir%\*.dll
 	if %errorlevel% NEQ 0 (
 		set error=1
 		goto error
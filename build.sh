@@ -28,6 +28,8 @@
 
 debug=0
 debug_coverage=0
+stats=0 # 1 builds in per binding call counters, see al.stats()
+trace=0 # 1 builds in call tracing, see al.trace() and res/replay.lua
 
 
 # --------------------------------------------------------------------
@@ -51,6 +53,13 @@ else
 	fi
 fi
 
+if [ $stats -eq 1 ]; then
+	attrib="$attrib -DOPENLUAL_STATS"
+fi
+if [ $trace -eq 1 ]; then
+	attrib="$attrib -DOPENLUAL_TRACE"
+fi
+
 
 objdir=obj
 libdir=lib
@@ -73,14 +82,14 @@ mkdir -p $root/res
 # --------------------------------------------------------------------
 
 echo Compiling...
-gcc $attrib $dirs -fPIC -c $srcdir/*.c
+gcc $attrib $dirs -fPIC -pthread -c $srcdir/*.c
 if [ $? -ne 0 ]; then 
 	mv *.o		$objdir		1>/dev/null	2>/dev/null
 	exit 1;
 fi
 
 echo Linking...
-gcc $attrib $dirs -fPIC -shared -Wl,-E -o libopenlual.so *.o $dlldir/*.so
+gcc $attrib $dirs -fPIC -pthread -shared -Wl,-E -o libopenlual.so *.o $dlldir/*.so -lm
 if [ $? -ne 0 ]; then
 	mv *.so		$root		1>/dev/null	2>/dev/null
 	mv *.o		$objdir		1>/dev/null	2>/dev/null
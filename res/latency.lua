@@ -0,0 +1,128 @@
+--[[
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-- Measures output latency through AL_SOFT_source_latency across device
+-- refresh rates and mixing frequencies.
+-- usage: lua latency.lua [device] [readings]
+-- Each setting opens a fresh device and context, plays a looping silent
+-- buffer and reads the latency the driver reports while it plays. With
+-- OpenAL Soft, ALSOFT_DRIVERS=null measures the mixer alone.
+
+local al = require("libopenlual")
+
+local name = arg[1]
+if(name == "default")then
+	name = nil
+end
+local readings = tonumber(arg[2]) or 200
+
+local refreshes = {25, 50, 100, 200}
+local frequencies = {44100, 48000}
+
+-- spins on the wall clock, os.clock would also count the mixer thread
+local function wait(seconds)
+	local deadline = al.clock() + seconds * 1e9
+	while(al.clock() < deadline)do end
+end
+
+local function percentile(sorted, p)
+	return sorted[math.max(1, math.ceil(#sorted * p))]
+end
+
+local function measure(frequency, refresh)
+	local device = al.alcOpenDevice(name)
+	local context = al.alcCreateContext(device, {al.ALC_FREQUENCY, frequency, al.ALC_REFRESH, refresh})
+	if(al.alcGetError(device) ~= al.ALC_NO_ERROR or not al.alcMakeContextCurrent(context))then
+		al.alcDestroyContext(context)
+		al.alcCloseDevice(device)
+		return nil
+	end
+	
+	-- what the device actually settled on
+	local got_frequency = al.alcGetIntegerv(device, al.ALC_FREQUENCY, 1)[1]
+	local got_refresh = al.alcGetIntegerv(device, al.ALC_REFRESH, 1)[1]
+	
+	local buffer = al.alGenBuffers(1, "latency")
+	local source = al.alGenSources(1, "latency")
+	local silence = string.rep("\0", frequency * 2)
+	al.alBufferData(buffer[1], al.AL_FORMAT_MONO16, silence, #silence, frequency)
+	al.alSourcei(source[1], al.AL_BUFFER, buffer[1])
+	al.alSourcei(source[1], al.AL_LOOPING, al.AL_TRUE)
+	
+	-- time from the play call until the offset first moves
+	local started = al.clock()
+	al.alSourcePlay(source[1])
+	local startup = nil
+	while(al.clock() - started < 1e9)do
+		local offset = al.alGetSourcedvSOFT(source[1], al.AL_SEC_OFFSET_LATENCY_SOFT)
+		if(offset == nil)then
+			break
+		end
+		if(offset > 0)then
+			startup = (al.clock() - started) / 1e9
+			break
+		end
+	end
+	
+	local latencies = {}
+	for i = 1, readings do
+		local _, latency = al.alGetSourcedvSOFT(source[1], al.AL_SEC_OFFSET_LATENCY_SOFT)
+		if(latency == nil)then
+			break
+		end
+		latencies[#latencies + 1] = latency * 1000
+		wait(0.002)
+	end
+	
+	al.alSourceStop(source[1])
+	al.alDeleteSources(1, source)
+	al.alDeleteBuffers(1, buffer)
+	al.alcMakeContextCurrent(nil)
+	al.alcDestroyContext(context)
+	al.alcCloseDevice(device)
+	
+	table.sort(latencies)
+	return {
+		frequency = got_frequency, refresh = got_refresh, startup = startup,
+		latencies = latencies
+	}
+end
+
+print(string.format("%8s %8s | %8s %8s | %8s %8s %8s %8s", "freq", "refresh", "got", "got", "min ms", "median", "p95", "max"))
+for _, frequency in ipairs(frequencies) do
+	for _, refresh in ipairs(refreshes) do
+		local r = measure(frequency, refresh)
+		if(r == nil)then
+			print(string.format("%8d %8d | could not open a context", frequency, refresh))
+		elseif(#r.latencies == 0)then
+			print("The device does not have AL_SOFT_source_latency.")
+			os.exit(1)
+		else
+			local l = r.latencies
+			print(string.format("%8d %8d | %8d %8d | %8.2f %8.2f %8.2f %8.2f   startup %s",
+				frequency, refresh, r.frequency, r.refresh,
+				l[1], percentile(l, 0.5), percentile(l, 0.95), l[#l],
+				r.startup and string.format("%.2f ms", r.startup * 1000) or "-"))
+		end
+	end
+end
@@ -0,0 +1,49 @@
+--[[
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+--]]
+
+-- Packs wave files into a single memory mappable bank.
+-- usage: lua packbank.lua out.bank a.wav b.wav ...
+-- Each sound is named by the path given on the command line.
+
+local openlual = require("libopenlual")
+
+local out = arg[1]
+if(out == nil or arg[2] == nil)then
+	print("usage: lua packbank.lua out.bank a.wav b.wav ...")
+	os.exit(1)
+end
+
+local files = {}
+for i = 2, #arg do
+	files[#files + 1] = arg[i]
+end
+
+print("Packing " .. #files .. " files into " .. out .. "...")
+
+if(not openlual.packbank(out, files))then
+	print("Packing failed.")
+	os.exit(1)
+end
+
+print("Done.")
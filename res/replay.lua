@@ -0,0 +1,144 @@
+--[[
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+--]]
+
+-- Replays a trace written by a build with trace=1 (see al.trace).
+-- usage: lua replay.lua app.trace [device] [realtime]
+-- Source, buffer, device and context names handed out during the recording
+-- are mapped to the ones handed out now, so the calls line up even when the
+-- driver numbers them differently. realtime keeps the recorded timing,
+-- otherwise calls go through as fast as they can.
+
+local openlual = require("libopenlual")
+local unpack = table.unpack or unpack
+
+local path = arg[1]
+if(path == nil)then
+	print("usage: lua replay.lua app.trace [device] [realtime]")
+	os.exit(1)
+end
+local device = arg[2]
+if(device == "default")then
+	device = nil
+end
+
+if(openlual.readtrace == nil)then
+	print("This build has no tracing, build it with trace=1.")
+	os.exit(1)
+end
+local calls = openlual.readtrace(path, {realtime = (arg[3] == "realtime")})
+if(calls == nil)then
+	print("Could not read " .. path .. ".")
+	os.exit(1)
+end
+
+local AL_BUFFER = 0x1009
+
+local sources = {}
+local buffers = {}
+local handles = {}
+
+local function map(names, id)
+	if(type(id) ~= "number" or id == 0)then
+		return id
+	end
+	return names[id] or id
+end
+
+local function maplist(names, list)
+	if(type(list) ~= "table")then
+		return list
+	end
+	local out = {}
+	for i = 1, #list do
+		out[i] = map(names, list[i])
+	end
+	return out
+end
+
+-- ties what the recording got back to what the replay got back
+local function learn(names, recorded, live)
+	if(type(recorded) == "table" and type(live) == "table")then
+		for i = 1, #recorded do
+			names[recorded[i]] = live[i]
+		end
+	end
+end
+
+local function fixup(name, args)
+	-- devices and contexts
+	for i = 1, args.n do
+		local v = args[i]
+		if(type(v) == "table" and v.handle ~= nil)then
+			args[i] = handles[v.handle]
+		end
+	end
+	if(name == "alcOpenDevice" and device ~= nil)then
+		args[1] = device
+	end
+
+	-- sources and buffers
+	if(name == "alDeleteSources")then
+		args[2] = maplist(sources, args[2])
+	elseif(name == "alDeleteBuffers")then
+		args[2] = maplist(buffers, args[2])
+	elseif(name == "alSourceQueueBuffers" or name == "alSourceUnqueueBuffers")then
+		args[1] = map(sources, args[1])
+		args[2] = type(args[2]) == "table" and maplist(buffers, args[2]) or args[2]
+		args[3] = maplist(buffers, args[3])
+	elseif(name:find("^alG?e?t?Source") or name == "alIsSource")then
+		args[1] = map(sources, args[1])
+		if((name == "alSourcei" or name == "alSource3i") and args[2] == AL_BUFFER)then
+			args[3] = map(buffers, args[3])
+		end
+	elseif(name:find("^alG?e?t?Buffer") or name == "alIsBuffer")then
+		args[1] = map(buffers, args[1])
+	end
+end
+
+local count = 0
+local failed = 0
+local last = 0
+for name, time, args, results in calls do
+	local f = openlual[name]
+	if(f == nil)then
+		failed = failed + 1
+	else
+		fixup(name, args)
+		local live = {f(unpack(args, 1, args.n))}
+		if(name == "alGenSources")then
+			learn(sources, results[1], live[1])
+		elseif(name == "alGenBuffers")then
+			learn(buffers, results[1], live[1])
+		elseif(type(results[1]) == "table" and results[1].handle ~= nil)then
+			handles[results[1].handle] = live[1]
+		end
+	end
+	count = count + 1
+	last = time
+end
+
+print(string.format("Replayed %d calls covering %.3f seconds.", count, last))
+if(failed > 0)then
+	print(failed .. " calls are not bound in this build and were skipped.")
+end
@@ -0,0 +1,223 @@
+--[[
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-- Soaks the library under source and buffer churn, queued streams and
+-- capture polling, reporting as it goes.
+-- usage: lua stress.lua [seconds] [streams] [capture device | none]
+-- Run it headless against OpenAL Soft's null backend with
+-- ALSOFT_DRIVERS=null. Every report prints the operations per second and
+-- the p99 time of each kind of operation, the resident memory and its
+-- growth since the start, and the sources and buffers alive beyond what
+-- the running streams hold, which should stay at zero.
+-- Operation times are wall clock spans from al.clock; a build with stats=1
+-- also prints the per binding histograms at the end.
+
+local al = require("libopenlual")
+
+local seconds = tonumber(arg[1]) or 60
+local stream_count = tonumber(arg[2]) or 16
+local capture_name = arg[3]
+local report_every = 5
+
+local churn_sources = 32 -- per round, well under the usual 256 source limit
+local churn_buffers = 64
+local buffer_bytes = 4096
+
+local patch = {
+	{wave = "saw", frequency = 220, frequency_end = 880, length = 2},
+	{wave = "sine", frequency = 330, fm_ratio = 2, fm_index = 3, length = 2}
+}
+
+local function rss_kb()
+	local f = io.open("/proc/self/status", "r")
+	if(f == nil)then
+		return nil
+	end
+	local text = f:read("*a")
+	f:close()
+	return tonumber(text:match("VmRSS:%s*(%d+)"))
+end
+
+-- per kind of operation: count and the times of the last report period
+local ops = {}
+local function timed(kind, f, ...)
+	local op = ops[kind]
+	if(op == nil)then
+		op = {count = 0, total = 0, times = {}}
+		ops[kind] = op
+	end
+	local start = al.clock()
+	local a, b = f(...)
+	op.times[#op.times + 1] = al.clock() - start
+	op.count = op.count + 1
+	op.total = op.total + 1
+	return a, b
+end
+
+local function p99(times)
+	table.sort(times)
+	return times[math.max(1, math.ceil(#times * 0.99))] or 0
+end
+
+
+print("Setting up context...")
+
+local device = al.alcOpenDevice(nil)
+local context = al.alcCreateContext(device, nil)
+if(not al.alcMakeContextCurrent(context))then
+	print("Could not make a context current.")
+	os.exit(1)
+end
+
+local payload = string.rep("\0", buffer_bytes)
+
+-- streams keep their sources for the whole run and are reopened as they end
+local streams = {}
+local stream_sources = al.alGenSources(stream_count, "stress streams")
+local function open_stream(i)
+	local s = al.synthstream(stream_sources[i], patch, {buffers = 4, buffer_frames = 1024})
+	if(s ~= nil)then
+		al.alSourcePlay(stream_sources[i])
+	end
+	streams[i] = s
+end
+for i = 1, stream_count do
+	open_stream(i)
+end
+
+local capture = nil
+if(capture_name ~= "none")then
+	capture = al.capturesession(capture_name, 16000, al.AL_FORMAT_MONO16, 4096, {spectrum = 512})
+	if(capture ~= nil)then
+		capture:start()
+	else
+		print("No capture device, capture is left out.")
+	end
+end
+
+local base = al.resources()
+local base_rss = rss_kb()
+local started = al.clock()
+local last_report = started
+local rounds = 0
+
+print(string.format("%6s %-10s %10s %10s   %s", "time", "op", "ops/s", "p99 ms", "memory"))
+
+while(al.clock() - started < seconds * 1e9)do
+	
+	-- sources made, bound, played and thrown away
+	local sources = timed("gensrc", al.alGenSources, churn_sources, "stress churn")
+	local buffers = timed("genbuf", al.alGenBuffers, churn_buffers, "stress churn")
+	for i = 1, #buffers do
+		timed("upload", al.alBufferData, buffers[i], al.AL_FORMAT_MONO16, payload, buffer_bytes, 44100)
+	end
+	for i = 1, #sources do
+		al.alSourcei(sources[i], al.AL_BUFFER, buffers[(i - 1) % #buffers + 1])
+		timed("play", al.alSourcePlay, sources[i])
+		al.alSourceStop(sources[i])
+		al.alSourcei(sources[i], al.AL_BUFFER, 0)
+	end
+	timed("delsrc", al.alDeleteSources, #sources, sources)
+	timed("delbuf", al.alDeleteBuffers, #buffers, buffers)
+	
+	for i = 1, stream_count do
+		if(streams[i] == nil or not timed("stream", al.updatestream, streams[i]))then
+			if(streams[i] ~= nil)then
+				timed("close", al.closestream, streams[i])
+			end
+			open_stream(i)
+		end
+	end
+	
+	if(capture ~= nil)then
+		timed("capture", capture.poll, capture)
+	end
+	
+	rounds = rounds + 1
+	local now = al.clock()
+	if(now - last_report >= report_every * 1e9)then
+		local span = (now - last_report) / 1e9
+		local elapsed = (now - started) / 1e9
+		local live = al.resources()
+		local rss = rss_kb()
+		local memory = "-"
+		if(rss ~= nil and base_rss ~= nil)then
+			memory = string.format("%.1f MB (%+.1f)", rss / 1024, (rss - base_rss) / 1024)
+		end
+		local kinds = {}
+		for kind in pairs(ops) do
+			kinds[#kinds + 1] = kind
+		end
+		table.sort(kinds)
+		for i, kind in ipairs(kinds) do
+			local op = ops[kind]
+			print(string.format("%6.0f %-10s %10.0f %10.3f   %s", elapsed, kind,
+				op.count / span, p99(op.times) / 1e6, i == 1 and memory or ""))
+			op.count = 0
+			op.times = {}
+		end
+		print(string.format("%6.0f leaked %d sources, %d buffers (%d bytes)", elapsed,
+			live.sources - base.sources, live.buffers - base.buffers, live.bytes - base.bytes))
+		last_report = now
+	end
+end
+
+
+print("Shutting down...")
+
+for i = 1, stream_count do
+	if(streams[i] ~= nil)then
+		al.closestream(streams[i])
+	end
+end
+al.alDeleteSources(stream_count, stream_sources)
+if(capture ~= nil)then
+	capture:close()
+end
+
+local live = al.resources(true)
+print(string.format("%d rounds, %d sources and %d buffers left alive", rounds, live.sources, live.buffers))
+for _, object in ipairs(live.objects) do
+	print("", object.kind, object.name, object.bytes or "", object.tag or "untagged")
+end
+
+if(al.stats ~= nil)then
+	print("Per binding timings:")
+	for name, s in pairs(al.stats()) do
+		-- the bucket holding the 99th percentile call, as its upper bound
+		local seen, bound = 0, 0
+		for b = 1, #s.histogram do
+			seen = seen + s.histogram[b]
+			if(seen >= s.calls * 0.99)then
+				bound = 2 ^ b
+				break
+			end
+		end
+		print(string.format("  %-24s %10d calls %10.3f ms total, p99 under %.3f ms",
+			name, s.calls, s.time * 1000, bound / 1e6))
+	end
+end
+
+al.alcMakeContextCurrent(nil)
+al.alcDestroyContext(context)
+al.alcCloseDevice(device)
@@ -46,13 +46,15 @@ for i, v in next, wd do
 end
 
 
-local fmt = wd.channels == 1
-	and (wd.bps == 8 and al.AL_FORMAT_MONO8 or al.AL_FORMAT_MONO16)
-	or (wd.bps == 8 and al.AL_FORMAT_STEREO8 or al.AL_FORMAT_STEREO16)
+local fmt = wd.format
 print("Chosen fmt", fmt)
 
 print("Appending buffer data...")
 
+-- compressed (adpcm) formats need the block size before the data
+if(wd.samples_per_block)then
+	al.alBufferi(albuf[1], al.AL_UNPACK_BLOCK_ALIGNMENT_SOFT, wd.samples_per_block)
+end
 al.alBufferData(albuf[1], fmt, wd.sound_data, wd.sound_size, wd.sample_rate)
 
 
@@ -0,0 +1,357 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "account.h"
+#include "loop.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(OPENLUAL_TRACE)
+#	include "trace.h"
+#endif
+
+#define ACCOUNT_MAX_TAGS 256
+
+typedef struct AccountSlot {
+	uint64_t key; // kind << 32 | name, 0 when empty
+	size_t bytes;
+	const char* tag;
+} AccountSlot;
+
+
+static pthread_mutex_t account_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static AccountSlot* account_slots; // open addressed, linear probing
+static size_t account_cap;
+static size_t account_count;
+static AccountTotals account_sum;
+
+static char* account_tags[ACCOUNT_MAX_TAGS];
+static size_t account_tag_count;
+
+
+static uint64_t account_key(int kind, unsigned int name) {
+	return (uint64_t) (kind + 1) << 32 | name;
+}
+
+static size_t account_home(uint64_t key, size_t cap) {
+	key *= 0x9E3779B97F4A7C15ull;
+	return (key >> 32) & (cap - 1);
+}
+
+static const char* account_intern(const char* tag) {
+	if(tag == 0)
+		return 0;
+	for(size_t i=0; i<account_tag_count; i++)
+		if(strcmp(account_tags[i], tag) == 0)
+			return account_tags[i];
+	if(account_tag_count == ACCOUNT_MAX_TAGS)
+		return 0;
+	char* copy = strdup(tag);
+	if(copy != 0)
+		account_tags[account_tag_count++] = copy;
+	return copy;
+}
+
+static int account_grow(void) {
+	size_t cap = account_cap ? account_cap * 2 : 256;
+	AccountSlot* slots = calloc(cap, sizeof(AccountSlot));
+	if(slots == 0) {
+		puts("Could not allocate memory.");
+		return 0;
+	}
+	for(size_t i=0; i<account_cap; i++) {
+		if(account_slots[i].key == 0)
+			continue;
+		size_t at = account_home(account_slots[i].key, cap);
+		while(slots[at].key != 0)
+			at = (at + 1) & (cap - 1);
+		slots[at] = account_slots[i];
+	}
+	free(account_slots);
+	account_slots = slots;
+	account_cap = cap;
+	return 1;
+}
+
+static AccountSlot* account_find(uint64_t key) {
+	if(account_cap == 0)
+		return 0;
+	size_t at = account_home(key, account_cap);
+	while(account_slots[at].key != 0) {
+		if(account_slots[at].key == key)
+			return &account_slots[at];
+		at = (at + 1) & (account_cap - 1);
+	}
+	return 0;
+}
+
+// finds or adds, 0 when out of memory
+static AccountSlot* account_add(int kind, unsigned int name) {
+	uint64_t key = account_key(kind, name);
+	AccountSlot* slot = account_find(key);
+	if(slot != 0)
+		return slot;
+	if((account_count + 1) * 2 > account_cap && !account_grow())
+		return 0;
+	size_t at = account_home(key, account_cap);
+	while(account_slots[at].key != 0)
+		at = (at + 1) & (account_cap - 1);
+	slot = &account_slots[at];
+	slot->key = key;
+	slot->bytes = 0;
+	slot->tag = 0;
+	account_count++;
+	if(kind == ACCOUNT_SOURCE)
+		account_sum.sources++;
+	else
+		account_sum.buffers++;
+	return slot;
+}
+
+static void account_remove(int kind, unsigned int name) {
+	AccountSlot* slot = account_find(account_key(kind, name));
+	if(slot == 0)
+		return;
+	if(kind == ACCOUNT_SOURCE)
+		account_sum.sources--;
+	else
+		account_sum.buffers--;
+	account_sum.bytes -= slot->bytes;
+	account_count--;
+	
+  // shift the rest of the run back so no probe chain breaks
+	size_t hole = slot - account_slots;
+	size_t at = hole;
+	for(;;) {
+		at = (at + 1) & (account_cap - 1);
+		if(account_slots[at].key == 0)
+			break;
+		size_t home = account_home(account_slots[at].key, account_cap);
+		if(((at - home) & (account_cap - 1)) >= ((at - hole) & (account_cap - 1))) {
+			account_slots[hole] = account_slots[at];
+			hole = at;
+		}
+	}
+	account_slots[hole].key = 0;
+}
+
+#if defined(OPENLUAL_TRACE)
+
+// args as the lua binding of the same name takes them, then results
+static void account_trace_names(const char* function, ALsizei n, const ALuint* names, const char* tag, int made) {
+	if(!trace_native())
+		return;
+	TraceBuf b = {0};
+	tracebuf_varint(&b, 2);
+	tracebuf_int(&b, n);
+	if(made) {
+		tracebuf_string(&b, tag);
+		tracebuf_varint(&b, 1);
+		tracebuf_names(&b, n, names);
+	} else {
+		tracebuf_names(&b, n, names);
+		tracebuf_varint(&b, 0);
+	}
+	trace_native_emit(function, &b);
+	free(b.data);
+}
+
+static void account_trace_data(ALuint buffer, ALenum format, const void* data, ALsizei size, ALsizei rate) {
+	if(!trace_native())
+		return;
+	TraceBuf b = {0};
+	tracebuf_varint(&b, 5);
+	tracebuf_int(&b, buffer);
+	tracebuf_int(&b, format);
+	tracebuf_data(&b, data, size);
+	tracebuf_int(&b, size);
+	tracebuf_int(&b, rate);
+	tracebuf_varint(&b, 0);
+	trace_native_emit("alBufferData", &b);
+	free(b.data);
+}
+
+static void account_trace_ints(const char* function, ALuint name, ALint a, ALsizei n, const ALuint* list) {
+	if(!trace_native())
+		return;
+	TraceBuf b = {0};
+	tracebuf_varint(&b, 3);
+	tracebuf_int(&b, name);
+	tracebuf_int(&b, a);
+	if(list != 0)
+		tracebuf_names(&b, n, list);
+	else
+		tracebuf_int(&b, n);
+	tracebuf_varint(&b, 0);
+	trace_native_emit(function, &b);
+	free(b.data);
+}
+
+#else
+#	define account_trace_names(function, n, names, tag, made)
+#	define account_trace_data(buffer, format, data, size, rate)
+#	define account_trace_ints(function, name, a, n, list)
+#endif
+
+// the driver is asked afterwards rather than through alGetError, which
+// would swallow an error the caller is about to check for
+static void account_gen(int kind, ALsizei n, ALuint* names, const char* tag) {
+	pthread_mutex_lock(&account_lock);
+	const char* interned = account_intern(tag);
+	for(ALsizei i=0; i<n; i++) {
+		if(names[i] == 0 || !(kind == ACCOUNT_SOURCE ? alIsSource(names[i]) : alIsBuffer(names[i])))
+			continue;
+		AccountSlot* slot = account_add(kind, names[i]);
+		if(slot != 0)
+			slot->tag = interned;
+	}
+	pthread_mutex_unlock(&account_lock);
+}
+
+static void account_delete(int kind, ALsizei n, const ALuint* names) {
+	pthread_mutex_lock(&account_lock);
+	for(ALsizei i=0; i<n; i++) {
+		if(names[i] == 0 || (kind == ACCOUNT_SOURCE ? alIsSource(names[i]) : alIsBuffer(names[i])))
+			continue;
+		account_remove(kind, names[i]);
+	}
+	pthread_mutex_unlock(&account_lock);
+}
+
+
+void account_gen_sources(ALsizei n, ALuint* names, const char* tag) {
+	if(n <= 0)
+		return;
+	memset(names, 0, n * sizeof(ALuint));
+	alGenSources(n, names);
+	account_gen(ACCOUNT_SOURCE, n, names, tag);
+	account_trace_names("alGenSources", n, names, tag, 1);
+}
+
+void account_delete_sources(ALsizei n, const ALuint* names) {
+	if(n <= 0)
+		return;
+	
+  // the loop service must let go first, a reused name is someone else's source
+	for(ALsizei i=0; i<n; i++)
+		loop_forget(names[i]);
+	alDeleteSources(n, names);
+	account_delete(ACCOUNT_SOURCE, n, names);
+	account_trace_names("alDeleteSources", n, names, 0, 0);
+}
+
+void account_gen_buffers(ALsizei n, ALuint* names, const char* tag) {
+	if(n <= 0)
+		return;
+	memset(names, 0, n * sizeof(ALuint));
+	alGenBuffers(n, names);
+	account_gen(ACCOUNT_BUFFER, n, names, tag);
+	account_trace_names("alGenBuffers", n, names, tag, 1);
+}
+
+void account_delete_buffers(ALsizei n, const ALuint* names) {
+	if(n <= 0)
+		return;
+	alDeleteBuffers(n, names);
+	account_delete(ACCOUNT_BUFFER, n, names);
+	account_trace_names("alDeleteBuffers", n, names, 0, 0);
+}
+
+void account_buffer_data(ALuint buffer, ALenum format, const void* data, ALsizei size, ALsizei rate) {
+	alBufferData(buffer, format, data, size, rate);
+	account_trace_data(buffer, format, data, size, rate);
+	if(buffer == 0)
+		return;
+	
+  // only names made through account_gen_buffers are counted, and the size
+  // comes back from the driver so a rejected upload keeps the old one. An
+  // error from alBufferData stays the first one for the caller to see.
+	pthread_mutex_lock(&account_lock);
+	AccountSlot* slot = account_find(account_key(ACCOUNT_BUFFER, buffer));
+	if(slot != 0) {
+		ALint stored = 0;
+		alGetBufferi(buffer, AL_SIZE, &stored);
+		if(stored < 0)
+			stored = 0;
+		account_sum.bytes += (size_t) stored - slot->bytes;
+		slot->bytes = stored;
+	}
+	pthread_mutex_unlock(&account_lock);
+}
+
+void account_bufferi(ALuint buffer, ALenum param, ALint value) {
+	alBufferi(buffer, param, value);
+	account_trace_ints("alBufferi", buffer, param, value, 0);
+}
+
+void account_queue_buffers(ALuint source, ALsizei n, const ALuint* buffers) {
+	if(n <= 0)
+		return;
+	alSourceQueueBuffers(source, n, buffers);
+	account_trace_ints("alSourceQueueBuffers", source, n, n, buffers);
+}
+
+void account_unqueue_buffers(ALuint source, ALsizei n, ALuint* buffers) {
+	if(n <= 0)
+		return;
+	alSourceUnqueueBuffers(source, n, buffers);
+	account_trace_ints("alSourceUnqueueBuffers", source, n, n, buffers);
+}
+
+
+void account_totals(AccountTotals* totals) {
+	pthread_mutex_lock(&account_lock);
+	*totals = account_sum;
+	pthread_mutex_unlock(&account_lock);
+}
+
+int account_snapshot(AccountTotals* totals, AccountEntry** list, size_t* count) {
+	pthread_mutex_lock(&account_lock);
+	AccountEntry* entries = malloc((account_count > 0 ? account_count : 1) * sizeof(AccountEntry));
+	if(entries == 0) {
+		pthread_mutex_unlock(&account_lock);
+		puts("Could not allocate memory.");
+		return 0;
+	}
+	size_t n = 0;
+	for(size_t i=0; i<account_cap; i++) {
+		const AccountSlot* slot = &account_slots[i];
+		if(slot->key == 0)
+			continue;
+		entries[n].name = (unsigned int) slot->key;
+		entries[n].kind = (int) (slot->key >> 32) - 1;
+		entries[n].bytes = slot->bytes;
+		entries[n].tag = slot->tag;
+		n++;
+	}
+	*totals = account_sum;
+	pthread_mutex_unlock(&account_lock);
+	*list = entries;
+	*count = n;
+	return 1;
+}
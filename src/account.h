@@ -0,0 +1,66 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "AL/al.h"
+
+#define ACCOUNT_SOURCE	0
+#define ACCOUNT_BUFFER	1
+
+typedef struct AccountEntry {
+	unsigned int name;
+	int kind;
+	size_t bytes; // last upload, buffers only
+	const char* tag; // where it was made, 0 when not given
+} AccountEntry;
+
+typedef struct AccountTotals {
+	size_t sources;
+	size_t buffers;
+	uint64_t bytes;
+} AccountTotals;
+
+// every source and buffer name made or deleted inside the library goes
+// through these, so the live set is known without asking the driver. tag
+// is copied once and kept for the life of the process.
+void account_gen_sources(ALsizei n, ALuint* names, const char* tag);
+void account_delete_sources(ALsizei n, const ALuint* names);
+void account_gen_buffers(ALsizei n, ALuint* names, const char* tag);
+void account_delete_buffers(ALsizei n, const ALuint* names);
+void account_buffer_data(ALuint buffer, ALenum format, const void* data, ALsizei size, ALsizei rate);
+
+// the rest of the library's own al calls a trace needs to replay its names
+// and uploads; with OPENLUAL_TRACE all of these are recorded
+void account_bufferi(ALuint buffer, ALenum param, ALint value);
+void account_queue_buffers(ALuint source, ALsizei n, const ALuint* buffers);
+void account_unqueue_buffers(ALuint source, ALsizei n, ALuint* buffers);
+
+void account_totals(AccountTotals* totals);
+
+// copies the live set, free the list when done; returns 0 on failure
+int account_snapshot(AccountTotals* totals, AccountEntry** list, size_t* count);
@@ -0,0 +1,185 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "adpcm.h"
+
+#include <stdint.h>
+
+
+static const int ima_steps[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+	253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+	1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+	3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+	11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+	32767
+};
+
+static const int ima_indices[8] = {-1, -1, -1, -1, 2, 4, 6, 8};
+
+static const int ms_adapt[16] = {
+	230, 230, 230, 230, 307, 409, 512, 614, 768, 614, 512, 409, 307, 230, 230, 230
+};
+
+// the standard coefficient set every encoder writes
+static const int ms_coef1[7] = {256, 512, 0, 192, 240, 460, 392};
+static const int ms_coef2[7] = {0, -256, 0, 64, 0, -208, -232};
+
+
+static inline int adpcm_clamp16(int v) {
+	return v < -32768 ? -32768 : (v > 32767 ? 32767 : v);
+}
+
+static inline short adpcm_s16(const unsigned char* p) {
+	return (short) (p[0] | (p[1] << 8));
+}
+
+
+size_t adpcm_ima_block_frames(unsigned int channels, unsigned int block_align) {
+	if(channels == 0 || block_align <= 4 * channels)
+		return 0;
+	return (block_align - 4 * channels) / (4 * channels) * 8 + 1;
+}
+
+size_t adpcm_ms_block_frames(unsigned int channels, unsigned int block_align) {
+	if(channels == 0 || block_align < 7 * channels)
+		return 0;
+	return (block_align - 7 * channels) * 2 / channels + 2;
+}
+
+size_t adpcm_ima_frames(size_t size, unsigned int channels, unsigned int block_align) {
+	if(block_align == 0)
+		return 0;
+	size_t frames = size / block_align * adpcm_ima_block_frames(channels, block_align);
+	return frames + adpcm_ima_block_frames(channels, size % block_align);
+}
+
+size_t adpcm_ms_frames(size_t size, unsigned int channels, unsigned int block_align) {
+	if(block_align == 0)
+		return 0;
+	size_t frames = size / block_align * adpcm_ms_block_frames(channels, block_align);
+	return frames + adpcm_ms_block_frames(channels, size % block_align);
+}
+
+
+// one block: a 4 byte header per channel, then 4 byte groups of 8 nibbles per channel
+static size_t adpcm_ima_block(const unsigned char* in, unsigned int size, unsigned int channels, short* out) {
+	int pred[8];
+	int index[8];
+	
+	size_t frames = adpcm_ima_block_frames(channels, size);
+	for(unsigned int c=0; c<channels; c++) {
+		pred[c] = adpcm_s16(in + c * 4);
+		index[c] = in[c * 4 + 2] > 88 ? 88 : in[c * 4 + 2];
+		out[c] = pred[c];
+	}
+	in += 4 * channels;
+	
+	for(size_t f=1; f<frames; f+=8) {
+		for(unsigned int c=0; c<channels; c++) {
+			short* o = out + f * channels + c;
+			for(unsigned int n=0; n<8 && f + n < frames; n++) {
+				unsigned int nib = (in[n / 2] >> ((n & 1) * 4)) & 0xF;
+				int step = ima_steps[index[c]];
+				int diff = step >> 3;
+				if(nib & 1) diff += step >> 2;
+				if(nib & 2) diff += step >> 1;
+				if(nib & 4) diff += step;
+				pred[c] = adpcm_clamp16(nib & 8 ? pred[c] - diff : pred[c] + diff);
+				index[c] += ima_indices[nib & 7];
+				index[c] = index[c] < 0 ? 0 : (index[c] > 88 ? 88 : index[c]);
+				o[n * channels] = pred[c];
+			}
+			in += 4;
+		}
+	}
+	return frames;
+}
+
+// one block: predictor, delta and two history samples per channel, then nibbles high first
+static size_t adpcm_ms_block(const unsigned char* in, unsigned int size, unsigned int channels, short* out) {
+	int coef1[8], coef2[8], delta[8], s1[8], s2[8];
+	
+	size_t frames = adpcm_ms_block_frames(channels, size);
+	for(unsigned int c=0; c<channels; c++) {
+		unsigned int p = in[c] > 6 ? 6 : in[c];
+		coef1[c] = ms_coef1[p];
+		coef2[c] = ms_coef2[p];
+		delta[c] = adpcm_s16(in + channels + c * 2);
+		s1[c] = adpcm_s16(in + channels * 3 + c * 2);
+		s2[c] = adpcm_s16(in + channels * 5 + c * 2);
+		out[c] = s2[c];
+		out[channels + c] = s1[c];
+	}
+	in += 7 * channels;
+	
+	for(size_t i=2 * channels; i<frames * channels; i++) {
+		unsigned int c = i % channels;
+		unsigned int nib = (in[(i - 2 * channels) / 2] >> ((i & 1) ? 0 : 4)) & 0xF;
+		int snib = nib & 8 ? (int) nib - 16 : (int) nib;
+		int pred = ((s1[c] * coef1[c]) + (s2[c] * coef2[c])) / 256;
+		pred = adpcm_clamp16(pred + snib * delta[c]);
+		s2[c] = s1[c];
+		s1[c] = pred;
+		delta[c] = (ms_adapt[nib] * delta[c]) / 256;
+		if(delta[c] < 16)
+			delta[c] = 16;
+		out[i] = pred;
+	}
+	return frames;
+}
+
+
+size_t adpcm_ima_decode(const unsigned char* in, size_t size, unsigned int channels, unsigned int block_align, short* out) {
+	if(channels == 0 || channels > 8 || block_align == 0)
+		return 0;
+	size_t total = 0;
+	while(size > 0) {
+		unsigned int n = size < block_align ? size : block_align;
+		size_t frames = adpcm_ima_block(in, n, channels, out + total * channels);
+		if(frames == 0)
+			break;
+		total += frames;
+		in += n;
+		size -= n;
+	}
+	return total;
+}
+
+size_t adpcm_ms_decode(const unsigned char* in, size_t size, unsigned int channels, unsigned int block_align, short* out) {
+	if(channels == 0 || channels > 8 || block_align == 0)
+		return 0;
+	size_t total = 0;
+	while(size > 0) {
+		unsigned int n = size < block_align ? size : block_align;
+		size_t frames = adpcm_ms_block(in, n, channels, out + total * channels);
+		if(frames == 0)
+			break;
+		total += frames;
+		in += n;
+		size -= n;
+	}
+	return total;
+}
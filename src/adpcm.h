@@ -0,0 +1,46 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#define WAVE_FORMAT_PCM			0x0001
+#define WAVE_FORMAT_ADPCM		0x0002
+#define WAVE_FORMAT_IMA_ADPCM	0x0011
+#define WAVE_FORMAT_IEEE_FLOAT	0x0003
+#define WAVE_FORMAT_EXTENSIBLE	0xFFFE // the real tag is in the sub format
+
+// frames held by one block of block_align bytes
+size_t adpcm_ima_block_frames(unsigned int channels, unsigned int block_align);
+size_t adpcm_ms_block_frames(unsigned int channels, unsigned int block_align);
+
+// frames that decoding size bytes produces, including a short final block
+size_t adpcm_ima_frames(size_t size, unsigned int channels, unsigned int block_align);
+size_t adpcm_ms_frames(size_t size, unsigned int channels, unsigned int block_align);
+
+// decode wave style blocks into interleaved 16 bit pcm, out must hold
+// adpcm_*_frames() frames, returns the frames written
+size_t adpcm_ima_decode(const unsigned char* in, size_t size, unsigned int channels, unsigned int block_align, short* out);
+size_t adpcm_ms_decode(const unsigned char* in, size_t size, unsigned int channels, unsigned int block_align, short* out);
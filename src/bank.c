@@ -0,0 +1,249 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bank.h"
+#include "wave.h"
+#include "sound.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+
+typedef struct BankItem {
+	BankEntry entry;
+	const char* name;
+	WaveData* wd;
+} BankItem;
+
+static int bank_item_cmp(const void* a, const void* b) {
+	uint32_t ha = ((const BankItem*) a)->entry.hash;
+	uint32_t hb = ((const BankItem*) b)->entry.hash;
+	return ha < hb ? -1 : ha > hb;
+}
+
+static uint64_t bank_align(uint64_t offset) {
+	return (offset + BANK_PAGE_SIZE - 1) & ~(uint64_t) (BANK_PAGE_SIZE - 1);
+}
+
+static int bank_pad(FILE* f, uint64_t from, uint64_t to) {
+	static const char zeros[BANK_PAGE_SIZE];
+	while(from < to) {
+		size_t n = to - from > BANK_PAGE_SIZE ? BANK_PAGE_SIZE : to - from;
+		if(fwrite(zeros, 1, n, f) != n)
+			return 0;
+		from += n;
+	}
+	return 1;
+}
+
+
+// FNV-1a
+uint32_t bank_hash(const char* name) {
+	uint32_t hash = 2166136261u;
+	for(const unsigned char* c = (const unsigned char*) name; *c; c++) {
+		hash ^= *c;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+int bank_pack(const char* out_path, const char** names, const char** paths, unsigned int count) {
+	
+	int ok = 0;
+	FILE* f = 0;
+	
+	BankItem* items = calloc(count ? count : 1, sizeof(BankItem));
+	if(items == 0) {
+		puts("Could not allocate memory.");
+		return 0;
+	}
+	
+  // load everything up front, the index needs the final sizes
+	uint64_t names_size = 0;
+	for(unsigned int i=0; i<count; i++) {
+		items[i].wd = sound_load(paths[i]);
+		if(items[i].wd == 0 || !wave_decode(items[i].wd)) {
+			printf("Could not load %s for the bank.\n", paths[i]);
+			goto exit;
+		}
+		items[i].name = names[i];
+		items[i].entry.hash = bank_hash(names[i]);
+		items[i].entry.name_offset = names_size;
+		items[i].entry.length = items[i].wd->sound_size;
+		items[i].entry.sample_rate = items[i].wd->sample_rate;
+		items[i].entry.channels = items[i].wd->channels;
+		items[i].entry.bps = items[i].wd->bps;
+		names_size += strlen(names[i]) + 1;
+	}
+	
+	qsort(items, count, sizeof(BankItem), bank_item_cmp);
+	for(unsigned int i=1; i<count; i++) {
+		if(items[i].entry.hash == items[i-1].entry.hash) {
+			printf("Bank names %s and %s collide, rename one.\n", items[i-1].name, items[i].name);
+			goto exit;
+		}
+	}
+	
+	BankHeader header;
+	memset(&header, 0, sizeof(BankHeader));
+	memcpy(header.magic, BANK_MAGIC, 4);
+	header.version = BANK_VERSION;
+	header.count = count;
+	header.page_size = BANK_PAGE_SIZE;
+	header.index_offset = sizeof(BankHeader);
+	header.names_offset = header.index_offset + (uint64_t) count * sizeof(BankEntry);
+	
+	uint64_t offset = bank_align(header.names_offset + names_size);
+	for(unsigned int i=0; i<count; i++) {
+		items[i].entry.offset = offset;
+		offset = bank_align(offset + items[i].entry.length);
+	}
+	
+	if((f = fopen(out_path, "wb")) == 0) {
+		puts("Could not open file.");
+		goto exit;
+	}
+	
+	if(fwrite(&header, sizeof(BankHeader), 1, f) != 1)
+		goto write_error;
+	for(unsigned int i=0; i<count; i++)
+		if(fwrite(&items[i].entry, sizeof(BankEntry), 1, f) != 1)
+			goto write_error;
+	
+  // names are written in input order to match name_offset
+	uint64_t pos = header.names_offset;
+	for(unsigned int i=0; i<count; i++) {
+		size_t len = strlen(names[i]) + 1;
+		if(fwrite(names[i], 1, len, f) != len)
+			goto write_error;
+		pos += len;
+	}
+	
+	for(unsigned int i=0; i<count; i++) {
+		if(!bank_pad(f, pos, items[i].entry.offset))
+			goto write_error;
+		if(fwrite(items[i].wd->sound_data, 1, items[i].entry.length, f) != items[i].entry.length)
+			goto write_error;
+		pos = items[i].entry.offset + items[i].entry.length;
+	}
+	if(!bank_pad(f, pos, bank_align(pos)))
+		goto write_error;
+	
+	ok = 1;
+	goto exit;
+	
+write_error:
+	puts("Could not write bank file.");
+	
+exit:
+	if(f != 0 && fclose(f) != 0)
+		ok = 0;
+	for(unsigned int i=0; i<count; i++)
+		if(items[i].wd != 0)
+			wave_free(items[i].wd);
+	free(items);
+	return ok;
+}
+
+
+SoundBank* bank_open(const char* path) {
+	
+	SoundBank* bank = calloc(1, sizeof(SoundBank));
+	if(bank == 0) {
+		puts("Could not allocate memory.");
+		return 0;
+	}
+	
+	if(!mapfile_open(&bank->map, path))
+		goto exit;
+	
+  // validate everything once so lookups never have to
+	const BankHeader* header = (const BankHeader*) bank->map.data;
+	size_t size = bank->map.size;
+	if(size < sizeof(BankHeader) || memcmp(header->magic, BANK_MAGIC, 4) != 0 || header->version != BANK_VERSION) {
+		puts("Invalid bank header!");
+		goto exit;
+	}
+	if(header->index_offset > size || header->names_offset > size
+		|| (size - header->index_offset) / sizeof(BankEntry) < header->count) {
+		puts("Truncated bank index!");
+		goto exit;
+	}
+	
+	bank->header = header;
+	bank->entries = (const BankEntry*) (bank->map.data + header->index_offset);
+	bank->names = (const char*) (bank->map.data + header->names_offset);
+	
+	for(uint32_t i=0; i<header->count; i++) {
+		const BankEntry* e = &bank->entries[i];
+		if(e->offset > size || e->length > size - e->offset || e->name_offset >= size - header->names_offset) {
+			puts("Truncated bank payload!");
+			goto exit;
+		}
+	}
+	
+	return bank;
+	
+exit:
+	bank_close(bank);
+	return 0;
+}
+
+const BankEntry* bank_find(const SoundBank* bank, uint32_t hash) {
+	uint32_t lo = 0;
+	uint32_t hi = bank->header->count;
+	while(lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		uint32_t h = bank->entries[mid].hash;
+		if(h == hash)
+			return &bank->entries[mid];
+		if(h < hash)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return 0;
+}
+
+const BankEntry* bank_find_name(const SoundBank* bank, const char* name) {
+	const BankEntry* e = bank_find(bank, bank_hash(name));
+	if(e == 0)
+		return 0;
+	size_t max = bank->map.size - bank->header->names_offset - e->name_offset;
+	if(strncmp(bank->names + e->name_offset, name, max) != 0)
+		return 0;
+	return e;
+}
+
+const unsigned char* bank_data(const SoundBank* bank, const BankEntry* entry) {
+	return bank->map.data + entry->offset;
+}
+
+void bank_close(SoundBank* bank) {
+	if(bank == 0)
+		return;
+	mapfile_close(&bank->map);
+	free(bank);
+}
@@ -0,0 +1,85 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "mapfile.h"
+
+// Sound bank file layout, all fields little endian:
+//   BankHeader
+//   BankEntry[count], sorted by hash
+//   names, zero terminated, referenced by BankEntry.name_offset
+//   pcm payloads, each starting on a page_size boundary
+
+#define BANK_MAGIC		"OLBK"
+#define BANK_VERSION	1
+#define BANK_PAGE_SIZE	4096
+
+typedef struct BankHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t count;
+	uint32_t page_size;
+	uint64_t index_offset;
+	uint64_t names_offset;
+} BankHeader;
+
+typedef struct BankEntry {
+	uint32_t hash;
+	uint32_t name_offset;
+	uint64_t offset;
+	uint32_t length;
+	uint32_t sample_rate;
+	uint16_t channels;
+	uint16_t bps;
+	uint32_t reserved;
+} BankEntry;
+
+typedef struct SoundBank {
+	MappedFile map;
+	const BankHeader* header;
+	const BankEntry* entries;
+	const char* names;
+} SoundBank;
+
+// hash used to index sounds by name
+uint32_t bank_hash(const char* name);
+
+// loads every wave in paths and writes them into a bank at out_path, returns 0 on failure
+int bank_pack(const char* out_path, const char** names, const char** paths, unsigned int count);
+
+// maps a bank file, returns 0 on failure
+SoundBank* bank_open(const char* path);
+
+// binary searches the index, returns 0 when not found
+const BankEntry* bank_find(const SoundBank* bank, uint32_t hash);
+
+// same as bank_find but also compares the stored name
+const BankEntry* bank_find_name(const SoundBank* bank, const char* name);
+
+const unsigned char* bank_data(const SoundBank* bank, const BankEntry* entry);
+
+void bank_close(SoundBank* bank);
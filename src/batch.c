@@ -0,0 +1,170 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "batch.h"
+#include "sound.h"
+#include "pool.h"
+#include "uring.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+#	include <windows.h>
+#else
+#	include <dirent.h>
+#endif
+
+
+static int batch_is_sound(const char* name) {
+	static const char* exts[3] = {".wav", ".ogg", ".flac"};
+	const char* dot = strrchr(name, '.');
+	if(dot == 0)
+		return 0;
+	for(int i=0; i<3; i++) {
+		const char* a = dot;
+		const char* b = exts[i];
+		while(*a && *b && tolower((unsigned char) *a) == *b) {
+			a++;
+			b++;
+		}
+		if(*a == 0 && *b == 0)
+			return 1;
+	}
+	return 0;
+}
+
+static int batch_push(char*** list, size_t* count, size_t* cap, const char* dir, const char* name) {
+	if(*count == *cap) {
+		size_t n = *cap ? *cap * 2 : 64;
+		char** l = realloc(*list, n * sizeof(char*));
+		if(l == 0)
+			return 0;
+		*list = l;
+		*cap = n;
+	}
+	size_t len = strlen(dir) + strlen(name) + 2;
+	char* path = malloc(len);
+	if(path == 0)
+		return 0;
+	snprintf(path, len, "%s/%s", dir, name);
+	(*list)[(*count)++] = path;
+	return 1;
+}
+
+
+char** batch_list_dir(const char* dir, size_t* count) {
+	char** list = 0;
+	size_t cap = 0;
+	*count = 0;
+	
+#if defined(_WIN32) || defined(_WIN64)
+	char pattern[MAX_PATH];
+	snprintf(pattern, sizeof(pattern), "%s\\*", dir);
+	WIN32_FIND_DATAA fd;
+	HANDLE h = FindFirstFileA(pattern, &fd);
+	if(h == INVALID_HANDLE_VALUE) {
+		puts("Could not open directory.");
+		return 0;
+	}
+	do {
+		if(!(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && batch_is_sound(fd.cFileName)
+			&& !batch_push(&list, count, &cap, dir, fd.cFileName)) {
+			puts("Could not allocate memory.");
+			break;
+		}
+	} while(FindNextFileA(h, &fd));
+	FindClose(h);
+#else
+	DIR* d = opendir(dir);
+	if(d == 0) {
+		puts("Could not open directory.");
+		return 0;
+	}
+	struct dirent* e;
+	while((e = readdir(d)) != 0) {
+		if(e->d_name[0] != '.' && batch_is_sound(e->d_name)
+			&& !batch_push(&list, count, &cap, dir, e->d_name)) {
+			puts("Could not allocate memory.");
+			break;
+		}
+	}
+	closedir(d);
+#endif
+	
+  // an empty directory still gets a list to free
+	if(list == 0)
+		list = malloc(sizeof(char*));
+	return list;
+}
+
+void batch_free_list(char** list, size_t count) {
+	if(list == 0)
+		return;
+	for(size_t i=0; i<count; i++)
+		free(list[i]);
+	free(list);
+}
+
+
+typedef struct BatchJob {
+	const char** paths;
+	WaveData** out;
+	const BatchOptions* opts;
+} BatchJob;
+
+WaveData* batch_prepare(WaveData* wd, const BatchOptions* opts) {
+	if(wd == 0)
+		return 0;
+	int keep = opts->keep != 0 && opts->rate == 0 && opts->keep(wd, opts->keep_ctx);
+	if((!keep && !wave_decode(wd)) || (opts->rate != 0 && !wave_convert(wd, 0, opts->rate, opts->quality))) {
+		wave_free(wd);
+		return 0;
+	}
+	return wd;
+}
+
+static void batch_job(void* ctx, size_t i) {
+	BatchJob* j = ctx;
+	j->out[i] = batch_prepare(sound_load(j->paths[i]), j->opts);
+}
+
+size_t batch_load(const char** paths, size_t count, WaveData** out, const BatchOptions* opts) {
+	if(opts->io_uring) {
+		long loaded = uring_batch_load(paths, count, out, opts);
+		if(loaded >= 0)
+			return loaded;
+	}
+	
+	BatchJob job = {paths, out, opts};
+	pool_run(batch_job, &job, count);
+	
+	size_t loaded = 0;
+	for(size_t i=0; i<count; i++)
+		if(out[i] != 0)
+			loaded++;
+	return loaded;
+}
@@ -0,0 +1,55 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include "wave.h"
+
+// decides whether a loaded file keeps its compressed blocks, called from
+// worker threads so it must not touch AL
+typedef int (*BatchKeepFn)(const WaveData* wd, void* ctx);
+
+typedef struct BatchOptions {
+	unsigned int rate; // 0 keeps each file's rate
+	int quality;
+	BatchKeepFn keep; // 0 decodes everything
+	void* keep_ctx;
+	int io_uring; // read through io_uring where the kernel allows it
+} BatchOptions;
+
+// lists the sound files (.wav, .ogg, .flac) directly inside dir, returns
+// 0 on failure; free with batch_free_list
+char** batch_list_dir(const char* dir, size_t* count);
+
+void batch_free_list(char** list, size_t count);
+
+// reads, parses and converts every path on the worker pool, out[i] is 0
+// for files that failed; returns the number that loaded
+size_t batch_load(const char** paths, size_t count, WaveData** out, const BatchOptions* opts);
+
+// applies the decode and conversion options to a freshly parsed file,
+// frees it and returns 0 on failure
+WaveData* batch_prepare(WaveData* wd, const BatchOptions* opts);
@@ -0,0 +1,305 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "cache.h"
+#include "wave.h"
+#include "sound.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+#	include <direct.h>
+#	define cache_mkdir(D) _mkdir(D)
+#else
+#	define cache_mkdir(D) mkdir((D), 0755)
+#endif
+
+
+static char cache_dir[1024] = "cache";
+
+#define FNV64_BASIS	14695981039346656037ull
+#define FNV64_PRIME	1099511628211ull
+
+static uint64_t cache_fnv(uint64_t hash, const void* data, size_t size) {
+	const unsigned char* c = data;
+	for(size_t i=0; i<size; i++) {
+		hash ^= c[i];
+		hash *= FNV64_PRIME;
+	}
+	return hash;
+}
+
+
+void cache_set_dir(const char* dir) {
+	snprintf(cache_dir, sizeof(cache_dir), "%s", dir);
+}
+
+const char* cache_get_dir(void) {
+	return cache_dir;
+}
+
+int cache_hash_file(const char* path, uint64_t* hash) {
+	FILE* f = 0;
+	if((f = fopen(path, "rb")) == 0)
+		return 0;
+	
+	unsigned char* chunk = malloc(1 << 16);
+	if(chunk == 0) {
+		puts("Could not allocate memory.");
+		fclose(f);
+		return 0;
+	}
+	
+	uint64_t h = FNV64_BASIS;
+	size_t n = 0;
+	while((n = fread(chunk, 1, 1 << 16, f)) > 0)
+		h = cache_fnv(h, chunk, n);
+	
+	free(chunk);
+	fclose(f);
+	*hash = h;
+	return 1;
+}
+
+// blob name: hash of the source path, target format and layout
+static void cache_blob_path(char* out, size_t size, const char* path, unsigned int target_bps, unsigned int target_rate, int quality, unsigned int layout) {
+	uint64_t key = cache_fnv(FNV64_BASIS, path, strlen(path));
+	key = cache_fnv(key, &target_bps, sizeof(target_bps));
+	key = cache_fnv(key, &target_rate, sizeof(target_rate));
+	key = cache_fnv(key, &quality, sizeof(quality));
+	key = cache_fnv(key, &layout, sizeof(layout));
+	snprintf(out, size, "%s/%016llx.pcm", cache_dir, (unsigned long long) key);
+}
+
+static int cache_valid(const CacheHeader* h, size_t size, unsigned int target_bps, unsigned int target_rate, int quality, unsigned int layout) {
+	return size >= CACHE_DATA_OFFSET
+		&& memcmp(h->magic, CACHE_MAGIC, 4) == 0
+		&& h->version == CACHE_VERSION
+		&& h->target_bps == target_bps
+		&& h->target_rate == target_rate
+		&& h->target_quality == quality
+		&& h->target_layout == layout
+		&& h->sound_size <= size - CACHE_DATA_OFFSET;
+}
+
+static int cache_write(const char* blob, const CacheHeader* header, const unsigned char* data) {
+	char tmp[1110];
+	snprintf(tmp, sizeof(tmp), "%s.tmp", blob);
+	
+	FILE* f = 0;
+	if((f = fopen(tmp, "wb")) == 0) {
+		puts("Could not write cache file.");
+		return 0;
+	}
+	
+	unsigned char head[CACHE_DATA_OFFSET];
+	memset(head, 0, CACHE_DATA_OFFSET);
+	memcpy(head, header, sizeof(CacheHeader));
+	
+	int ok = fwrite(head, 1, CACHE_DATA_OFFSET, f) == CACHE_DATA_OFFSET
+		&& fwrite(data, 1, header->sound_size, f) == header->sound_size;
+	if(fclose(f) != 0)
+		ok = 0;
+	
+  // readers only ever see a complete blob
+	if(ok) {
+		remove(blob);
+		ok = rename(tmp, blob) == 0;
+	}
+	if(!ok) {
+		puts("Could not write cache file.");
+		remove(tmp);
+	}
+	return ok;
+}
+
+// source only got touched, refresh the stored mtime so the next load skips hashing
+static void cache_touch(const char* blob, const CacheHeader* header) {
+	FILE* f = 0;
+	if((f = fopen(blob, "r+b")) == 0)
+		return;
+	fwrite(header, sizeof(CacheHeader), 1, f);
+	fclose(f);
+}
+
+static CachedSound* cache_map(const char* blob, unsigned int target_bps, unsigned int target_rate, int quality, unsigned int layout) {
+	CachedSound* cs = calloc(1, sizeof(CachedSound));
+	if(cs == 0) {
+		puts("Could not allocate memory.");
+		return 0;
+	}
+	if(!mapfile_open(&cs->map, blob) || !cache_valid((const CacheHeader*) cs->map.data, cs->map.size, target_bps, target_rate, quality, layout)) {
+		cache_close(cs);
+		return 0;
+	}
+	cs->header = (const CacheHeader*) cs->map.data;
+	cs->sound_data = cs->map.data + CACHE_DATA_OFFSET;
+	return cs;
+}
+
+static CachedSound* cache_build(const char* path, const char* blob, const struct stat* st, uint64_t hash, unsigned int target_bps, unsigned int target_rate, int quality,
+	CacheFitFn fit, void* fit_ctx, unsigned int layout) {
+	
+	WaveData* wd = sound_load(path);
+	if(wd == 0)
+		return 0;
+	if(!wave_convert(wd, target_bps, target_rate, quality) || (fit != 0 && !fit(wd, fit_ctx))) {
+		wave_free(wd);
+		return 0;
+	}
+	
+	CacheHeader header;
+	memset(&header, 0, sizeof(CacheHeader));
+	memcpy(header.magic, CACHE_MAGIC, 4);
+	header.version = CACHE_VERSION;
+	header.source_hash = hash;
+	header.source_size = st->st_size;
+	header.source_mtime = st->st_mtime;
+	header.target_bps = target_bps;
+	header.target_rate = target_rate;
+	header.target_quality = quality;
+	header.channels = wd->channels;
+	header.bps = wd->bps;
+	header.sample_rate = wd->sample_rate;
+	header.sound_size = wd->sound_size;
+	header.target_layout = layout;
+	
+	cache_mkdir(cache_dir);
+	int ok = cache_write(blob, &header, wd->sound_data);
+	wave_free(wd);
+	if(!ok)
+		return 0;
+	
+	return cache_map(blob, target_bps, target_rate, quality, layout);
+}
+
+
+CachedSound* cache_load(const char* path, unsigned int target_bps, unsigned int target_rate, int quality,
+	CacheFitFn fit, void* fit_ctx, unsigned int layout) {
+	
+	struct stat st;
+	if(stat(path, &st) != 0) {
+		puts("Could not open file.");
+		return 0;
+	}
+	
+	char blob[1100];
+	cache_blob_path(blob, sizeof(blob), path, target_bps, target_rate, quality, layout);
+	
+	CachedSound* cs = 0;
+	struct stat bst;
+	if(stat(blob, &bst) == 0)
+		cs = cache_map(blob, target_bps, target_rate, quality, layout);
+	if(cs != 0 && cs->header->source_size == (uint64_t) st.st_size && cs->header->source_mtime == (int64_t) st.st_mtime)
+		return cs;
+	
+  // stale or missing, the content hash decides whether to rebuild
+	uint64_t hash = 0;
+	if(!cache_hash_file(path, &hash)) {
+		puts("Could not open file.");
+		cache_close(cs);
+		return 0;
+	}
+	
+	if(cs != 0 && cs->header->source_hash == hash && cs->header->source_size == (uint64_t) st.st_size) {
+		CacheHeader header = *cs->header;
+		header.source_mtime = st.st_mtime;
+		cache_close(cs);
+		cache_touch(blob, &header);
+		return cache_map(blob, target_bps, target_rate, quality, layout);
+	}
+	
+	cache_close(cs);
+	return cache_build(path, blob, &st, hash, target_bps, target_rate, quality, fit, fit_ctx, layout);
+}
+
+// meta name: hash of the source path, plus the record's own extension
+static void cache_meta_path(char* out, size_t size, const char* path, const char* ext) {
+	uint64_t key = cache_fnv(FNV64_BASIS, path, strlen(path));
+	snprintf(out, size, "%s/%016llx.%s", cache_dir, (unsigned long long) key, ext);
+}
+
+int cache_get_meta(const char* path, const char* ext, void* record, size_t size) {
+	
+	struct stat st;
+	if(stat(path, &st) != 0)
+		return 0;
+	
+	char meta[1100];
+	cache_meta_path(meta, sizeof(meta), path, ext);
+	FILE* f = 0;
+	if((f = fopen(meta, "rb")) == 0)
+		return 0;
+	CacheHeader header;
+	unsigned char head[CACHE_DATA_OFFSET];
+	int ok = fread(head, 1, CACHE_DATA_OFFSET, f) == CACHE_DATA_OFFSET;
+	memcpy(&header, head, sizeof(CacheHeader));
+	ok = ok && cache_valid(&header, CACHE_DATA_OFFSET + size, 0, 0, 0, 0) && header.sound_size == size
+		&& fread(record, 1, size, f) == size;
+	fclose(f);
+	if(!ok)
+		return 0;
+	if(header.source_size == (uint64_t) st.st_size && header.source_mtime == (int64_t) st.st_mtime)
+		return 1;
+	
+  // same rule as the blobs, an mtime change alone costs a rehash
+	uint64_t hash = 0;
+	if(header.source_size != (uint64_t) st.st_size || !cache_hash_file(path, &hash) || hash != header.source_hash)
+		return 0;
+	header.source_mtime = st.st_mtime;
+	cache_touch(meta, &header);
+	return 1;
+}
+
+int cache_put_meta(const char* path, const char* ext, const void* record, size_t size) {
+	
+	struct stat st;
+	uint64_t hash = 0;
+	if(stat(path, &st) != 0 || !cache_hash_file(path, &hash))
+		return 0;
+	
+	CacheHeader header;
+	memset(&header, 0, sizeof(CacheHeader));
+	memcpy(header.magic, CACHE_MAGIC, 4);
+	header.version = CACHE_VERSION;
+	header.source_hash = hash;
+	header.source_size = st.st_size;
+	header.source_mtime = st.st_mtime;
+	header.sound_size = size;
+	
+	char meta[1100];
+	cache_meta_path(meta, sizeof(meta), path, ext);
+	cache_mkdir(cache_dir);
+	return cache_write(meta, &header, record);
+}
+
+void cache_close(CachedSound* cs) {
+	if(cs == 0)
+		return;
+	mapfile_close(&cs->map);
+	free(cs);
+}
@@ -0,0 +1,91 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "mapfile.h"
+#include "wave.h"
+
+// Cache blob layout, all fields little endian:
+//   CacheHeader
+//   pcm payload at CACHE_DATA_OFFSET, ready for alBufferData
+// Blobs are named after the source path, the target format and the
+// layout the fit step was asked for. The
+// header remembers the source size, mtime and content hash; a changed
+// mtime alone triggers a rehash, a changed hash rebuilds the blob.
+
+#define CACHE_MAGIC			"OLCC"
+#define CACHE_VERSION		3
+#define CACHE_DATA_OFFSET	64
+
+typedef struct CacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t source_hash;
+	uint64_t source_size;
+	int64_t source_mtime;
+	uint32_t target_bps;
+	uint32_t target_rate;
+	int32_t target_quality;
+	uint32_t channels;
+	uint32_t bps;
+	uint32_t sample_rate;
+	uint32_t sound_size;
+	uint32_t target_layout;
+} CacheHeader;
+
+typedef struct CachedSound {
+	MappedFile map;
+	const CacheHeader* header;
+	const unsigned char* sound_data;
+} CachedSound;
+
+// directory holding the cache blobs, created on first store
+void cache_set_dir(const char* dir);
+
+const char* cache_get_dir(void);
+
+// FNV-1a over a whole file, returns 0 on failure
+int cache_hash_file(const char* path, uint64_t* hash);
+
+// brings a converted sound to something the caller can upload before it
+// is stored, returns 0 to give up
+typedef int (*CacheFitFn)(WaveData* wd, void* ctx);
+
+// maps the cached conversion of path, building it first when missing or
+// stale; target_bps and target_rate of 0 keep the source format. fit may
+// be 0, layout tells apart blobs fitted under different constraints.
+CachedSound* cache_load(const char* path, unsigned int target_bps, unsigned int target_rate, int quality,
+	CacheFitFn fit, void* fit_ctx, unsigned int layout);
+
+void cache_close(CachedSound* cs);
+
+// small fixed size records about a source, such as its loudness, stored
+// as <path hash>.<ext> with the same header and staleness rules as blobs;
+// get returns 0 when there is no valid record
+int cache_get_meta(const char* path, const char* ext, void* record, size_t size);
+
+int cache_put_meta(const char* path, const char* ext, const void* record, size_t size);
@@ -0,0 +1,441 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "capture.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#	include <emmintrin.h>
+#elif defined(__SSE__)
+#	include <xmmintrin.h>
+#endif
+
+#include "AL/al.h"
+
+#ifndef AL_FORMAT_MONO_FLOAT32
+#	define AL_FORMAT_MONO_FLOAT32	0x10010
+#	define AL_FORMAT_STEREO_FLOAT32	0x10011
+#endif
+
+#define CAPTURE_SILENCE		-144.0f // dBFS reported for digital silence
+#define CAPTURE_NOISE_RISE	0.05f // dB the noise floor may climb per block
+
+
+static float capture_db(float v) {
+	return v > 1e-7f ? 20 * log10f(v) : CAPTURE_SILENCE;
+}
+
+// n samples of the raw buffer as float scaled to +-1
+static void capture_tofloat(const Capture* c, const unsigned char* p, size_t n, float* dst) {
+	size_t i = 0;
+	if(c->bps == 32) {
+		memcpy(dst, p, n * sizeof(float));
+	} else if(c->bps == 16) {
+		const short* s = (const short*) p;
+#if defined(__SSE2__)
+		__m128 scale = _mm_set1_ps(1.0f / 32768);
+		for(; i+8<=n; i+=8) {
+			__m128i v = _mm_loadu_si128((const __m128i*) (s + i));
+			__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+			__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+			_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+			_mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+		}
+#endif
+		for(; i<n; i++)
+			dst[i] = s[i] * (1.0f / 32768);
+	} else {
+		for(; i<n; i++)
+			dst[i] = (p[i] - 128) * (1.0f / 128);
+	}
+}
+
+// peak and sum of squares of one block, mixed down into c->mono
+static void capture_scan(Capture* c, const unsigned char* p, size_t frames, float* peak, double* squares) {
+	unsigned int ch = c->channels;
+	size_t n = frames * ch;
+	const float* x = c->conv;
+	capture_tofloat(c, p, n, c->conv);
+	
+	size_t i = 0;
+	float pk = 0;
+	float sq = 0;
+#if defined(__SSE__)
+	__m128 sign = _mm_set1_ps(-0.0f);
+	__m128 vp = _mm_setzero_ps();
+	__m128 vs = _mm_setzero_ps();
+	for(; i+4<=n; i+=4) {
+		__m128 v = _mm_loadu_ps(x + i);
+		vp = _mm_max_ps(vp, _mm_andnot_ps(sign, v));
+		vs = _mm_add_ps(vs, _mm_mul_ps(v, v));
+	}
+	float lanes[4];
+	_mm_storeu_ps(lanes, vp);
+	for(int k=0; k<4; k++)
+		pk = lanes[k] > pk ? lanes[k] : pk;
+	_mm_storeu_ps(lanes, vs);
+	sq = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+	for(; i<n; i++) {
+		float a = fabsf(x[i]);
+		pk = a > pk ? a : pk;
+		sq += x[i] * x[i];
+	}
+	*peak = pk;
+	*squares = sq;
+	
+	if(ch == 1) {
+		memcpy(c->mono, x, frames * sizeof(float));
+		return;
+	}
+	for(size_t f=0; f<frames; f++) {
+		float m = 0;
+		for(unsigned int k=0; k<ch; k++)
+			m += x[f * ch + k];
+		c->mono[f] = m / ch;
+	}
+}
+
+// slides a block of the mono mix into the last fft size frames
+static void capture_history(Capture* c, size_t frames) {
+	size_t n = c->opts.spectrum;
+	if(frames >= n) {
+		memcpy(c->history, c->mono + frames - n, n * sizeof(float));
+		return;
+	}
+	memmove(c->history, c->history + frames, (n - frames) * sizeof(float));
+	memcpy(c->history + n - frames, c->mono, frames * sizeof(float));
+}
+
+// windowed magnitude spectrum of the history
+static void capture_spectrum(Capture* c) {
+	size_t n = c->opts.spectrum;
+	size_t i = 0;
+#if defined(__SSE__)
+	for(; i+4<=n; i+=4)
+		_mm_storeu_ps(c->re + i, _mm_mul_ps(_mm_loadu_ps(c->history + i), _mm_loadu_ps(c->window + i)));
+#endif
+	for(; i<n; i++)
+		c->re[i] = c->history[i] * c->window[i];
+	memset(c->im, 0, n * sizeof(float));
+	fft_forward(c->plan, c->re, c->im);
+	
+  // the window is normalised so a full scale sine reads 0 dB in its bin
+	for(size_t k=0; k<n/2; k++)
+		c->spectrum[k] = capture_db(sqrtf(c->re[k] * c->re[k] + c->im[k] * c->im[k]));
+	c->have_spectrum = 1;
+}
+
+// voice when the level clears both the floor and the noise estimate by the
+// margin, held for the hangover; the estimate drops at once to quieter
+// blocks and creeps up otherwise, and speech never feeds it
+static int capture_vad(Capture* c, float rms) {
+	if(c->blocks == 0)
+		c->noise = rms;
+	int loud = rms > c->opts.floor && rms > c->noise + c->opts.margin;
+	if(!loud) {
+		if(rms < c->noise)
+			c->noise = rms;
+		else
+			c->noise += rms - c->noise < CAPTURE_NOISE_RISE ? rms - c->noise : CAPTURE_NOISE_RISE;
+	}
+	c->blocks++;
+	if(loud) {
+		c->hang = c->opts.hangover;
+		return 1;
+	}
+	if(c->hang > 0) {
+		c->hang--;
+		return 1;
+	}
+	return 0;
+}
+
+static unsigned char* capture_reserve(Capture* c, size_t size) {
+	if(c->out_size + size > c->out_cap) {
+		size_t cap = c->out_cap ? c->out_cap : 4096;
+		while(cap < c->out_size + size)
+			cap *= 2;
+		unsigned char* o = realloc(c->out, cap);
+		if(o == 0) {
+			puts("Could not allocate memory.");
+			return 0;
+		}
+		c->out = o;
+		c->out_cap = cap;
+	}
+	unsigned char* at = c->out + c->out_size;
+	c->out_size += size;
+	return at;
+}
+
+// n floats into the output sample type
+static void capture_store(int type, const float* src, size_t n, unsigned char* dst) {
+	size_t i = 0;
+	if(type == SAMPLES_F32) {
+		memcpy(dst, src, n * sizeof(float));
+	} else if(type == SAMPLES_S16) {
+		short* d = (short*) dst;
+#if defined(__SSE2__)
+		__m128 scale = _mm_set1_ps(32768.0f);
+		__m128 lo = _mm_set1_ps(-32768.0f);
+		__m128 hi = _mm_set1_ps(32767.0f);
+		for(; i+8<=n; i+=8) {
+			__m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i), scale), lo), hi);
+			__m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale), lo), hi);
+			_mm_storeu_si128((__m128i*) (d + i), _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+		}
+#endif
+		for(; i<n; i++) {
+			float v = src[i] * 32768.0f;
+			d[i] = v >= 32767.0f ? 32767 : v <= -32768.0f ? -32768 : (short) lrintf(v);
+		}
+	} else {
+		for(; i<n; i++) {
+			float v = src[i] * 128.0f;
+			dst[i] = v >= 127.0f ? 255 : v <= -128.0f ? 0 : (unsigned char) (lrintf(v) + 128);
+		}
+	}
+}
+
+// one analysed block to the output, its float copy is still in c->conv
+static int capture_keep(Capture* c, const unsigned char* p, size_t frames) {
+	if(c->opts.out_type < 0) {
+		unsigned char* at = capture_reserve(c, frames * c->out_frame);
+		if(at == 0)
+			return 0;
+		memcpy(at, p, frames * c->out_frame);
+		return 1;
+	}
+	
+	const float* src = c->conv;
+	unsigned int ch = c->opts.out_channels;
+	if(ch == 1 && c->channels != 1) {
+		src = c->mono;
+	} else if(ch != c->channels) {
+		// mono spread over every output channel
+		for(size_t f=0; f<frames; f++)
+			for(unsigned int k=0; k<ch; k++)
+				c->stage[f * ch + k] = c->mono[f];
+		src = c->stage;
+	}
+	if(c->resampler != 0) {
+		frames = resample_process(c->resampler, src, frames, c->stage);
+		src = c->stage;
+	}
+	
+	unsigned char* at = capture_reserve(c, frames * c->out_frame);
+	if(at == 0)
+		return 0;
+	capture_store(c->opts.out_type, src, frames * ch, at);
+	return 1;
+}
+
+
+int capture_layout(int format, unsigned int* channels, unsigned int* bps) {
+	switch(format) {
+		case AL_FORMAT_MONO8: *channels = 1; *bps = 8; return 1;
+		case AL_FORMAT_STEREO8: *channels = 2; *bps = 8; return 1;
+		case AL_FORMAT_MONO16: *channels = 1; *bps = 16; return 1;
+		case AL_FORMAT_STEREO16: *channels = 2; *bps = 16; return 1;
+		case AL_FORMAT_MONO_FLOAT32: *channels = 1; *bps = 32; return 1;
+		case AL_FORMAT_STEREO_FLOAT32: *channels = 2; *bps = 32; return 1;
+	}
+	return 0;
+}
+
+Capture* capture_open(const char* name, unsigned int rate, int format, size_t buffer_frames, const CaptureOptions* opts) {
+	Capture* c = calloc(1, sizeof(Capture));
+	if(c == 0) {
+		puts("Could not allocate memory.");
+		return 0;
+	}
+	if(!capture_layout(format, &c->channels, &c->bps)) {
+		puts("Unsupported capture format.");
+		free(c);
+		return 0;
+	}
+	c->format = format;
+	c->rate = rate;
+	c->opts = *opts;
+	if(c->opts.block == 0)
+		c->opts.block = rate / 50;
+	if(c->opts.spectrum != 0 && (c->opts.spectrum < 4 || (c->opts.spectrum & (c->opts.spectrum - 1)) != 0)) {
+		puts("Spectrum size must be a power of two.");
+		free(c);
+		return 0;
+	}
+	
+	size_t frame = c->channels * (c->bps / 8);
+	c->raw_cap = buffer_frames + c->opts.block;
+	c->raw = malloc(c->raw_cap * frame);
+	c->conv = malloc(c->opts.block * c->channels * sizeof(float));
+	c->mono = malloc(c->opts.block * sizeof(float));
+	if(c->raw == 0 || c->conv == 0 || c->mono == 0)
+		goto fail;
+	
+  // the output stage, skipped entirely when the device format is wanted
+	if(c->opts.out_type < 0) {
+		c->out_frame = frame;
+	} else {
+		if(c->opts.out_channels == 0)
+			c->opts.out_channels = c->channels;
+		if(c->opts.out_rate == 0)
+			c->opts.out_rate = rate;
+		if(c->opts.out_type > SAMPLES_F32 || c->opts.out_channels > 2) {
+			puts("Unsupported capture output.");
+			capture_close(c);
+			return 0;
+		}
+		c->out_frame = c->opts.out_channels * samples_type_size(c->opts.out_type);
+		size_t stage = c->opts.block;
+		if(c->opts.out_rate != rate) {
+			c->resampler = resample_open(c->opts.out_channels, rate, c->opts.out_rate, RESAMPLE_DEFAULT);
+			if(c->resampler == 0) {
+				capture_close(c);
+				return 0;
+			}
+			stage = resample_room(c->resampler, c->opts.block);
+		}
+		c->stage = malloc(stage * c->opts.out_channels * sizeof(float));
+		if(c->stage == 0)
+			goto fail;
+	}
+	if(c->opts.spectrum != 0) {
+		size_t n = c->opts.spectrum;
+		c->plan = fft_plan(n);
+		c->window = malloc(n * sizeof(float));
+		c->re = malloc(n * sizeof(float));
+		c->im = malloc(n * sizeof(float));
+		c->history = calloc(n, sizeof(float));
+		c->spectrum = malloc(n / 2 * sizeof(float));
+		if(c->plan == 0 || c->window == 0 || c->re == 0 || c->im == 0 || c->history == 0 || c->spectrum == 0)
+			goto fail;
+		for(size_t i=0; i<n; i++)
+			c->window[i] = (0.5f - 0.5f * cosf(2 * (float) M_PI * i / n)) * 4 / n;
+	}
+	
+	c->device = alcCaptureOpenDevice(name, rate, format, buffer_frames);
+	if(c->device == 0) {
+		puts("Could not open capture device.");
+		capture_close(c);
+		return 0;
+	}
+	return c;
+	
+fail:
+	puts("Could not allocate memory.");
+	capture_close(c);
+	return 0;
+}
+
+void capture_close(Capture* c) {
+	if(c == 0)
+		return;
+	if(c->device != 0)
+		alcCaptureCloseDevice(c->device);
+	free(c->raw);
+	free(c->out);
+	free(c->conv);
+	free(c->mono);
+	free(c->stage);
+	resample_close(c->resampler);
+	fft_free(c->plan);
+	free(c->window);
+	free(c->re);
+	free(c->im);
+	free(c->history);
+	free(c->spectrum);
+	free(c);
+}
+
+void capture_start(Capture* c) {
+	alcCaptureStart(c->device);
+}
+
+void capture_stop(Capture* c) {
+	alcCaptureStop(c->device);
+}
+
+int capture_poll(Capture* c, CaptureLevel* level) {
+	size_t frame = c->channels * (c->bps / 8);
+	size_t block = c->opts.block;
+	c->have_spectrum = 0;
+	level->peak = 0;
+	level->rms = 0;
+	level->voice = 0;
+	level->blocks = 0;
+	
+	int avail = 0;
+	alcGetIntegerv(c->device, ALC_CAPTURE_SAMPLES, 1, &avail);
+	size_t room = c->raw_cap - c->raw_frames;
+	size_t take = (size_t) avail < room ? (size_t) avail : room;
+	if(take > 0) {
+		alcCaptureSamples(c->device, c->raw + c->raw_frames * frame, take);
+		c->raw_frames += take;
+	}
+	
+	size_t whole = c->raw_frames / block * block;
+	double squares = 0;
+	float peak = 0;
+	for(size_t at=0; at<whole; at+=block) {
+		const unsigned char* p = c->raw + at * frame;
+		float bp;
+		double bsq;
+		capture_scan(c, p, block, &bp, &bsq);
+		peak = bp > peak ? bp : peak;
+		squares += bsq;
+		
+		int voice = capture_vad(c, capture_db(sqrt(bsq / (block * c->channels))));
+		level->voice |= voice;
+		level->blocks++;
+		if((voice || c->opts.keep_silence) && !capture_keep(c, p, block))
+			return 0;
+		if(c->opts.spectrum != 0)
+			capture_history(c, block);
+	}
+	
+	if(c->opts.spectrum != 0 && level->blocks != 0)
+		capture_spectrum(c);
+	memmove(c->raw, c->raw + whole * frame, (c->raw_frames - whole) * frame);
+	c->raw_frames -= whole;
+	
+	level->peak = level->blocks ? capture_db(peak) : CAPTURE_SILENCE;
+	level->rms = level->blocks ? capture_db(sqrt(squares / (whole * c->channels))) : CAPTURE_SILENCE;
+	level->noise = c->noise;
+	return 1;
+}
+
+size_t capture_read(Capture* c, void* dst, size_t size) {
+	size_t n = c->out_size < size ? c->out_size : size;
+	n -= n % c->out_frame;
+	memcpy(dst, c->out, n);
+	memmove(c->out, c->out + n, c->out_size - n);
+	c->out_size -= n;
+	return n;
+}
@@ -0,0 +1,113 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include "AL/alc.h"
+#include "fft.h"
+#include "resample.h"
+#include "samples.h"
+
+typedef struct CaptureOptions {
+	unsigned int block; // analysis block in frames
+	unsigned int spectrum; // fft size of the magnitude spectrum, 0 for none
+	float margin; // dB over the noise floor that counts as voice
+	float floor; // dBFS that never counts as voice
+	unsigned int hangover; // blocks voice stays on after the level drops
+	int keep_silence; // hand over silent blocks too
+	
+	// what the kept blocks are turned into, the device's own for 0
+	int out_type; // SAMPLES_ type, -1 keeps the device format as is
+	unsigned int out_channels;
+	unsigned int out_rate;
+} CaptureOptions;
+
+// levels over the blocks of one poll
+typedef struct CaptureLevel {
+	float peak; // dBFS
+	float rms; // dBFS
+	float noise; // noise floor estimate, dBFS
+	int voice; // some block was voiced
+	unsigned int blocks;
+} CaptureLevel;
+
+typedef struct Capture {
+	ALCdevice* device;
+	int format;
+	unsigned int channels;
+	unsigned int bps; // 32 is float
+	unsigned int rate;
+	CaptureOptions opts;
+	
+	// device frames not yet analysed, less than a block between polls
+	unsigned char* raw;
+	size_t raw_frames;
+	size_t raw_cap;
+	
+	// kept blocks in the output format, waiting to be read
+	unsigned char* out;
+	size_t out_size;
+	size_t out_cap;
+	size_t out_frame;
+	
+	float* conv; // one block as float
+	float* mono; // the same mixed down
+	float* stage; // up mixed or resampled block
+	Resampler* resampler;
+	
+	FftPlan* plan;
+	float* window;
+	float* re;
+	float* im;
+	float* history; // the last fft size frames of the mono mix
+	float* spectrum; // spectrum / 2 bins in dBFS, as of the last block
+	int have_spectrum;
+	
+	float noise;
+	unsigned int hang;
+	size_t blocks;
+} Capture;
+
+// channels and bits per sample of an AL capture format, 32 being float;
+// returns 0 for formats capture does not take
+int capture_layout(int format, unsigned int* channels, unsigned int* bps);
+
+// opens the capture device as alcCaptureOpenDevice does, returns 0 on failure
+Capture* capture_open(const char* name, unsigned int rate, int format, size_t buffer_frames, const CaptureOptions* opts);
+
+void capture_close(Capture* c);
+
+void capture_start(Capture* c);
+
+void capture_stop(Capture* c);
+
+// pulls what the device holds, analyses it block by block and adds the
+// voiced blocks to c->out, converted when asked to; returns 0 on failure
+int capture_poll(Capture* c, CaptureLevel* level);
+
+// moves up to size bytes of whole output frames out of c->out into dst and
+// returns how many
+size_t capture_read(Capture* c, void* dst, size_t size);
@@ -0,0 +1,266 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "convolve.h"
+#include "fft.h"
+#include "pool.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <math.h>
+
+#if defined(__SSE__)
+#	include <xmmintrin.h>
+#endif
+
+#define CONVOLVE_BLOCK			4096 // largest partition picked on its own
+#define CONVOLVE_MIN_BLOCK		64
+#define CONVOLVE_JOBS_PER_THREAD	4
+#define CONVOLVE_MIN_LANE		8 // output blocks per lane
+
+
+typedef struct ConvolveJob {
+	const Samples* dry;
+	const Samples* ir;
+	Samples* out;
+	const FftPlan* plan;
+	float* spectra; // partition spectra for every ir channel, split re then im
+	size_t block;
+	size_t partitions;
+	size_t blocks; // output blocks
+	size_t lane; // output blocks per lane, two lanes per job
+	float wet;
+	float dry_gain;
+	atomic_int failed;
+} ConvolveJob;
+
+
+// sample of channel c at frame f scaled to +-1, silence outside the sound
+static float convolve_sample(const Samples* s, ptrdiff_t f, unsigned int c) {
+	if(f < 0 || (size_t) f >= s->frames)
+		return 0;
+	size_t i = f * s->channels + c;
+	switch(s->type) {
+		case SAMPLES_U8: return (s->data[i] - 128) * (1.0f / 128);
+		case SAMPLES_S16: return ((const short*) s->data)[i] * (1.0f / 32768);
+	}
+	return ((const float*) s->data)[i];
+}
+
+// fills n values from frame first on of channel c
+static void convolve_read(const Samples* s, ptrdiff_t first, unsigned int c, float* dst, size_t n) {
+	for(size_t i=0; i<n; i++)
+		dst[i] = convolve_sample(s, first + (ptrdiff_t) i, c);
+}
+
+// spectrum of partition p of ir channel c, zero padded to the fft size
+static void convolve_ir_job(void* ctx, size_t i) {
+	ConvolveJob* j = ctx;
+	size_t n = j->plan->size;
+	unsigned int c = i / j->partitions;
+	size_t p = i % j->partitions;
+	float* re = j->spectra + i * 2 * n;
+	float* im = re + n;
+	convolve_read(j->ir, p * j->block, c, re, j->block);
+	memset(re + j->block, 0, (n - j->block) * sizeof(float));
+	memset(im, 0, n * sizeof(float));
+	fft_forward(j->plan, re, im);
+	
+  // the inverse transform's 1/n is folded in here once
+	float scale = 1.0f / n;
+	for(size_t k=0; k<n; k++) {
+		re[k] *= scale;
+		im[k] *= scale;
+	}
+}
+
+// acc += x * h over n complex bins
+static void convolve_mac(float* acc_re, float* acc_im, const float* xr, const float* xi, const float* hr, const float* hi, size_t n) {
+	size_t k = 0;
+#if defined(__SSE__)
+	for(; k+4<=n; k+=4) {
+		__m128 a = _mm_loadu_ps(xr + k);
+		__m128 b = _mm_loadu_ps(xi + k);
+		__m128 c = _mm_loadu_ps(hr + k);
+		__m128 d = _mm_loadu_ps(hi + k);
+		__m128 r = _mm_sub_ps(_mm_mul_ps(a, c), _mm_mul_ps(b, d));
+		__m128 i = _mm_add_ps(_mm_mul_ps(a, d), _mm_mul_ps(b, c));
+		_mm_storeu_ps(acc_re + k, _mm_add_ps(_mm_loadu_ps(acc_re + k), r));
+		_mm_storeu_ps(acc_im + k, _mm_add_ps(_mm_loadu_ps(acc_im + k), i));
+	}
+#endif
+	for(; k<n; k++) {
+		acc_re[k] += xr[k] * hr[k] - xi[k] * hi[k];
+		acc_im[k] += xr[k] * hi[k] + xi[k] * hr[k];
+	}
+}
+
+static void convolve_write(ConvolveJob* j, size_t k, unsigned int c, const float* y) {
+	Samples* out = j->out;
+	size_t first = k * j->block;
+	if(first >= out->frames)
+		return;
+	size_t n = out->frames - first < j->block ? out->frames - first : j->block;
+	unsigned int dc = c % j->dry->channels;
+	for(size_t i=0; i<n; i++) {
+		size_t f = first + i;
+		float v = y[i] * j->wet + convolve_sample(j->dry, f, dc) * j->dry_gain;
+		size_t at = f * out->channels + c;
+		if(out->type == SAMPLES_F32) {
+			((float*) out->data)[at] = v;
+		} else {
+			v *= 32768;
+			((short*) out->data)[at] = v >= 32767 ? 32767 : v <= -32768 ? -32768 : (short) lrintf(v);
+		}
+	}
+}
+
+// one output channel over two runs of blocks, the first lane in the real
+// part of every transform and the second in the imaginary part; the ir is
+// real so the two never mix. Each lane first feeds the delay line with the
+// partitions - 1 blocks before its start.
+static void convolve_job(void* ctx, size_t i) {
+	ConvolveJob* j = ctx;
+	unsigned int channels = j->out->channels;
+	unsigned int c = i % channels;
+	size_t a = (i / channels) * 2 * j->lane;
+	size_t b = a + j->lane;
+	if(a >= j->blocks)
+		return;
+	
+	size_t n = j->plan->size;
+	size_t parts = j->partitions;
+	float* mem = malloc((parts + 2) * 2 * n * sizeof(float));
+	if(mem == 0) {
+		puts("Could not allocate memory.");
+		atomic_store(&j->failed, 1);
+		return;
+	}
+	float* line = mem; // parts spectra, a ring indexed by block
+	float* acc_re = mem + parts * 2 * n;
+	float* acc_im = acc_re + n;
+	float* y_re = acc_im + n;
+	float* y_im = y_re + n;
+	
+	const float* spectra = j->spectra + (c % j->ir->channels) * parts * 2 * n;
+	unsigned int dc = c % j->dry->channels;
+	size_t lane = b < j->blocks ? j->lane : j->blocks - a;
+	for(ptrdiff_t t=-(ptrdiff_t) (parts - 1); t<(ptrdiff_t) lane; t++) {
+		// overlap save, block k reads frames (k - 1) * block up to (k + 1) * block
+		size_t slot = (size_t) (t + (ptrdiff_t) parts) % parts;
+		float* xr = line + slot * 2 * n;
+		float* xi = xr + n;
+		convolve_read(j->dry, ((ptrdiff_t) a + t - 1) * (ptrdiff_t) j->block, dc, xr, n);
+		convolve_read(j->dry, ((ptrdiff_t) b + t - 1) * (ptrdiff_t) j->block, dc, xi, n);
+		fft_forward(j->plan, xr, xi);
+		if(t < 0)
+			continue;
+		
+		memset(acc_re, 0, 2 * n * sizeof(float));
+		for(size_t p=0; p<parts; p++) {
+			const float* x = line + ((slot + parts - p) % parts) * 2 * n;
+			const float* h = spectra + p * 2 * n;
+			convolve_mac(acc_re, acc_im, x, x + n, h, h + n, n);
+		}
+		memcpy(y_re, acc_re, 2 * n * sizeof(float));
+		fft_inverse(j->plan, y_re, y_im);
+		
+	  // the second half is the part free of wrap around
+		convolve_write(j, a + t, c, y_re + j->block);
+		if(b + t < j->blocks)
+			convolve_write(j, b + t, c, y_im + j->block);
+	}
+	free(mem);
+}
+
+
+Samples* convolve(const Samples* dry, const Samples* ir, const ConvolveOptions* opts) {
+	if(dry->sample_rate != ir->sample_rate || dry->channels == 0 || ir->channels == 0 || ir->frames == 0) {
+		puts("Impulse response does not fit the sound!");
+		return 0;
+	}
+	
+  // offline there is no latency to keep down, so blocks as long as the
+  // ir up to CONVOLVE_BLOCK keep the partition count small
+	size_t block = opts->block;
+	if(block == 0) {
+		block = CONVOLVE_MIN_BLOCK;
+		while(block < ir->frames && block < CONVOLVE_BLOCK)
+			block *= 2;
+	}
+	if(block < 4 || (block & (block - 1)) != 0) {
+		puts("Convolution block must be a power of two!");
+		return 0;
+	}
+	
+	Samples* out = 0;
+	FftPlan* plan = 0;
+	float* spectra = 0;
+	
+	ConvolveJob job;
+	job.dry = dry;
+	job.ir = ir;
+	job.block = block;
+	job.partitions = (ir->frames + block - 1) / block;
+	job.wet = opts->wet;
+	job.dry_gain = opts->dry;
+	atomic_init(&job.failed, 0);
+	
+	unsigned int channels = dry->channels > ir->channels ? dry->channels : ir->channels;
+	size_t frames = dry->frames + ir->frames - 1;
+	out = samples_new(dry->type == SAMPLES_F32 ? SAMPLES_F32 : SAMPLES_S16, channels, dry->sample_rate, frames);
+	plan = fft_plan(2 * block);
+	spectra = malloc(ir->channels * job.partitions * 4 * block * sizeof(float));
+	if(out == 0 || plan == 0 || spectra == 0) {
+		puts("Could not allocate memory.");
+		goto exit;
+	}
+	job.out = out;
+	job.plan = plan;
+	job.spectra = spectra;
+	pool_run(convolve_ir_job, &job, ir->channels * job.partitions);
+	
+  // cut the timeline into enough pieces to keep every thread busy
+	job.blocks = (frames + block - 1) / block;
+	size_t pieces = (pool_threads() * CONVOLVE_JOBS_PER_THREAD + channels - 1) / channels;
+	job.lane = (job.blocks + 2 * pieces - 1) / (2 * pieces);
+	if(job.lane < CONVOLVE_MIN_LANE)
+		job.lane = CONVOLVE_MIN_LANE;
+	pieces = (job.blocks + 2 * job.lane - 1) / (2 * job.lane);
+	pool_run(convolve_job, &job, pieces * channels);
+	if(atomic_load(&job.failed))
+		goto exit;
+	
+	fft_free(plan);
+	free(spectra);
+	return out;
+	
+exit:
+	samples_free(out);
+	fft_free(plan);
+	free(spectra);
+	return 0;
+}
@@ -0,0 +1,42 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include "samples.h"
+
+typedef struct ConvolveOptions {
+	float wet;
+	float dry;
+	size_t block; // partition length in frames, a power of two, 0 picks one
+} ConvolveOptions;
+
+// convolves dry with the impulse response ir by uniformly partitioned fft
+// convolution spread over the pool, mixing wet and dry into a new block
+// that runs on for the length of the tail. It has the larger channel count
+// of the two, pairing their channels round robin; f32 in gives f32 out and
+// anything else s16. Both must share a sample rate, returns 0 on failure.
+Samples* convolve(const Samples* dry, const Samples* ir, const ConvolveOptions* opts);
@@ -0,0 +1,272 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "feed.h"
+#include "account.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "AL/al.h"
+
+#define AL_FORMAT_MONO_FLOAT32		0x10010
+#define AL_FORMAT_STEREO_FLOAT32	0x10011
+
+typedef ALsizei (*feed_CallbackType)(ALvoid* userptr, ALvoid* data, ALsizei size);
+typedef void (*feed_BufferCallback)(ALuint buffer, ALenum format, ALsizei freq, feed_CallbackType callback, ALvoid* userptr);
+
+
+static feed_BufferCallback feed_proc(void) {
+	if(!alIsExtensionPresent("AL_SOFT_callback_buffer"))
+		return 0;
+	return (feed_BufferCallback) alGetProcAddress("alBufferCallbackSOFT");
+}
+
+int feed_supported(void) {
+	return feed_proc() != 0;
+}
+
+static size_t feed_frame(int format, unsigned char* silence) {
+	*silence = 0;
+	switch(format) {
+		case AL_FORMAT_MONO8: *silence = 0x80; return 1;
+		case AL_FORMAT_STEREO8: *silence = 0x80; return 2;
+		case AL_FORMAT_MONO16: return 2;
+		case AL_FORMAT_STEREO16: return 4;
+		case AL_FORMAT_MONO_FLOAT32: return 4;
+		case AL_FORMAT_STEREO_FLOAT32: return 8;
+	}
+	return 0;
+}
+
+// runs on the mixer thread: no locks, no allocation, no lua
+static ALsizei feed_callback(ALvoid* userptr, ALvoid* data, ALsizei size) {
+	Feed* f = userptr;
+	
+  // finished first, so everything written before it is in the ring
+	int finished = atomic_load_explicit(&f->finished, memory_order_acquire);
+	size_t got = ring_read(&f->ring, data, size);
+	atomic_fetch_add_explicit(&f->played, got, memory_order_relaxed);
+	if(got == (size_t) size || finished)
+		return got; // a short return stops the source
+	
+	memset((unsigned char*) data + got, f->silence, size - got);
+	atomic_fetch_add_explicit(&f->underruns, 1, memory_order_relaxed);
+	return size;
+}
+
+static void* feed_worker(void* arg) {
+	Feed* f = arg;
+	
+  // half the ring at most, so a small ring still fills while the other half plays
+	size_t chunk = f->ring.size / f->frame_size / 2;
+	if(chunk > 1024)
+		chunk = 1024;
+	if(chunk == 0)
+		chunk = 1;
+	short* pcm = malloc(chunk * f->frame_size);
+	if(pcm == 0) {
+		puts("Could not allocate memory.");
+		atomic_store(&f->finished, 1);
+		return 0;
+	}
+	
+	while(atomic_load(&f->running)) {
+		
+		if(!atomic_load(&f->finished) && ring_space(&f->ring) >= chunk * f->frame_size) {
+			size_t frames = f->decoder->read(f->decoder, pcm, chunk);
+			if(frames == 0) {
+				if(!f->loop || !f->decoder->rewind(f->decoder))
+					atomic_store_explicit(&f->finished, 1, memory_order_release);
+				continue;
+			}
+			ring_write(&f->ring, pcm, frames * f->frame_size);
+			continue;
+		}
+		
+	  // the mixer cannot wake us without a lock, so nap for a slice of the ring
+		struct timespec ts;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_nsec += f->poll_ns;
+		if(ts.tv_nsec >= 1000000000) {
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000;
+		}
+		pthread_mutex_lock(&f->lock);
+		if(atomic_load(&f->running))
+			pthread_cond_timedwait(&f->wake, &f->lock, &ts);
+		pthread_mutex_unlock(&f->lock);
+	}
+	
+	free(pcm);
+	return 0;
+}
+
+static Feed* feed_create(unsigned int source, int format, unsigned int rate, size_t ring_frames) {
+	feed_BufferCallback proc = feed_proc();
+	if(proc == 0) {
+		puts("AL_SOFT_callback_buffer is not supported.");
+		return 0;
+	}
+	
+	Feed* f = calloc(1, sizeof(Feed));
+	if(f == 0) {
+		puts("Could not allocate memory.");
+		return 0;
+	}
+	f->frame_size = feed_frame(format, &f->silence);
+	if(f->frame_size == 0 || rate == 0) {
+		puts("Unsupported feed format.");
+		free(f);
+		return 0;
+	}
+	if(ring_frames == 0)
+		ring_frames = rate / 10;
+	if(!ring_init(&f->ring, ring_frames * f->frame_size)) {
+		puts("Could not allocate memory.");
+		free(f);
+		return 0;
+	}
+	
+	f->source = source;
+	f->format = format;
+	f->rate = rate;
+	f->poll_ns = (long) ((double) ring_frames / rate * 1e9 / 4);
+	if(f->poll_ns > 20000000)
+		f->poll_ns = 20000000;
+	if(f->poll_ns < 500000)
+		f->poll_ns = 500000;
+	atomic_init(&f->running, 0);
+	atomic_init(&f->finished, 0);
+	atomic_init(&f->played, 0);
+	atomic_init(&f->underruns, 0);
+	
+	alGetError();
+	account_gen_buffers(1, &f->buffer, "feed");
+	proc(f->buffer, format, rate, feed_callback, f);
+	alSourcei(source, AL_BUFFER, 0);
+	alSourcei(source, AL_BUFFER, f->buffer);
+	if(f->buffer == 0 || alGetError() != AL_NO_ERROR) {
+		puts("Could not set up the callback buffer.");
+		alSourcei(source, AL_BUFFER, 0);
+		account_delete_buffers(1, &f->buffer);
+		ring_free(&f->ring);
+		free(f);
+		return 0;
+	}
+	return f;
+}
+
+Feed* feed_open(unsigned int source, int format, unsigned int rate, size_t ring_frames) {
+	return feed_create(source, format, rate, ring_frames);
+}
+
+Feed* feed_open_decoder(Decoder* d, unsigned int source, size_t ring_frames, int loop) {
+	if(d->channels == 0 || d->channels > 2) {
+		puts("Unsupported feed channel count!");
+		decoder_close(d);
+		return 0;
+	}
+	Feed* f = feed_create(source, d->channels == 1 ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16, d->sample_rate, ring_frames);
+	if(f == 0) {
+		decoder_close(d);
+		return 0;
+	}
+	f->decoder = d;
+	f->loop = loop;
+	
+	pthread_mutex_init(&f->lock, 0);
+	pthread_cond_init(&f->wake, 0);
+	atomic_store(&f->running, 1);
+	if(pthread_create(&f->thread, 0, feed_worker, f) != 0) {
+		puts("Could not start feed thread.");
+		atomic_store(&f->running, 0);
+		pthread_cond_destroy(&f->wake);
+		pthread_mutex_destroy(&f->lock);
+		feed_close(f);
+		return 0;
+	}
+	f->threaded = 1;
+	
+  // let the ring fill up so playing right away does not start on silence
+	size_t want = f->ring.size / 2;
+	for(int tries = 0; tries < 200 && ring_used(&f->ring) < want && !atomic_load(&f->finished); tries++) {
+		struct timespec ts = {0, 1000000};
+		nanosleep(&ts, 0);
+	}
+	return f;
+}
+
+size_t feed_write(Feed* f, const void* data, size_t size) {
+	if(f->decoder != 0 || atomic_load(&f->finished))
+		return 0;
+	size_t room = ring_space(&f->ring);
+	if(size > room)
+		size = room;
+	size -= size % f->frame_size;
+	return ring_write(&f->ring, data, size);
+}
+
+size_t feed_space(Feed* f) {
+	if(f->decoder != 0)
+		return 0;
+	return ring_space(&f->ring) / f->frame_size;
+}
+
+void feed_finish(Feed* f) {
+	if(f->decoder == 0)
+		atomic_store_explicit(&f->finished, 1, memory_order_release);
+}
+
+void feed_stats(Feed* f, FeedStats* stats) {
+	stats->played = atomic_load_explicit(&f->played, memory_order_relaxed) / f->frame_size;
+	stats->buffered = ring_used(&f->ring) / f->frame_size;
+	stats->underruns = atomic_load_explicit(&f->underruns, memory_order_relaxed);
+}
+
+void feed_close(Feed* f) {
+	if(f == 0)
+		return;
+	
+  // once the source lets go of the buffer the mixer no longer calls back
+	alSourceStop(f->source);
+	alSourcei(f->source, AL_BUFFER, 0);
+	account_delete_buffers(1, &f->buffer);
+	
+	if(f->threaded) {
+		pthread_mutex_lock(&f->lock);
+		atomic_store(&f->running, 0);
+		pthread_cond_signal(&f->wake);
+		pthread_mutex_unlock(&f->lock);
+		pthread_join(f->thread, 0);
+		pthread_cond_destroy(&f->wake);
+		pthread_mutex_destroy(&f->lock);
+	}
+	
+	ring_free(&f->ring);
+	decoder_close(f->decoder);
+	free(f);
+}
@@ -0,0 +1,93 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "sound.h"
+#include "ring.h"
+
+// A feed plays a source from a callback buffer (AL_SOFT_callback_buffer):
+// the mixer pulls straight out of a lock free ring, so there is no queue to
+// keep topped up and no buffer of latency on top of the ring. The ring is
+// filled either by the owner through feed_write or by a decoder thread,
+// never both. The callback only reads the ring and never takes a lock.
+typedef struct Feed {
+	Decoder* decoder; // 0 when fed through feed_write
+	Ring ring;
+	
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	atomic_int running;
+	atomic_int finished; // nothing more will be written
+	int loop;
+	int threaded;
+	long poll_ns; // decoder thread's nap while the ring is full
+	
+	unsigned int source;
+	unsigned int buffer;
+	int format;
+	unsigned int rate;
+	size_t frame_size;
+	unsigned char silence;
+	
+	atomic_size_t played; // bytes handed to the mixer
+	atomic_size_t underruns; // callbacks padded out with silence
+} Feed;
+
+typedef struct FeedStats {
+	size_t played; // frames
+	size_t buffered; // frames waiting in the ring
+	size_t underruns;
+} FeedStats;
+
+// whether the current context has AL_SOFT_callback_buffer
+int feed_supported(void);
+
+// a feed of format at rate on source, holding up to ring_frames ahead of
+// the mixer; returns 0 on failure
+Feed* feed_open(unsigned int source, int format, unsigned int rate, size_t ring_frames);
+
+// same, filled from a decoder on its own thread; the feed takes ownership
+// of the decoder
+Feed* feed_open_decoder(Decoder* d, unsigned int source, size_t ring_frames, int loop);
+
+// producer side for feeds without a decoder, writes the whole frames that
+// fit and returns the bytes written
+size_t feed_write(Feed* f, const void* data, size_t size);
+
+// frames feed_write would take right now
+size_t feed_space(Feed* f);
+
+// marks the end; the source stops once the ring has played out
+void feed_finish(Feed* f);
+
+void feed_stats(Feed* f, FeedStats* stats);
+
+// stops the source and releases the buffer, the ring and the decoder
+void feed_close(Feed* f);
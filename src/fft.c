@@ -0,0 +1,138 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "fft.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#if defined(__SSE__)
+#	include <xmmintrin.h>
+#endif
+
+
+FftPlan* fft_plan(size_t size) {
+	if(size < 2 || (size & (size - 1)) != 0)
+		return 0;
+	
+	FftPlan* plan = malloc(sizeof(FftPlan));
+	if(plan == 0) {
+		puts("Could not allocate memory.");
+		return 0;
+	}
+	plan->size = size;
+	plan->reverse = malloc(size * sizeof(unsigned int));
+	plan->twiddle_re = malloc(size * sizeof(float));
+	plan->twiddle_im = malloc(size * sizeof(float));
+	if(plan->reverse == 0 || plan->twiddle_re == 0 || plan->twiddle_im == 0) {
+		puts("Could not allocate memory.");
+		fft_free(plan);
+		return 0;
+	}
+	
+	unsigned int bits = 0;
+	while(((size_t) 1 << bits) < size)
+		bits++;
+	for(size_t i=0; i<size; i++) {
+		unsigned int r = 0;
+		for(unsigned int b=0; b<bits; b++)
+			r |= ((i >> b) & 1) << (bits - 1 - b);
+		plan->reverse[i] = r;
+	}
+	
+  // each stage gets its own run so the butterflies read them in order
+	for(size_t m=1; m<size; m*=2)
+		for(size_t j=0; j<m; j++) {
+			double a = -M_PI * j / m;
+			plan->twiddle_re[m - 1 + j] = cos(a);
+			plan->twiddle_im[m - 1 + j] = sin(a);
+		}
+	return plan;
+}
+
+void fft_free(FftPlan* plan) {
+	if(plan == 0)
+		return;
+	free(plan->reverse);
+	free(plan->twiddle_re);
+	free(plan->twiddle_im);
+	free(plan);
+}
+
+void fft_forward(const FftPlan* plan, float* re, float* im) {
+	size_t n = plan->size;
+	for(size_t i=0; i<n; i++) {
+		size_t r = plan->reverse[i];
+		if(r > i) {
+			float t = re[i];
+			re[i] = re[r];
+			re[r] = t;
+			t = im[i];
+			im[i] = im[r];
+			im[r] = t;
+		}
+	}
+	
+	for(size_t m=1; m<n; m*=2) {
+		const float* wr = plan->twiddle_re + m - 1;
+		const float* wi = plan->twiddle_im + m - 1;
+		for(size_t k=0; k<n; k+=2*m) {
+			float* ar = re + k;
+			float* ai = im + k;
+			float* br = ar + m;
+			float* bi = ai + m;
+			size_t j = 0;
+#if defined(__SSE__)
+			for(; j+4<=m; j+=4) {
+				__m128 xr = _mm_loadu_ps(br + j);
+				__m128 xi = _mm_loadu_ps(bi + j);
+				__m128 cr = _mm_loadu_ps(wr + j);
+				__m128 ci = _mm_loadu_ps(wi + j);
+				__m128 tr = _mm_sub_ps(_mm_mul_ps(xr, cr), _mm_mul_ps(xi, ci));
+				__m128 ti = _mm_add_ps(_mm_mul_ps(xr, ci), _mm_mul_ps(xi, cr));
+				__m128 yr = _mm_loadu_ps(ar + j);
+				__m128 yi = _mm_loadu_ps(ai + j);
+				_mm_storeu_ps(br + j, _mm_sub_ps(yr, tr));
+				_mm_storeu_ps(bi + j, _mm_sub_ps(yi, ti));
+				_mm_storeu_ps(ar + j, _mm_add_ps(yr, tr));
+				_mm_storeu_ps(ai + j, _mm_add_ps(yi, ti));
+			}
+#endif
+			for(; j<m; j++) {
+				float tr = br[j] * wr[j] - bi[j] * wi[j];
+				float ti = br[j] * wi[j] + bi[j] * wr[j];
+				br[j] = ar[j] - tr;
+				bi[j] = ai[j] - ti;
+				ar[j] += tr;
+				ai[j] += ti;
+			}
+		}
+	}
+}
+
+void fft_inverse(const FftPlan* plan, float* re, float* im) {
+	// swapping the parts on the way in and out conjugates the transform
+	fft_forward(plan, im, re);
+}
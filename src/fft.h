@@ -0,0 +1,46 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+// radix 2 complex transform over split real and imaginary arrays
+typedef struct FftPlan {
+	size_t size;
+	unsigned int* reverse; // bit reversed index of every slot
+	float* twiddle_re; // stage of half size m starts at m - 1
+	float* twiddle_im;
+} FftPlan;
+
+// size must be a power of two, returns 0 on failure
+FftPlan* fft_plan(size_t size);
+
+void fft_free(FftPlan* plan);
+
+// in place and unscaled
+void fft_forward(const FftPlan* plan, float* re, float* im);
+
+// in place and unscaled, a forward then inverse pass multiplies by size
+void fft_inverse(const FftPlan* plan, float* re, float* im);
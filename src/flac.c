@@ -0,0 +1,548 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "flac.h"
+#include "adpcm.h"
+#include "pool.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+
+// below this many frames threads cost more than they save
+#define FLAC_PARALLEL_FRAMES	64
+#define FLAC_FRAMES_PER_JOB		16
+#define FLAC_MAX_CHANNELS		8
+#define FLAC_MAX_BLOCK			65536
+
+typedef struct FlacInfo {
+	unsigned int sample_rate;
+	unsigned int channels;
+	unsigned int bps;
+	unsigned int max_block;
+	uint64_t total_frames;
+} FlacInfo;
+
+typedef struct FlacFrame {
+	size_t offset; // of the sync code
+	size_t size;
+	uint64_t first; // first pcm frame
+	unsigned int block;
+} FlacFrame;
+
+typedef struct FlacBits {
+	const unsigned char* data;
+	size_t size;
+	size_t pos; // in bits
+} FlacBits;
+
+
+// -----
+
+static inline uint64_t flac_peek(const FlacBits* b) {
+	size_t byte = b->pos >> 3;
+	uint64_t v = 0;
+	if(byte + 8 <= b->size) {
+		for(int i=0; i<8; i++)
+			v = (v << 8) | b->data[byte + i];
+	} else {
+		for(int i=0; i<8; i++)
+			v = (v << 8) | (byte + i < b->size ? b->data[byte + i] : 0);
+	}
+	return v << (b->pos & 7);
+}
+
+// up to 32 bits
+static inline uint32_t flac_bits(FlacBits* b, unsigned int n) {
+	if(n == 0)
+		return 0;
+	uint32_t v = flac_peek(b) >> (64 - n);
+	b->pos += n;
+	return v;
+}
+
+static inline int32_t flac_sbits(FlacBits* b, unsigned int n) {
+	if(n == 0)
+		return 0;
+	uint32_t v = flac_bits(b, n);
+	return (int32_t) (v << (32 - n)) >> (32 - n);
+}
+
+static inline uint32_t flac_unary(FlacBits* b) {
+	uint32_t count = 0;
+	while(b->pos < b->size * 8) {
+		uint64_t w = flac_peek(b);
+		if(w != 0) {
+			unsigned int z = __builtin_clzll(w);
+			b->pos += z + 1;
+			return count + z;
+		}
+		count += 56;
+		b->pos += 56;
+	}
+	return count;
+}
+
+static inline int flac_overrun(const FlacBits* b) {
+	return b->pos > b->size * 8;
+}
+
+
+static uint8_t flac_crc8(const unsigned char* p, size_t n) {
+	uint8_t crc = 0;
+	for(size_t i=0; i<n; i++) {
+		crc ^= p[i];
+		for(int k=0; k<8; k++)
+			crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+	}
+	return crc;
+}
+
+static uint16_t flac_crc16_table[256];
+static pthread_once_t flac_crc16_once = PTHREAD_ONCE_INIT;
+
+static void flac_crc16_init(void) {
+	for(int i=0; i<256; i++) {
+		uint16_t c = i << 8;
+		for(int k=0; k<8; k++)
+			c = c & 0x8000 ? (c << 1) ^ 0x8005 : c << 1;
+		flac_crc16_table[i] = c;
+	}
+}
+
+static uint16_t flac_crc16(const unsigned char* p, size_t n) {
+	pthread_once(&flac_crc16_once, flac_crc16_init);
+	uint16_t crc = 0;
+	for(size_t i=0; i<n; i++)
+		crc = (crc << 8) ^ flac_crc16_table[(crc >> 8) ^ p[i]];
+	return crc;
+}
+
+
+// -----
+
+typedef struct FlacHeader {
+	unsigned int block;
+	unsigned int assignment;
+	unsigned int bps;
+	uint64_t number;
+	int variable;
+	size_t size; // header bytes, crc included
+} FlacHeader;
+
+// parses a frame header at p, returns 0 when it is not one
+static int flac_header(const unsigned char* p, size_t avail, const FlacInfo* info, FlacHeader* h) {
+	if(avail < 6 || p[0] != 0xFF || (p[1] & 0xFE) != 0xF8)
+		return 0;
+	
+	h->variable = p[1] & 1;
+	unsigned int bs = p[2] >> 4;
+	unsigned int sr = p[2] & 0xF;
+	h->assignment = p[3] >> 4;
+	unsigned int ss = (p[3] >> 1) & 7;
+	if(bs == 0 || sr == 0xF || h->assignment > 10 || ss == 3 || (p[3] & 1))
+		return 0;
+	
+  // utf-8 style coded frame or sample number
+	size_t i = 4;
+	uint64_t v = p[i++];
+	int extra = 0;
+	if(v < 0x80) extra = 0;
+	else if((v & 0xE0) == 0xC0) { extra = 1; v &= 0x1F; }
+	else if((v & 0xF0) == 0xE0) { extra = 2; v &= 0x0F; }
+	else if((v & 0xF8) == 0xF0) { extra = 3; v &= 0x07; }
+	else if((v & 0xFC) == 0xF8) { extra = 4; v &= 0x03; }
+	else if((v & 0xFE) == 0xFC) { extra = 5; v &= 0x01; }
+	else if(v == 0xFE) { extra = 6; v = 0; }
+	else return 0;
+	if(i + extra + 4 > avail)
+		return 0;
+	for(int k=0; k<extra; k++) {
+		if((p[i] & 0xC0) != 0x80)
+			return 0;
+		v = (v << 6) | (p[i++] & 0x3F);
+	}
+	h->number = v;
+	
+	if(bs == 1) h->block = 192;
+	else if(bs <= 5) h->block = 576 << (bs - 2);
+	else if(bs == 6) h->block = p[i++] + 1;
+	else if(bs == 7) { h->block = ((p[i] << 8) | p[i+1]) + 1; i += 2; }
+	else h->block = 256 << (bs - 8);
+	
+	if(sr == 12) i += 1;
+	else if(sr == 13 || sr == 14) i += 2;
+	
+	static const unsigned int sizes[8] = {0, 8, 12, 0, 16, 20, 24, 32};
+	h->bps = ss == 0 ? info->bps : sizes[ss];
+	
+	if(i + 1 > avail || flac_crc8(p, i) != p[i])
+		return 0;
+	h->size = i + 1;
+	
+	unsigned int channels = h->assignment < 8 ? h->assignment + 1 : 2;
+	return channels == info->channels && h->bps == info->bps && h->block <= FLAC_MAX_BLOCK;
+}
+
+
+// -----
+
+static int flac_residual(FlacBits* b, int32_t* out, unsigned int block, unsigned int order) {
+	unsigned int method = flac_bits(b, 2);
+	if(method > 1)
+		return 0;
+	unsigned int param_bits = method == 0 ? 4 : 5;
+	unsigned int escape = method == 0 ? 15 : 31;
+	unsigned int porder = flac_bits(b, 4);
+	unsigned int parts = 1 << porder;
+	if((block >> porder) < order || (block & (parts - 1)) != 0)
+		return 0;
+	
+	size_t i = order;
+	for(unsigned int part=0; part<parts; part++) {
+		size_t n = (block >> porder) - (part == 0 ? order : 0);
+		unsigned int param = flac_bits(b, param_bits);
+		if(param == escape) {
+			unsigned int raw = flac_bits(b, 5);
+			for(size_t k=0; k<n; k++)
+				out[i++] = flac_sbits(b, raw);
+		} else {
+			for(size_t k=0; k<n; k++) {
+				uint32_t v = (flac_unary(b) << param) | flac_bits(b, param);
+				out[i++] = (int32_t) (v >> 1) ^ -(int32_t) (v & 1);
+			}
+		}
+		if(flac_overrun(b))
+			return 0;
+	}
+	return 1;
+}
+
+static int flac_subframe(FlacBits* b, int32_t* out, unsigned int block, unsigned int bps) {
+	if(flac_bits(b, 1) != 0)
+		return 0;
+	unsigned int type = flac_bits(b, 6);
+	unsigned int wasted = 0;
+	if(flac_bits(b, 1))
+		wasted = flac_unary(b) + 1;
+	if(wasted >= bps)
+		return 0;
+	bps -= wasted;
+	
+	if(type == 0) {
+		int32_t v = flac_sbits(b, bps);
+		for(unsigned int i=0; i<block; i++)
+			out[i] = v;
+	} else if(type == 1) {
+		for(unsigned int i=0; i<block; i++)
+			out[i] = flac_sbits(b, bps);
+	} else if(type >= 8 && type <= 12) {
+		unsigned int order = type - 8;
+		if(order > block)
+			return 0;
+		for(unsigned int i=0; i<order; i++)
+			out[i] = flac_sbits(b, bps);
+		if(!flac_residual(b, out, block, order))
+			return 0;
+		switch(order) {
+			case 1:
+				for(unsigned int i=1; i<block; i++)
+					out[i] += out[i-1];
+				break;
+			case 2:
+				for(unsigned int i=2; i<block; i++)
+					out[i] += 2 * out[i-1] - out[i-2];
+				break;
+			case 3:
+				for(unsigned int i=3; i<block; i++)
+					out[i] += 3 * out[i-1] - 3 * out[i-2] + out[i-3];
+				break;
+			case 4:
+				for(unsigned int i=4; i<block; i++)
+					out[i] += 4 * out[i-1] - 6 * out[i-2] + 4 * out[i-3] - out[i-4];
+				break;
+		}
+	} else if(type >= 32) {
+		unsigned int order = type - 31;
+		if(order > block)
+			return 0;
+		for(unsigned int i=0; i<order; i++)
+			out[i] = flac_sbits(b, bps);
+		unsigned int precision = flac_bits(b, 4) + 1;
+		int shift = flac_sbits(b, 5);
+		if(precision == 16 || shift < 0)
+			return 0;
+		int32_t coefs[32];
+		for(unsigned int i=0; i<order; i++)
+			coefs[i] = flac_sbits(b, precision);
+		if(!flac_residual(b, out, block, order))
+			return 0;
+		for(unsigned int i=order; i<block; i++) {
+			int64_t sum = 0;
+			for(unsigned int k=0; k<order; k++)
+				sum += (int64_t) coefs[k] * out[i - k - 1];
+			out[i] += (int32_t) (sum >> shift);
+		}
+	} else {
+		return 0;
+	}
+	
+	if(wasted)
+		for(unsigned int i=0; i<block; i++)
+			out[i] = (int32_t) ((uint32_t) out[i] << wasted);
+	return !flac_overrun(b);
+}
+
+// decodes one frame into interleaved 16 bit pcm, or 32 bit float for deeper
+// streams; scratch holds channels * block samples
+static int flac_frame(const unsigned char* data, size_t size, const FlacInfo* info, void* out, int32_t* scratch) {
+	FlacHeader h;
+	if(!flac_header(data, size, info, &h))
+		return 0;
+	
+	FlacBits b = {data, size, h.size * 8};
+	unsigned int channels = info->channels;
+	for(unsigned int c=0; c<channels; c++) {
+	  // the side channel carries one extra bit
+		unsigned int bps = h.bps;
+		if((h.assignment == 8 && c == 1) || (h.assignment == 9 && c == 0) || (h.assignment == 10 && c == 1))
+			bps++;
+		if(!flac_subframe(&b, scratch + c * h.block, h.block, bps))
+			return 0;
+	}
+	
+	int32_t* a = scratch;
+	int32_t* s = scratch + h.block;
+	if(h.assignment == 8) {
+		for(unsigned int i=0; i<h.block; i++)
+			s[i] = a[i] - s[i];
+	} else if(h.assignment == 9) {
+		for(unsigned int i=0; i<h.block; i++)
+			a[i] += s[i];
+	} else if(h.assignment == 10) {
+		for(unsigned int i=0; i<h.block; i++) {
+			int32_t mid = (int32_t) ((uint32_t) a[i] << 1) | (s[i] & 1);
+			a[i] = (mid + s[i]) >> 1;
+			s[i] = (mid - s[i]) >> 1;
+		}
+	}
+	
+	for(unsigned int c=0; c<channels; c++) {
+		const int32_t* in = scratch + c * h.block;
+		if(info->bps <= 16) {
+			short* o = (short*) out + c;
+			unsigned int up = 16 - info->bps;
+			for(unsigned int i=0; i<h.block; i++)
+				o[i * channels] = (short) (in[i] * (1 << up));
+		} else {
+			float* o = (float*) out + c;
+			float scale = 1.0f / (1 << (info->bps - 1));
+			for(unsigned int i=0; i<h.block; i++)
+				o[i * channels] = in[i] * scale;
+		}
+	}
+	return 1;
+}
+
+
+// -----
+
+// finds every frame up front; a sync code only counts when its crc-8
+// holds and its number follows on from the previous frame
+static FlacFrame* flac_index(const unsigned char* data, size_t size, size_t start, const FlacInfo* info, size_t* count) {
+	size_t cap = 1024;
+	size_t n = 0;
+	FlacFrame* frames = malloc(cap * sizeof(FlacFrame));
+	if(frames == 0)
+		return 0;
+	
+	uint64_t expect = 0;
+	uint64_t first = 0;
+	for(size_t p=start; p + 6 <= size; p++) {
+		if(data[p] != 0xFF || (data[p+1] & 0xFE) != 0xF8)
+			continue;
+		FlacHeader h;
+		if(!flac_header(data + p, size - p, info, &h))
+			continue;
+		if(h.number != expect && n > 0)
+			continue;
+		if(n == cap) {
+			FlacFrame* f = realloc(frames, (cap *= 2) * sizeof(FlacFrame));
+			if(f == 0) {
+				free(frames);
+				return 0;
+			}
+			frames = f;
+		}
+		if(n > 0)
+			frames[n-1].size = p - frames[n-1].offset;
+		frames[n].offset = p;
+		frames[n].first = first;
+		frames[n].block = h.block;
+		n++;
+		first += h.block;
+		expect = h.variable ? first : h.number + 1;
+		p += h.size - 1;
+	}
+	if(n > 0)
+		frames[n-1].size = size - frames[n-1].offset;
+	*count = n;
+	return frames;
+}
+
+typedef struct FlacJob {
+	const unsigned char* data;
+	const FlacInfo* info;
+	const FlacFrame* frames;
+	size_t count;
+	unsigned char* out;
+	size_t frame_size; // bytes per pcm frame of out
+	atomic_int failed;
+} FlacJob;
+
+static void flac_job(void* ctx, size_t job) {
+	FlacJob* j = ctx;
+	int32_t* scratch = malloc(1 * j->info->channels * FLAC_MAX_BLOCK * sizeof(int32_t));
+	if(scratch == 0) {
+		atomic_store(&j->failed, 1);
+		return;
+	}
+	
+	size_t end = (job + 1) * FLAC_FRAMES_PER_JOB;
+	if(end > j->count)
+		end = j->count;
+	for(size_t i=job * FLAC_FRAMES_PER_JOB; i<end && !atomic_load(&j->failed); i++) {
+		const FlacFrame* f = &j->frames[i];
+		
+	  // the crc-16 footer confirms the frame really ends where the next starts
+		if(f->size < 2 || flac_crc16(j->data + f->offset, f->size) != 0
+			|| !flac_frame(j->data + f->offset, f->size, j->info, j->out + f->first * j->frame_size, scratch))
+			atomic_store(&j->failed, 1);
+	}
+	free(scratch);
+}
+
+
+WaveData* flac_parse(unsigned char* buffer, size_t size) {
+	
+	WaveData* data = 0;
+	unsigned char* pcm = 0;
+	FlacFrame* frames = 0;
+	
+	if(size < 42 || memcmp(buffer, "fLaC", 4) != 0) {
+		puts("Invalid file header!");
+		goto exit;
+	}
+	
+  // metadata blocks, only streaminfo matters
+	FlacInfo info;
+	memset(&info, 0, sizeof(FlacInfo));
+	size_t pos = 4;
+	int last = 0;
+	while(!last && pos + 4 <= size) {
+		last = buffer[pos] >> 7;
+		unsigned int type = buffer[pos] & 0x7F;
+		size_t len = (buffer[pos+1] << 16) | (buffer[pos+2] << 8) | buffer[pos+3];
+		pos += 4;
+		if(pos + len > size)
+			break;
+		if(type == 0 && len >= 34) {
+			const unsigned char* si = buffer + pos;
+			info.max_block = (si[2] << 8) | si[3];
+			info.sample_rate = (si[10] << 12) | (si[11] << 4) | (si[12] >> 4);
+			info.channels = ((si[12] >> 1) & 7) + 1;
+			info.bps = (((si[12] & 1) << 4) | (si[13] >> 4)) + 1;
+			info.total_frames = ((uint64_t) (si[13] & 0xF) << 32) | ((uint64_t) si[14] << 24) | (si[15] << 16) | (si[16] << 8) | si[17];
+		}
+		pos += len;
+	}
+	if(info.sample_rate == 0 || info.bps < 4 || info.bps > 24) {
+		puts("Unsupported flac stream!");
+		goto exit;
+	}
+	
+	size_t count = 0;
+	frames = flac_index(buffer, size, pos, &info, &count);
+	if(frames == 0 || count == 0) {
+		puts("No flac frames found!");
+		goto exit;
+	}
+	
+  // AL has nothing deeper than 16 bit integers, wider streams become float
+	uint64_t total = frames[count-1].first + frames[count-1].block;
+	size_t width = info.bps > 16 ? sizeof(float) : sizeof(short);
+	pcm = malloc(1 * total * info.channels * width);
+	if(pcm == 0) {
+		puts("Could not allocate memory.");
+		goto exit;
+	}
+	
+	FlacJob job;
+	job.data = buffer;
+	job.info = &info;
+	job.frames = frames;
+	job.count = count;
+	job.out = pcm;
+	job.frame_size = info.channels * width;
+	atomic_init(&job.failed, 0);
+	size_t jobs = (count + FLAC_FRAMES_PER_JOB - 1) / FLAC_FRAMES_PER_JOB;
+	if(count < FLAC_PARALLEL_FRAMES) {
+		for(size_t i=0; i<jobs; i++)
+			flac_job(&job, i);
+	} else {
+		pool_run(flac_job, &job, jobs);
+	}
+	if(atomic_load(&job.failed)) {
+		puts("Corrupt flac frame!");
+		goto exit;
+	}
+	
+	data = calloc(1, sizeof(WaveData));
+	if(data == 0) {
+		puts("Could not allocate memory.");
+		goto exit;
+	}
+	data->format = width == sizeof(float) ? WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM;
+	data->channels = info.channels;
+	data->bps = width * 8;
+	data->sample_rate = info.sample_rate;
+	data->block_align = info.channels * width;
+	data->sound_size = total * info.channels * width;
+	data->data = pcm;
+	data->sound_data = pcm;
+	
+	free(frames);
+	free(buffer);
+	return data;
+	
+exit:
+	free(frames);
+	free(pcm);
+	free(buffer);
+	return 0;
+}
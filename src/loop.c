@@ -0,0 +1,139 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "loop.h"
+#include "account.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "AL/al.h"
+
+#define LOOP_POLL_NS 2000000
+
+
+static pthread_mutex_t loop_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int* loop_sources = 0;
+static size_t loop_count = 0;
+static size_t loop_cap = 0;
+static int loop_running = 0;
+
+static void loop_remove(size_t i) {
+	loop_sources[i] = loop_sources[--loop_count];
+}
+
+// runs while any source is waiting on its intro, then exits
+static void* loop_service(void* arg) {
+	for(;;) {
+		pthread_mutex_lock(&loop_lock);
+		for(size_t i=0; i<loop_count; ) {
+			unsigned int source = loop_sources[i];
+			if(!alIsSource(source)) {
+				loop_remove(i);
+				continue;
+			}
+			
+			int state = 0;
+			int processed = 0;
+			alGetSourcei(source, AL_SOURCE_STATE, &state);
+			alGetSourcei(source, AL_BUFFERS_PROCESSED, &processed);
+			
+		  // stopped by the caller, or the loop ran out before we got here
+			if(state == AL_STOPPED) {
+				loop_remove(i);
+				continue;
+			}
+			if(processed > 0) {
+				unsigned int intro = 0;
+				account_unqueue_buffers(source, 1, &intro);
+				alSourcei(source, AL_LOOPING, AL_TRUE);
+				loop_remove(i);
+				continue;
+			}
+			i++;
+		}
+		if(loop_count == 0) {
+			loop_running = 0;
+			pthread_mutex_unlock(&loop_lock);
+			return 0;
+		}
+		pthread_mutex_unlock(&loop_lock);
+		
+		struct timespec ts = {0, LOOP_POLL_NS};
+		nanosleep(&ts, 0);
+	}
+}
+
+int loop_play(unsigned int source, unsigned int intro, unsigned int loop) {
+	
+	pthread_mutex_lock(&loop_lock);
+	if(loop_count == loop_cap) {
+		size_t cap = loop_cap ? loop_cap * 2 : 8;
+		unsigned int* sources = realloc(loop_sources, cap * sizeof(unsigned int));
+		if(sources == 0) {
+			puts("Could not allocate memory.");
+			pthread_mutex_unlock(&loop_lock);
+			return 0;
+		}
+		loop_sources = sources;
+		loop_cap = cap;
+	}
+	
+	unsigned int buffers[2] = {intro, loop};
+	alSourceStop(source);
+	alSourcei(source, AL_LOOPING, AL_FALSE);
+	alSourcei(source, AL_BUFFER, 0);
+	account_queue_buffers(source, 2, buffers);
+	alSourcePlay(source);
+	
+	for(size_t i=0; i<loop_count; i++)
+		if(loop_sources[i] == source)
+			loop_remove(i);
+	loop_sources[loop_count++] = source;
+	
+	if(!loop_running) {
+		pthread_t thread;
+		if(pthread_create(&thread, 0, loop_service, 0) != 0) {
+			puts("Could not start loop thread.");
+			loop_count--;
+			pthread_mutex_unlock(&loop_lock);
+			return 0;
+		}
+		pthread_detach(thread);
+		loop_running = 1;
+	}
+	pthread_mutex_unlock(&loop_lock);
+	return 1;
+}
+
+void loop_forget(unsigned int source) {
+	pthread_mutex_lock(&loop_lock);
+	for(size_t i=0; i<loop_count; i++)
+		if(loop_sources[i] == source)
+			loop_remove(i);
+	pthread_mutex_unlock(&loop_lock);
+}
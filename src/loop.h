@@ -0,0 +1,37 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// Intro-then-loop playback for implementations without AL_SOFT_loop_points.
+// Both buffers are queued on the source; a shared service thread notices
+// when the intro has played, unqueues it and turns on AL_LOOPING, so the
+// loop buffer repeats on its own. The switch happens while the loop buffer
+// plays, which keeps it gapless for loops longer than a couple of ms.
+
+// queues intro and loop on source and starts it, returns 0 on failure
+int loop_play(unsigned int source, unsigned int intro, unsigned int loop);
+
+// stops watching source, e.g. before it is stopped or deleted
+void loop_forget(unsigned int source);
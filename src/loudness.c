@@ -0,0 +1,322 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "loudness.h"
+#include "adpcm.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE__)
+#	include <xmmintrin.h>
+#endif
+
+#define LOUDNESS_TAPS	12 // per phase of the 4x true peak interpolator
+#define LOUDNESS_LANES	4 // channels filtered side by side
+
+
+typedef struct LoudnessBiquad {
+	float b0, b1, b2, a1, a2;
+} LoudnessBiquad;
+
+// the two K-weighting stages, a high shelf and the RLB high pass, derived
+// for any rate from the analog prototypes behind the 48 kHz coefficients
+static void loudness_kweighting(unsigned int rate, LoudnessBiquad* shelf, LoudnessBiquad* highpass) {
+	double k = tan(M_PI * 1681.974450955533 / rate);
+	double q = 0.7071752369554196;
+	double vh = pow(10, 3.999843853973347 / 20);
+	double vb = pow(vh, 0.4996667741545416);
+	double a0 = 1 + k / q + k * k;
+	shelf->b0 = (vh + vb * k / q + k * k) / a0;
+	shelf->b1 = 2 * (k * k - vh) / a0;
+	shelf->b2 = (vh - vb * k / q + k * k) / a0;
+	shelf->a1 = 2 * (k * k - 1) / a0;
+	shelf->a2 = (1 - k / q + k * k) / a0;
+	
+	k = tan(M_PI * 38.13547087602444 / rate);
+	q = 0.5003270373238773;
+	a0 = 1 + k / q + k * k;
+	highpass->b0 = 1;
+	highpass->b1 = -2;
+	highpass->b2 = 1;
+	highpass->a1 = 2 * (k * k - 1) / a0;
+	highpass->a2 = (1 - k / q + k * k) / a0;
+}
+
+// hann windowed sinc, each phase scaled to unity gain at dc
+static void loudness_interpolator(float h[4][LOUDNESS_TAPS]) {
+	for(int p=0; p<4; p++) {
+		double sum = 0;
+		for(int k=0; k<LOUDNESS_TAPS; k++) {
+			int n = 4 * k + p;
+			double x = (n - (4 * LOUDNESS_TAPS - 1) / 2.0) / 4;
+			double sinc = x == 0 ? 1 : sin(M_PI * x) / (M_PI * x);
+			double window = 0.5 - 0.5 * cos(2 * M_PI * (n + 0.5) / (4 * LOUDNESS_TAPS));
+			h[p][k] = sinc * window;
+			sum += h[p][k];
+		}
+		for(int k=0; k<LOUDNESS_TAPS; k++)
+			h[p][k] /= sum;
+	}
+}
+
+// BS.1770 channel weights for the usual 5.0, 5.1 and 7.1 orders
+static float loudness_weight(unsigned int channels, unsigned int c) {
+	if(channels == 5)
+		return c >= 3 ? 1.41f : 1;
+	if(channels == 6 || channels == 8)
+		return c == 3 ? 0 : c >= 4 ? 1.41f : 1;
+	return 1;
+}
+
+static inline float loudness_sample(const void* pcm, unsigned int bps, size_t i) {
+	if(bps == 8)
+		return (((const unsigned char*) pcm)[i] - 128) * (1.0f / 128);
+	if(bps == 32)
+		return ((const float*) pcm)[i];
+	return ((const short*) pcm)[i] * (1.0f / 32768);
+}
+
+static double loudness_db(double power) {
+	return power > 0 ? 10 * log10(power) : -HUGE_VAL;
+}
+
+
+int loudness_measure(const void* pcm, unsigned int bps, size_t frames, unsigned int channels, unsigned int sample_rate, Loudness* out) {
+	
+	if((bps != 8 && bps != 16 && bps != 32) || channels == 0 || sample_rate == 0) {
+		puts("Unsupported loudness input.");
+		return 0;
+	}
+	
+  // energy per 100 ms segment, gating blocks are four neighbours summed
+	size_t seg_len = sample_rate / 10 ? sample_rate / 10 : 1;
+	size_t full = frames / seg_len;
+	double* seg = calloc(full + 1, sizeof(double));
+	if(seg == 0) {
+		puts("Could not allocate memory.");
+		return 0;
+	}
+	
+	LoudnessBiquad shelf, highpass;
+	loudness_kweighting(sample_rate, &shelf, &highpass);
+	float h[4][LOUDNESS_TAPS];
+	loudness_interpolator(h);
+	
+	double sum_sq = 0;
+	float peak = 0;
+	float true_peak = 0;
+	
+	for(unsigned int c0=0; c0<channels; c0+=LOUDNESS_LANES) {
+		unsigned int lanes = channels - c0 < LOUDNESS_LANES ? channels - c0 : LOUDNESS_LANES;
+		float w[LOUDNESS_LANES] = {0};
+		for(unsigned int l=0; l<lanes; l++)
+			w[l] = loudness_weight(channels, c0 + l);
+		
+	  // twice the interpolator length so the taps read one straight run
+		float hist[2 * LOUDNESS_TAPS][LOUDNESS_LANES];
+		memset(hist, 0, sizeof(hist));
+		size_t pos = 0;
+		size_t in_seg = 0;
+		size_t segment = 0;
+		
+#if defined(__SSE__)
+		__m128 s1a = _mm_setzero_ps(), s2a = _mm_setzero_ps();
+		__m128 s1b = _mm_setzero_ps(), s2b = _mm_setzero_ps();
+		__m128 acc = _mm_setzero_ps();
+		__m128 sq = _mm_setzero_ps();
+		__m128 pk = _mm_setzero_ps();
+		__m128 tp = _mm_setzero_ps();
+		const __m128 weight = _mm_loadu_ps(w);
+		const __m128 sign = _mm_set1_ps(-0.0f);
+#else
+		float s1a[LOUDNESS_LANES] = {0}, s2a[LOUDNESS_LANES] = {0};
+		float s1b[LOUDNESS_LANES] = {0}, s2b[LOUDNESS_LANES] = {0};
+		float acc[LOUDNESS_LANES] = {0};
+		float sq[LOUDNESS_LANES] = {0};
+		float pk[LOUDNESS_LANES] = {0};
+		float tp[LOUDNESS_LANES] = {0};
+#endif
+		
+		for(size_t i=0; i<frames; i++) {
+			float in[LOUDNESS_LANES] = {0};
+			for(unsigned int l=0; l<lanes; l++)
+				in[l] = loudness_sample(pcm, bps, i * channels + c0 + l);
+			memcpy(hist[pos], in, sizeof(in));
+			memcpy(hist[pos + LOUDNESS_TAPS], in, sizeof(in));
+			
+#if defined(__SSE__)
+			__m128 x = _mm_loadu_ps(in);
+			sq = _mm_add_ps(sq, _mm_mul_ps(x, x));
+			pk = _mm_max_ps(pk, _mm_andnot_ps(sign, x));
+			
+		  // transposed direct form II, one channel per lane
+			__m128 y = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(shelf.b0), x), s1a);
+			s1a = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(shelf.b1), x), _mm_mul_ps(_mm_set1_ps(shelf.a1), y)), s2a);
+			s2a = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(shelf.b2), x), _mm_mul_ps(_mm_set1_ps(shelf.a2), y));
+			x = y;
+			y = _mm_add_ps(x, s1b);
+			s1b = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(highpass.b1), x), _mm_mul_ps(_mm_set1_ps(highpass.a1), y)), s2b);
+			s2b = _mm_sub_ps(x, _mm_mul_ps(_mm_set1_ps(highpass.a2), y));
+			acc = _mm_add_ps(acc, _mm_mul_ps(_mm_mul_ps(y, y), weight));
+			
+			const float* run = hist[pos + 1];
+			for(int p=0; p<4; p++) {
+				__m128 v = _mm_setzero_ps();
+				for(int k=0; k<LOUDNESS_TAPS; k++)
+					v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(h[p][k]), _mm_loadu_ps(run + (LOUDNESS_TAPS - 1 - k) * LOUDNESS_LANES)));
+				tp = _mm_max_ps(tp, _mm_andnot_ps(sign, v));
+			}
+#else
+			const float* run = hist[pos + 1];
+			for(int l=0; l<LOUDNESS_LANES; l++) {
+				float x = in[l];
+				sq[l] += x * x;
+				pk[l] = fmaxf(pk[l], fabsf(x));
+				float y = shelf.b0 * x + s1a[l];
+				s1a[l] = shelf.b1 * x - shelf.a1 * y + s2a[l];
+				s2a[l] = shelf.b2 * x - shelf.a2 * y;
+				x = y;
+				y = x + s1b[l];
+				s1b[l] = highpass.b1 * x - highpass.a1 * y + s2b[l];
+				s2b[l] = x - highpass.a2 * y;
+				acc[l] += y * y * w[l];
+				for(int p=0; p<4; p++) {
+					float v = 0;
+					for(int k=0; k<LOUDNESS_TAPS; k++)
+						v += h[p][k] * run[(LOUDNESS_TAPS - 1 - k) * LOUDNESS_LANES + l];
+					tp[l] = fmaxf(tp[l], fabsf(v));
+				}
+			}
+#endif
+			pos = pos + 1 < LOUDNESS_TAPS ? pos + 1 : 0;
+			
+			if(++in_seg == seg_len || i + 1 == frames) {
+				float lane[LOUDNESS_LANES];
+#if defined(__SSE__)
+				_mm_storeu_ps(lane, acc);
+				acc = _mm_setzero_ps();
+#else
+				memcpy(lane, acc, sizeof(lane));
+				memset(acc, 0, sizeof(acc));
+#endif
+				seg[segment++] += (double) lane[0] + lane[1] + lane[2] + lane[3];
+				in_seg = 0;
+			}
+		}
+		
+		float lane_sq[LOUDNESS_LANES], lane_pk[LOUDNESS_LANES], lane_tp[LOUDNESS_LANES];
+#if defined(__SSE__)
+		_mm_storeu_ps(lane_sq, sq);
+		_mm_storeu_ps(lane_pk, pk);
+		_mm_storeu_ps(lane_tp, tp);
+#else
+		memcpy(lane_sq, sq, sizeof(lane_sq));
+		memcpy(lane_pk, pk, sizeof(lane_pk));
+		memcpy(lane_tp, tp, sizeof(lane_tp));
+#endif
+		for(unsigned int l=0; l<lanes; l++) {
+			sum_sq += lane_sq[l];
+			peak = fmaxf(peak, lane_pk[l]);
+			true_peak = fmaxf(true_peak, fmaxf(lane_tp[l], lane_pk[l]));
+		}
+	}
+	
+  // gating over 400 ms blocks with 75% overlap; shorter sounds are one block
+	size_t blocks = full >= 4 ? full - 3 : 1;
+	double* z = malloc(blocks * sizeof(double));
+	if(z == 0) {
+		puts("Could not allocate memory.");
+		free(seg);
+		return 0;
+	}
+	if(full >= 4) {
+		for(size_t j=0; j<blocks; j++)
+			z[j] = (seg[j] + seg[j + 1] + seg[j + 2] + seg[j + 3]) / (4 * seg_len);
+	} else {
+		double total = 0;
+		for(size_t j=0; j<=full; j++)
+			total += seg[j];
+		z[0] = frames > 0 ? total / frames : 0;
+	}
+	
+	double gated = 0;
+	size_t count = 0;
+	for(size_t j=0; j<blocks; j++)
+		if(-0.691 + loudness_db(z[j]) > -70) {
+			gated += z[j];
+			count++;
+		}
+	double relative = count > 0 ? -0.691 + loudness_db(gated / count) - 10 : HUGE_VAL;
+	gated = 0;
+	count = 0;
+	for(size_t j=0; j<blocks; j++) {
+		double l = -0.691 + loudness_db(z[j]);
+		if(l > -70 && l > relative) {
+			gated += z[j];
+			count++;
+		}
+	}
+	
+	out->integrated = count > 0 ? -0.691 + loudness_db(gated / count) : -HUGE_VAL;
+	out->true_peak = 2 * loudness_db(true_peak);
+	out->sample_peak = 2 * loudness_db(peak);
+	out->rms = frames > 0 ? loudness_db(sum_sq / ((double) frames * channels)) : -HUGE_VAL;
+	
+	free(z);
+	free(seg);
+	return 1;
+}
+
+int loudness_wave(const WaveData* wd, Loudness* out) {
+	if(wd->format == WAVE_FORMAT_PCM || wd->format == WAVE_FORMAT_IEEE_FLOAT)
+		return loudness_measure(wd->sound_data, wd->bps, wd->sound_size / (wd->channels * (wd->bps / 8)), wd->channels, wd->sample_rate, out);
+	
+	int ima = wd->format == WAVE_FORMAT_IMA_ADPCM;
+	size_t frames = ima
+		? adpcm_ima_frames(wd->sound_size, wd->channels, wd->block_align)
+		: adpcm_ms_frames(wd->sound_size, wd->channels, wd->block_align);
+	short* pcm = malloc(1 * (frames ? frames : 1) * wd->channels * sizeof(short));
+	if(pcm == 0) {
+		puts("Could not allocate memory.");
+		return 0;
+	}
+	frames = ima
+		? adpcm_ima_decode(wd->sound_data, wd->sound_size, wd->channels, wd->block_align, pcm)
+		: adpcm_ms_decode(wd->sound_data, wd->sound_size, wd->channels, wd->block_align, pcm);
+	int ok = loudness_measure(pcm, 16, frames, wd->channels, wd->sample_rate, out);
+	free(pcm);
+	return ok;
+}
+
+double loudness_gain(const Loudness* l, double target, double peak_limit) {
+	if(!isfinite(l->integrated))
+		return 1;
+	double db = target - l->integrated;
+	if(isfinite(l->true_peak) && l->true_peak + db > peak_limit)
+		db = peak_limit - l->true_peak;
+	return pow(10, db / 20);
+}
@@ -0,0 +1,47 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include "wave.h"
+
+// ITU-R BS.1770 / EBU R128 measurements of a whole sound
+typedef struct Loudness {
+	double integrated; // LUFS, -HUGE_VAL when everything is gated away
+	double true_peak; // dBTP, from 4x oversampling
+	double sample_peak; // dBFS
+	double rms; // dBFS over all channels, unweighted
+} Loudness;
+
+// measures interleaved 8 bit unsigned, 16 bit signed or 32 bit float pcm, returns 0 on failure
+int loudness_measure(const void* pcm, unsigned int bps, size_t frames, unsigned int channels, unsigned int sample_rate, Loudness* out);
+
+// same for a loaded sound, decoding a copy of adpcm on the way
+int loudness_wave(const WaveData* wd, Loudness* out);
+
+// linear gain bringing l to target LUFS without pushing the true peak
+// above peak_limit dBTP
+double loudness_gain(const Loudness* l, double target, double peak_limit);
@@ -0,0 +1,122 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "mapfile.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#endif
+
+
+#if defined(_WIN32) || defined(_WIN64)
+
+int mapfile_open(MappedFile* mf, const char* path) {
+	memset(mf, 0, sizeof(MappedFile));
+	
+	HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if(f == INVALID_HANDLE_VALUE) {
+		puts("Could not open file.");
+		return 0;
+	}
+	
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(f, &size) || size.QuadPart == 0) {
+		puts("Could not map empty file.");
+		CloseHandle(f);
+		return 0;
+	}
+	
+	HANDLE m = CreateFileMappingA(f, 0, PAGE_READONLY, 0, 0, 0);
+	CloseHandle(f); // the mapping keeps its own reference to the file
+	if(m == 0) {
+		puts("Could not map file.");
+		return 0;
+	}
+	
+	void* view = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+	if(view == 0) {
+		puts("Could not map file.");
+		CloseHandle(m);
+		return 0;
+	}
+	
+	mf->data = view;
+	mf->size = (size_t) size.QuadPart;
+	mf->handle = m;
+	return 1;
+}
+
+void mapfile_close(MappedFile* mf) {
+	if(mf->data)
+		UnmapViewOfFile(mf->data);
+	if(mf->handle)
+		CloseHandle(mf->handle);
+	memset(mf, 0, sizeof(MappedFile));
+}
+
+#else
+
+int mapfile_open(MappedFile* mf, const char* path) {
+	memset(mf, 0, sizeof(MappedFile));
+	
+	int fd = open(path, O_RDONLY);
+	if(fd < 0) {
+		puts("Could not open file.");
+		return 0;
+	}
+	
+	struct stat st;
+	if(fstat(fd, &st) != 0 || st.st_size == 0) {
+		puts("Could not map empty file.");
+		close(fd);
+		return 0;
+	}
+	
+	void* view = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd); // the mapping keeps its own reference to the file
+	if(view == MAP_FAILED) {
+		puts("Could not map file.");
+		return 0;
+	}
+	
+	mf->data = view;
+	mf->size = (size_t) st.st_size;
+	return 1;
+}
+
+void mapfile_close(MappedFile* mf) {
+	if(mf->data)
+		munmap(mf->data, mf->size);
+	memset(mf, 0, sizeof(MappedFile));
+}
+
+#endif
@@ -25,6 +25,8 @@ SOFTWARE.
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
+#include <stdint.h>
 
 
 #include "AL/al.h"
@@ -36,6 +38,66 @@ SOFTWARE.
 
 
 #include "wave.h"
+#include "bank.h"
+#include "cache.h"
+#include "resample.h"
+#include "sound.h"
+#include "stream.h"
+#include "batch.h"
+#include "synth.h"
+#include "samples.h"
+#include "loop.h"
+#include "loudness.h"
+#include "trim.h"
+#include "convolve.h"
+#include "capture.h"
+#include "record.h"
+#include "account.h"
+#include "feed.h"
+
+#if defined(OPENLUAL_STATS)
+#	include "stats.h"
+#endif
+#if defined(OPENLUAL_TRACE)
+#	include "trace.h"
+#	if defined(_WIN32) || defined(_WIN64)
+#		include <windows.h>
+#	else
+#		include <time.h>
+#	endif
+#endif
+#include "clock.h"
+
+
+#include "adpcm.h"
+
+
+// extension enums, al.h only carries the core ones
+#define AL_FORMAT_MONO_IMA4				0x1300
+#define AL_FORMAT_STEREO_IMA4			0x1301
+#define AL_FORMAT_MONO_MSADPCM_SOFT		0x1302
+#define AL_FORMAT_STEREO_MSADPCM_SOFT	0x1303
+#define AL_UNPACK_BLOCK_ALIGNMENT_SOFT	0x200C
+#define AL_FORMAT_MONO_FLOAT32			0x10010
+#define AL_FORMAT_STEREO_FLOAT32		0x10011
+#define AL_FORMAT_QUAD8					0x1204
+#define AL_FORMAT_QUAD16				0x1205
+#define AL_FORMAT_QUAD32				0x1206
+#define AL_FORMAT_REAR8					0x1207
+#define AL_FORMAT_REAR16				0x1208
+#define AL_FORMAT_REAR32				0x1209
+#define AL_FORMAT_51CHN8				0x120A
+#define AL_FORMAT_51CHN16				0x120B
+#define AL_FORMAT_51CHN32				0x120C
+#define AL_FORMAT_61CHN8				0x120D
+#define AL_FORMAT_61CHN16				0x120E
+#define AL_FORMAT_61CHN32				0x120F
+#define AL_FORMAT_71CHN8				0x1210
+#define AL_FORMAT_71CHN16				0x1211
+#define AL_FORMAT_71CHN32				0x1212
+#define AL_LOOP_POINTS_SOFT				0x2015
+#define AL_SAMPLE_OFFSET_LATENCY_SOFT	0x1200
+#define AL_SEC_OFFSET_LATENCY_SOFT		0x1201
 
 
 #if defined(_WIN32) || defined(_WIN64)
@@ -264,11 +326,13 @@ static int lua_alGetListener3i(lua_State* L) {
 
 // --
 
+// the optional tag names the call site in resources()
 static int lua_alGenSources(lua_State* L) {
 	int psize = luaL_checknumber(L, 1);
+	const char* tag = luaL_optstring(L, 2, 0);
 	
 	unsigned int* ints = malloc(1 * psize * sizeof(unsigned int));
-	alGenSources(psize, ints);
+	account_gen_sources(psize, ints, tag);
 	
 	lua_createtable(L, psize, 0);
 	for(int i=0; i<psize; i++) {
@@ -292,7 +356,7 @@ static int lua_alDeleteSources(lua_State* L) {
 		lua_pop(L, 1); // number
 	}
 	
-	alDeleteSources(psize, ints);
+	account_delete_sources(psize, ints);
 	
 	free(ints);
 	return 0;
@@ -367,6 +431,55 @@ static int lua_alGetSource3i(lua_State* L) {
 	return 3;
 }
 
+// AL_SOFT_source_latency is only reachable through alGetProcAddress
+typedef void (*olual_GetSourcedv)(ALuint source, ALenum param, double* values);
+typedef void (*olual_GetSourcei64v)(ALuint source, ALenum param, int64_t* values);
+
+static void* olual_latencyproc(const char* name) {
+	if(!alIsExtensionPresent("AL_SOFT_source_latency"))
+		return 0;
+	return alGetProcAddress(name);
+}
+
+// alGetSourcedvSOFT(source, param) -> values, nil without the extension
+// AL_SEC_OFFSET_LATENCY_SOFT gives the offset and the output latency in
+// seconds
+static int lua_alGetSourcedvSOFT(lua_State* L) {
+	static olual_GetSourcedv proc;
+	if(proc == 0)
+		proc = (olual_GetSourcedv) olual_latencyproc("alGetSourcedvSOFT");
+	lua_checkstack(L, 2);
+	if(proc == 0) {
+		lua_pushnil(L);
+		return 1;
+	}
+	double values[2] = {0, 0};
+	proc(luaL_checknumber(L, 1), luaL_checknumber(L, 2), values);
+	lua_pushnumber(L, values[0]);
+	lua_pushnumber(L, values[1]);
+	return 2;
+}
+
+// alGetSourcei64vSOFT(source, param) -> values, nil without the extension
+// AL_SAMPLE_OFFSET_LATENCY_SOFT gives the offset in frames, its 32.32
+// fixed point value converted, and the output latency in nanoseconds
+static int lua_alGetSourcei64vSOFT(lua_State* L) {
+	static olual_GetSourcei64v proc;
+	if(proc == 0)
+		proc = (olual_GetSourcei64v) olual_latencyproc("alGetSourcei64vSOFT");
+	lua_checkstack(L, 2);
+	if(proc == 0) {
+		lua_pushnil(L);
+		return 1;
+	}
+	int param = luaL_checknumber(L, 2);
+	int64_t values[2] = {0, 0};
+	proc(luaL_checknumber(L, 1), param, values);
+	lua_pushnumber(L, param == AL_SAMPLE_OFFSET_LATENCY_SOFT ? values[0] / 4294967296.0 : (double) values[0]);
+	lua_pushnumber(L, values[1]);
+	return 2;
+}
+
 // --
 
 static int lua_alSourcePlay(lua_State* L) {
@@ -439,9 +552,10 @@ static int lua_alSourceUnqueueBuffers(lua_State* L) {
 
 static int lua_alGenBuffers(lua_State* L) {
 	int psize = luaL_checknumber(L, 1);
+	const char* tag = luaL_optstring(L, 2, 0);
 	
 	unsigned int* ints = malloc(1 * psize * sizeof(unsigned int));
-	alGenBuffers(psize, ints);
+	account_gen_buffers(psize, ints, tag);
 	
 	lua_createtable(L, 0, psize);
 	for(int i=0; i<psize; i++) {
@@ -465,7 +579,7 @@ static int lua_alDeleteBuffers(lua_State* L) {
 		lua_pop(L, 1); // number
 	}
 	
-	alDeleteBuffers(psize, ints);
+	account_delete_buffers(psize, ints);
 	
 	free(ints);
 	
@@ -479,9 +593,23 @@ static int lua_alIsBuffer(lua_State* L) {
 	return 1;
 }
 
+static Samples* olual_tosamples(lua_State* L, int i);
+static int olual_samplesformat(const Samples* s);
+
+// data is a string or a samples userdata; for samples, format, size and
+// frequency may be nil and default to the block's own
 static int lua_alBufferData(lua_State* L) {
 	size_t size = 0;
-	alBufferData(luaL_checknumber(L, 1), luaL_checknumber(L, 2), luaL_checklstring(L, 3, &size), luaL_checknumber(L, 4), luaL_checknumber(L, 5));
+	Samples* samples = olual_tosamples(L, 3);
+	if(samples != 0) {
+		size = samples_size(samples);
+		size_t want = luaL_optnumber(L, 4, size);
+		account_buffer_data(luaL_checknumber(L, 1), luaL_optnumber(L, 2, olual_samplesformat(samples)), samples->data, want < size ? want : size, luaL_optnumber(L, 5, samples->sample_rate));
+		return 0;
+	}
+	const char* data = luaL_checklstring(L, 3, &size);
+	size_t want = luaL_checknumber(L, 4);
+	account_buffer_data(luaL_checknumber(L, 1), luaL_checknumber(L, 2), data, want < size ? want : size, luaL_checknumber(L, 5));
 	return 0;
 }
 
@@ -574,15 +702,19 @@ static int lua_alDistanceModel(lua_State* L) {
 static int lua_alcCreateContext(lua_State* L) {
 	ALCdevice* device = *(ALCdevice**)luaL_checkuserdata(L, 1);
 	int* ints = 0;
-	if(!lua_isnil(L, 2)) {
+	if(!lua_isnoneornil(L, 2)) {
 		luaL_checktable(L, 2);
 		size_t len = luaL_tablelen(L, 2);
-		ints = malloc(1 * len * sizeof(int));
+	  // attribute lists end in a zero the table does not carry
+		ints = malloc(1 * (len + 1) * sizeof(int));
+		if(ints == 0)
+			return luaL_error(L, "alcCreateContext could not allocate memory");
 		for(int i=0; i<len; i++) {
 			lua_rawgeti(L, 2, i+1);
-			ints[i] = lua_tonumber(L, 3);
+			ints[i] = lua_tonumber(L, -1);
 			lua_pop(L, 1); // number
 		}
+		ints[len] = 0;
 	}
 	
 	ALCcontext* context = alcCreateContext(device, ints);
@@ -593,8 +725,12 @@ static int lua_alcCreateContext(lua_State* L) {
 	return 1;
 }
 
+// nil releases the current context
 static int lua_alcMakeContextCurrent(lua_State* L) {
-	char obool = alcMakeContextCurrent(*(ALCcontext**)luaL_checkuserdata(L, 1));
+	ALCcontext* context = 0;
+	if(!lua_isnoneornil(L, 1))
+		context = *(ALCcontext**)luaL_checkuserdata(L, 1);
+	char obool = alcMakeContextCurrent(context);
 	lua_checkstack(L, 1);
 	lua_pushboolean(L, obool);
 	return 1;
@@ -685,17 +821,27 @@ static int lua_alcGetString(lua_State* L) {
 	return 1;
 }
 
+// alcGetIntegerv(device, param, size [, into]) -> into or a new table
 static int lua_alcGetIntegerv(lua_State* L) {
 	int psize = luaL_checknumber(L, 3);
-	luaL_checktable(L, 4);
-	int* ints = 0;
+	if(psize < 0)
+		psize = 0;
+	int* ints = calloc(psize > 0 ? psize : 1, sizeof(int));
+	if(ints == 0)
+		return luaL_error(L, "alcGetIntegerv could not allocate memory");
 	alcGetIntegerv(*(ALCdevice**)luaL_checkuserdata(L, 1), luaL_checknumber(L, 2), psize, ints);
 	lua_checkstack(L, 1);
-	lua_createtable(L, 0, psize);
+	if(lua_isnoneornil(L, 4)) {
+		lua_createtable(L, psize, 0);
+	} else {
+		luaL_checktable(L, 4);
+		lua_pushvalue(L, 4);
+	}
 	for(int i=0; i<psize; i++) {
 		lua_pushnumber(L, ints[i]);
 		lua_rawseti(L, -2, i+1);
 	}
+	free(ints);
 	return 1;
 }
 
@@ -724,29 +870,312 @@ static int lua_alcCaptureStop(lua_State* L) {
 	return 0;
 }
 
+// alcCaptureSamples(device, format, samples) -> pcm string
+// samples counts frames of the format the device was opened with, which
+// sizes the string; the argument used to be ignored, so nil still means
+// AL_FORMAT_MONO16
 static int lua_alcCaptureSamples(lua_State* L) {
 	ALCdevice* device = *(ALCdevice**)luaL_checkuserdata(L, 1);
+	unsigned int channels, bps;
+	int format = lua_isnoneornil(L, 2) ? AL_FORMAT_MONO16 : luaL_checknumber(L, 2);
+	if(!capture_layout(format, &channels, &bps))
+		return luaL_error(L, "alcCaptureSamples expects the capture format or nil for mono 16 bit as argument 2");
+	size_t frame = channels * bps / 8;
 	int psamples = luaL_checknumber(L, 3);
 	int samples = 0;
 	alcGetIntegerv(device, ALC_CAPTURE_SAMPLES, 1, &samples);
 	if(psamples <= samples)
 		samples = psamples;
-	char* obuffer = malloc(1 * samples * sizeof(char));
+	if(samples < 0)
+		samples = 0;
+	char* obuffer = malloc(1 * (samples > 0 ? samples : 1) * frame);
+	if(obuffer == 0)
+		return luaL_error(L, "alcCaptureSamples could not allocate memory");
 	alcCaptureSamples(device, obuffer, samples);
-	lua_pushlstring(L, obuffer, 1 * samples * sizeof(char));
+	lua_checkstack(L, 1);
+	lua_pushlstring(L, obuffer, 1 * samples * frame);
 	free(obuffer);
 	return 1;
 }
 
 // -----
 
+// picks the AL format matching a plain pcm layout, bps 32 being float; 0
+// when AL has none
+static int olual_format(unsigned int channels, unsigned int bps) {
+	static const int formats[9][3] = {
+		[1] = {AL_FORMAT_MONO8, AL_FORMAT_MONO16, AL_FORMAT_MONO_FLOAT32},
+		[2] = {AL_FORMAT_STEREO8, AL_FORMAT_STEREO16, AL_FORMAT_STEREO_FLOAT32},
+		[4] = {AL_FORMAT_QUAD8, AL_FORMAT_QUAD16, AL_FORMAT_QUAD32},
+		[6] = {AL_FORMAT_51CHN8, AL_FORMAT_51CHN16, AL_FORMAT_51CHN32},
+		[7] = {AL_FORMAT_61CHN8, AL_FORMAT_61CHN16, AL_FORMAT_61CHN32},
+		[8] = {AL_FORMAT_71CHN8, AL_FORMAT_71CHN16, AL_FORMAT_71CHN32}
+	};
+	if(channels > 8 || (bps != 8 && bps != 16 && bps != 32))
+		return 0;
+	return formats[channels][bps == 8 ? 0 : bps == 16 ? 1 : 2];
+}
+
+// the other way around, returns 0 for formats that are not plain pcm
+static int olual_formatlayout(int format, unsigned int* channels, unsigned int* bps) {
+	static const unsigned int depths[3] = {8, 16, 32};
+	for(unsigned int c=1; c<=8; c++)
+		for(int d=0; d<3; d++)
+			if(olual_format(c, depths[d]) == format && format != 0) {
+				*channels = c;
+				*bps = depths[d];
+				return 1;
+			}
+	return 0;
+}
+
+// what the current context can take without conversion
+typedef struct olual_Caps {
+	int ima4;
+	int msadpcm;
+	int block_alignment;
+	int float32;
+	int mcformats;
+	int buffer_samples;
+} olual_Caps;
+
+static void olual_probecaps(olual_Caps* caps) {
+	caps->ima4 = alIsExtensionPresent("AL_EXT_IMA4");
+	caps->msadpcm = alIsExtensionPresent("AL_SOFT_MSADPCM");
+	caps->block_alignment = alIsExtensionPresent("AL_SOFT_block_alignment");
+	caps->float32 = alIsExtensionPresent("AL_EXT_FLOAT32");
+	caps->mcformats = alIsExtensionPresent("AL_EXT_MCFORMATS");
+	caps->buffer_samples = alIsExtensionPresent("AL_SOFT_buffer_samples");
+}
+
+// whether alBufferData takes this plain pcm layout on the current context
+static int olual_supported(const olual_Caps* caps, unsigned int channels, unsigned int bps) {
+	return olual_format(channels, bps) != 0 && (bps != 32 || caps->float32) && (channels <= 2 || caps->mcformats);
+}
+
+// brings decoded pcm to the best layout the context mixes as it is: float
+// stays float with AL_EXT_FLOAT32 and up to 7.1 stays apart with
+// AL_EXT_MCFORMATS; the multichannel float formats need both. Anything
+// else is narrowed to 16 bit or folded down to stereo. AL_SOFT_buffer_samples
+// has its own entry point and enums, uploads here stay on alBufferData so
+// it is only reported by formats().
+static int olual_fitwave(WaveData* wd, const olual_Caps* caps) {
+	if(wd->bps == 32 && !caps->float32 && !wave_convert(wd, 16, 0, 0))
+		return 0;
+	if(!olual_supported(caps, wd->channels, wd->bps) && !wave_downmix(wd))
+		return 0;
+	return olual_supported(caps, wd->channels, wd->bps);
+}
+
+// CacheFitFn over olual_fitwave
+static int olual_fitcache(WaveData* wd, void* caps) {
+	return olual_fitwave(wd, caps);
+}
+
+// names what olual_fitwave keeps, so cached blobs fitted for one context
+// are not handed to another
+static unsigned int olual_capslayout(const olual_Caps* caps) {
+	return (caps->float32 ? 1 : 0) | (caps->mcformats ? 2 : 0);
+}
+
+// the AL format that takes wd's adpcm blocks as is, 0 when it must be decoded
+static int olual_adpcmformat(const WaveData* wd, const olual_Caps* caps) {
+	if(wd->channels > 2)
+		return 0;
+	if(wd->format == WAVE_FORMAT_IMA_ADPCM && caps->ima4
+		&& (caps->block_alignment || wd->samples_per_block == 65))
+		return wd->channels == 1 ? AL_FORMAT_MONO_IMA4 : AL_FORMAT_STEREO_IMA4;
+	if(wd->format == WAVE_FORMAT_ADPCM && caps->msadpcm
+		&& (caps->block_alignment || wd->samples_per_block == 64))
+		return wd->channels == 1 ? AL_FORMAT_MONO_MSADPCM_SOFT : AL_FORMAT_STEREO_MSADPCM_SOFT;
+	return 0;
+}
+
+// BatchKeepFn over olual_adpcmformat
+static int olual_keepadpcm(const WaveData* wd, void* caps) {
+	return olual_adpcmformat(wd, caps) != 0;
+}
+
+// the AL format for a loaded sound, either adpcm kept by olual_keepadpcm or pcm
+static int olual_waveformat(const WaveData* wd, const olual_Caps* caps) {
+	int format = olual_adpcmformat(wd, caps);
+	return format ? format : olual_format(wd->channels, wd->bps);
+}
+
+// output rate of the device behind the current context, 0 without one
+static unsigned int olual_devicerate(void) {
+	ALCcontext* context = alcGetCurrentContext();
+	if(context == 0)
+		return 0;
+	int freq = 0;
+	alcGetIntegerv(alcGetContextsDevice(context), ALC_FREQUENCY, 1, &freq);
+	return freq > 0 ? freq : 0;
+}
+
+// a rate is either a number or true for the current device rate
+static unsigned int olual_optrate(lua_State* L, int i) {
+	if(lua_isboolean(L, i))
+		return lua_toboolean(L, i) ? olual_devicerate() : 0;
+	return luaL_optnumber(L, i, 0);
+}
+
+#define OLUAL_SAMPLES "openlual.samples"
+
+static const char* olual_sampletypes[3] = {"u8", "s16", "f32"};
+
+// the samples userdata at i, or 0 for anything else
+static Samples* olual_tosamples(lua_State* L, int i) {
+	if(lua_type(L, i) != LUA_TUSERDATA || !lua_getmetatable(L, i))
+		return 0;
+	lua_checkstack(L, 1);
+	luaL_getmetatable(L, OLUAL_SAMPLES);
+	int is = lua_rawequal(L, -1, -2);
+	lua_pop(L, 2);
+	return is ? *(Samples**)lua_touserdata(L, i) : 0;
+}
+
+static Samples* olual_checksamples(lua_State* L, int i) {
+	Samples* s = *(Samples**)luaL_checkudata(L, i, OLUAL_SAMPLES);
+	if(s == 0)
+		luaL_error(L, "samples used after free");
+	return s;
+}
+
+// pushes s, or nil when it is 0
+static void olual_pushsamples(lua_State* L, Samples* s) {
+	lua_checkstack(L, 2);
+	if(s == 0) {
+		lua_pushnil(L);
+		return;
+	}
+	Samples** data = (Samples**)lua_newuserdata(L, sizeof(Samples*));
+	*data = s;
+	luaL_getmetatable(L, OLUAL_SAMPLES);
+	lua_setmetatable(L, -2);
+}
+
+static int olual_checksampletype(lua_State* L, int i) {
+	const char* name = luaL_optstring(L, i, "s16");
+	for(int t=0; t<3; t++)
+		if(strcmp(name, olual_sampletypes[t]) == 0)
+			return t;
+	return luaL_error(L, "unknown sample type '%s'", name);
+}
+
+// AL format for the block, 0 when AL has none
+static int olual_samplesformat(const Samples* s) {
+	return olual_format(s->channels, s->type == SAMPLES_U8 ? 8 : s->type == SAMPLES_F32 ? 32 : 16);
+}
+
+// measured once per file, then read back from the cache directory
+static int olual_loudness(const char* path, const WaveData* wd, Loudness* l) {
+	if(cache_get_meta(path, "lufs", l, sizeof(Loudness)))
+		return 1;
+	if(!loudness_wave(wd, l))
+		return 0;
+	cache_put_meta(path, "lufs", l, sizeof(Loudness));
+	return 1;
+}
+
+// loadwav(path [, {rate = n | true, quality = 0..3, decode = bool, samples = bool,
+//                  loudness = bool, normalize = lufs, trim = db | true, trim_pad = seconds}])
+// samples hands the pcm back as a samples userdata instead of sound_data.
+// loudness adds loudness (LUFS), true_peak, peak and rms (dB); normalize
+// also scales the pcm towards that many LUFS, keeping the true peak under
+// -1 dBTP, and reports the linear gain it used.
+// trim cuts the silence quieter than that many dBFS (-60 for true) off both
+// ends and reports trim_start and trim_end in seconds and the peak in dBFS.
 static int lua_loadwav(lua_State* L) {
 	const char* path = luaL_checkstring(L, 1);
-	WaveData* w_data = wave_load(path);
+	unsigned int rate = 0;
+	int quality = RESAMPLE_DEFAULT;
+	int decode = 0;
+	int as_samples = 0;
+	int measure = 0;
+	int normalize = 0;
+	double target = 0;
+	int trim = 0;
+	double trim_db = -60;
+	double trim_pad = 0;
+	if(!lua_isnoneornil(L, 2)) {
+		luaL_checktable(L, 2);
+		lua_getfield(L, 2, "rate");
+		rate = olual_optrate(L, -1);
+		lua_getfield(L, 2, "quality");
+		quality = luaL_optnumber(L, -1, RESAMPLE_DEFAULT);
+		lua_getfield(L, 2, "decode");
+		decode = lua_toboolean(L, -1);
+		lua_getfield(L, 2, "samples");
+		as_samples = lua_toboolean(L, -1);
+		lua_getfield(L, 2, "loudness");
+		measure = lua_toboolean(L, -1);
+		lua_getfield(L, 2, "normalize");
+		normalize = !lua_isnil(L, -1);
+		target = luaL_optnumber(L, -1, 0);
+		lua_getfield(L, 2, "trim");
+		trim = lua_toboolean(L, -1);
+		if(lua_isnumber(L, -1))
+			trim_db = lua_tonumber(L, -1);
+		lua_getfield(L, 2, "trim_pad");
+		trim_pad = luaL_optnumber(L, -1, 0);
+		lua_pop(L, 8); // rate, quality, decode, samples, loudness, normalize, trim, trim_pad
+		decode = decode || as_samples || normalize || trim;
+		measure = measure || normalize;
+	}
+	
+	WaveData* w_data = sound_load(path);
 	printf("Loaded wave file? %p\n", w_data);
 	lua_checkstack(L, 1);
+	if(w_data == 0) {
+		lua_pushnil(L);
+		return 1;
+	}
+	
+  // measured at the source rate so the cached figures fit any conversion
+	Loudness loud;
+	if(measure && !olual_loudness(path, w_data, &loud))
+		measure = normalize = 0;
+	
+  // resample once here instead of in the mixer for every voice
+	if(rate != 0 && !wave_convert(w_data, 0, rate, quality)) {
+		wave_free(w_data);
+		lua_pushnil(L);
+		return 1;
+	}
+	
+  // adpcm stays compressed in memory when the implementation can mix it
+	olual_Caps caps;
+	olual_probecaps(&caps);
+	int format = decode ? 0 : olual_adpcmformat(w_data, &caps);
+	if(format == 0) {
+		if(!wave_decode(w_data) || !olual_fitwave(w_data, &caps)) {
+			wave_free(w_data);
+			lua_pushnil(L);
+			return 1;
+		}
+		format = olual_format(w_data->channels, w_data->bps);
+	}
+	
+  // after resampling so the pad is counted at the rate that ships
+	TrimInfo cut;
+	if(trim && !trim_wave(w_data, trim_db, trim_pad * w_data->sample_rate, &cut))
+		trim = 0;
+	
+	double gain = 1;
+	if(normalize) {
+		gain = loudness_gain(&loud, target, -1);
+		wave_gain(w_data, gain);
+	}
+	
+	lua_createtable(L, 0, 7);
 	
-	lua_createtable(L, 5, 0);
+	lua_pushnumber(L, format);
+	lua_setfield(L, -2, "format");
+	
+	if(w_data->samples_per_block != 0) {
+		lua_pushnumber(L, w_data->samples_per_block);
+		lua_setfield(L, -2, "samples_per_block");
+	}
 	
 	lua_pushnumber(L, w_data->channels);
 	lua_setfield(L, -2, "channels");
@@ -760,8 +1189,64 @@ static int lua_loadwav(lua_State* L) {
 	lua_pushnumber(L, w_data->sound_size);
 	lua_setfield(L, -2, "sound_size");
 	
-	lua_pushlstring(L, (char*)w_data->sound_data, w_data->sound_size);
-	lua_setfield(L, -2, "sound_data");
+	if(measure) {
+		lua_pushnumber(L, loud.integrated);
+		lua_setfield(L, -2, "loudness");
+		lua_pushnumber(L, loud.true_peak);
+		lua_setfield(L, -2, "true_peak");
+		lua_pushnumber(L, loud.sample_peak);
+		lua_setfield(L, -2, "peak");
+		lua_pushnumber(L, loud.rms);
+		lua_setfield(L, -2, "rms");
+	}
+	if(normalize) {
+		lua_pushnumber(L, gain);
+		lua_setfield(L, -2, "gain");
+	}
+	if(trim) {
+		lua_pushnumber(L, (double) cut.head / w_data->sample_rate);
+		lua_setfield(L, -2, "trim_start");
+		lua_pushnumber(L, (double) cut.tail / w_data->sample_rate);
+		lua_setfield(L, -2, "trim_end");
+		if(!measure) {
+			lua_pushnumber(L, cut.peak == 0 ? -HUGE_VAL : 20 * log10(cut.peak * gain / 32768));
+			lua_setfield(L, -2, "peak");
+		}
+	}
+	
+	if(w_data->loop_end != 0) {
+		lua_pushnumber(L, w_data->loop_start);
+		lua_setfield(L, -2, "loop_start");
+		lua_pushnumber(L, w_data->loop_end);
+		lua_setfield(L, -2, "loop_end");
+	}
+	
+  // cues = {{position = frame, name = label}, ...}
+	if(w_data->cue_count != 0) {
+		lua_checkstack(L, 3);
+		lua_createtable(L, w_data->cue_count, 0);
+		for(unsigned int i=0; i<w_data->cue_count; i++) {
+			lua_createtable(L, 0, 2);
+			lua_pushnumber(L, w_data->cues[i].position);
+			lua_setfield(L, -2, "position");
+			if(w_data->cues[i].name[0] != 0) {
+				lua_pushstring(L, w_data->cues[i].name);
+				lua_setfield(L, -2, "name");
+			}
+			lua_rawseti(L, -2, i + 1);
+		}
+		lua_setfield(L, -2, "cues");
+	}
+	
+	if(as_samples) {
+		size_t frames = w_data->sound_size / (w_data->channels * (w_data->bps / 8));
+		int type = w_data->bps == 8 ? SAMPLES_U8 : w_data->bps == 32 ? SAMPLES_F32 : SAMPLES_S16;
+		olual_pushsamples(L, samples_from(w_data->sound_data, type, w_data->channels, w_data->sample_rate, frames));
+		lua_setfield(L, -2, "samples");
+	} else {
+		lua_pushlstring(L, (char*)w_data->sound_data, w_data->sound_size);
+		lua_setfield(L, -2, "sound_data");
+	}
 	
 	wave_free(w_data);
 	
@@ -770,174 +1255,1624 @@ static int lua_loadwav(lua_State* L) {
 
 // -----
 
-typedef struct olual_CFReg {
-	const char* const name;
-	lua_CFunction cf;
-} olual_CFReg;
+static int lua_packbank(lua_State* L) {
+	const char* path = luaL_checkstring(L, 1);
+	luaL_checktable(L, 2);
+	
+  // accepts {"a.wav", ...} named by path, or {name = "a.wav", ...}
+	size_t len = 0;
+	lua_pushnil(L);
+	while(lua_next(L, 2) != 0) {
+		len++;
+		lua_pop(L, 1); // value
+	}
+	
+	const char** names = malloc(1 * (len + 1) * sizeof(const char*));
+	const char** paths = malloc(1 * (len + 1) * sizeof(const char*));
+	if(names == 0 || paths == 0) {
+		free(names);
+		free(paths);
+		return luaL_error(L, "packbank could not allocate memory");
+	}
+	size_t i = 0;
+	lua_pushnil(L);
+	while(lua_next(L, 2) != 0) {
+		paths[i] = lua_tostring(L, -1);
+		names[i] = lua_type(L, -2) == LUA_TSTRING ? lua_tostring(L, -2) : paths[i];
+		if(paths[i] == 0) {
+			free(names);
+			free(paths);
+			return luaL_error(L, "packbank expects file paths as values");
+		}
+		i++;
+		lua_pop(L, 1); // value; the strings stay alive in the table
+	}
+	
+	int ok = bank_pack(path, names, paths, len);
+	free(names);
+	free(paths);
+	lua_checkstack(L, 1);
+	lua_pushboolean(L, ok);
+	return 1;
+}
 
-typedef struct olual_CDReg {
-	const char* const name;
-	int data;
-} olual_CDReg;
+#define OLUAL_BANK "openlual.bank"
 
+// the handle closes its mapping when collected, closebank only does it sooner
+static int lua_openbank(lua_State* L) {
+	SoundBank* bank = bank_open(luaL_checkstring(L, 1));
+	lua_checkstack(L, 2);
+	if(bank == 0) {
+		lua_pushnil(L);
+		return 1;
+	}
+	SoundBank** data = (SoundBank**)lua_newuserdata(L, sizeof(SoundBank*));
+	*data = bank;
+	luaL_getmetatable(L, OLUAL_BANK);
+	lua_setmetatable(L, -2);
+	return 1;
+}
 
-static const olual_CFReg al_funcs[57] = {
-	{"alEnable", lua_alEnable},
-	{"alDisable", lua_alDisable},
-	{"alIsEnabled", lua_alIsEnabled},
-	{"alGetString", lua_alGetString},
-	{"alGetBooleanv", lua_alGetBooleanv},
-	{"alGetIntegerv", lua_alGetIntegerv},
-	{"alGetFloatv", lua_alGetFloatv},
-	{"alGetDoublev", lua_alGetDoublev},
-	{"alGetBoolean", lua_alGetBoolean},
-	{"alGetInteger", lua_alGetInteger},
-	{"alGetFloat", lua_alGetFloat},
-	{"alGetDouble", lua_alGetDouble},
-	{"alGetError", lua_alGetError},
-	{"alIsExtensionPresent", lua_alIsExtensionPresent},
-	{"alGetEnumValue", lua_alGetEnumValue},
-	{"alListenerf", lua_alListenerf},
-	{"alListener3f", lua_alListener3f},
-	{"alListener6f", lua_alListener6f},
-	{"alListeneri", lua_alListeneri},
-	{"alListener3i", lua_alListener3i},
-	{"alGetListenerf", lua_alGetListenerf},
-	{"alGetListener3f", lua_alGetListener3f},
-	{"alGetListeneri", lua_alGetListeneri},
-	{"alGetListener3i", lua_alGetListener3i},
-	{"alGenSources", lua_alGenSources},
-	{"alDeleteSources", lua_alDeleteSources},
-	{"alIsSource", lua_alIsSource},
-	{"alSourcef", lua_alSourcef},
-	{"alSource3f", lua_alSource3f},
-	{"alSourcei", lua_alSourcei},
-	{"alSource3i", lua_alSource3i},
-	{"alGetSourcef", lua_alGetSourcef},
-	{"alGetSource3f", lua_alGetSource3f},
-	{"alGetSourcei", lua_alGetSourcei},
-	{"alGetSource3i", lua_alGetSource3i},
-	{"alSourcePlay", lua_alSourcePlay},
-	{"alSourceStop", lua_alSourceStop},
-	{"alSourceRewind", lua_alSourceRewind},
-	{"alSourcePause", lua_alSourcePause},
-	{"alSourceQueueBuffers", lua_alSourceQueueBuffers},
-	{"alSourceUnqueueBuffers", lua_alSourceUnqueueBuffers},
-	{"alGenBuffers", lua_alGenBuffers},
-	{"alDeleteBuffers", lua_alDeleteBuffers},
-	{"alIsBuffer", lua_alIsBuffer},
-	{"alBufferData", lua_alBufferData},
-	{"alBufferf", lua_alBufferf},
-	{"alBuffer3f", lua_alBuffer3f},
-	{"alBufferi", lua_alBufferi},
-	{"alBuffer3i", lua_alBuffer3i},
-	{"alGetBufferf", lua_alGetBufferf},
-	{"alGetBuffer3f", lua_alGetBuffer3f},
-	{"alGetBufferi", lua_alGetBufferi},
-	{"alGetBuffer3i", lua_alGetBuffer3i},
-	{"alDopplerFactor", lua_alDopplerFactor},
-	{"alDopplerVelocity", lua_alDopplerVelocity},
-	{"alSpeedOfSound", lua_alSpeedOfSound},
-	{"alDistanceModel", lua_alDistanceModel}
-};
+static int lua_closebank(lua_State* L) {
+	SoundBank** data = (SoundBank**)luaL_checkudata(L, 1, OLUAL_BANK);
+	bank_close(*data);
+	*data = 0;
+	return 0;
+}
 
-static const olual_CFReg alc_funcs[19] = {
-	{"alcCreateContext", lua_alcCreateContext},
-	{"alcMakeContextCurrent", lua_alcMakeContextCurrent},
-	{"alcProcessContext", lua_alcProcessContext},
-	{"alcSuspendContext", lua_alcSuspendContext},
-	{"alcDestroyContext", lua_alcDestroyContext},
-	{"alcGetCurrentContext", lua_alcGetCurrentContext},
-	{"alcGetContextsDevice", lua_alcGetContextsDevice},
-	{"alcOpenDevice", lua_alcOpenDevice},
-	{"alcCloseDevice", lua_alcCloseDevice},
-	{"alcGetError", lua_alcGetError},
-	{"alcIsExtensionPresent", lua_alcIsExtensionPresent},
-	{"alcGetEnumValue", lua_alcGetEnumValue},
-	{"alcGetString", lua_alcGetString},
-	{"alcGetIntegerv", lua_alcGetIntegerv},
-	{"alcCaptureOpenDevice", lua_alcCaptureOpenDevice},
-	{"alcCaptureCloseDevice", lua_alcCaptureCloseDevice},
-	{"alcCaptureStart", lua_alcCaptureStart},
-	{"alcCaptureStop", lua_alcCaptureStop},
-	{"alcCaptureSamples", lua_alcCaptureSamples}
-};
+static const BankEntry* olual_checkbankentry(lua_State* L, SoundBank** bank) {
+	if(*bank == 0)
+		luaL_error(L, "bank is closed");
+	if(lua_type(L, 2) == LUA_TNUMBER)
+		return bank_find(*bank, (uint32_t) lua_tonumber(L, 2));
+	return bank_find_name(*bank, luaL_checkstring(L, 2));
+}
 
+static int lua_bankhash(lua_State* L) {
+	lua_checkstack(L, 1);
+	lua_pushnumber(L, bank_hash(luaL_checkstring(L, 1)));
+	return 1;
+}
 
-static const olual_CDReg al_consts[72] = {
-	{"AL_INVALID", -1},
-	{"AL_NONE", 0},
-	{"AL_FALSE", 0},
-	{"AL_TRUE", 1},
-	{"AL_SOURCE_RELATIVE", 0x202},
-	{"AL_CONE_INNER_ANGLE", 0x1001},
-	{"AL_CONE_OUTER_ANGLE", 0x1002},
-	{"AL_PITCH", 0x1003},
-	{"AL_POSITION", 0x1004},
-	{"AL_DIRECTION", 0x1005},
-	{"AL_VELOCITY", 0x1006},
-	{"AL_LOOPING", 0x1007},
-	{"AL_BUFFER", 0x1009},
-	{"AL_GAIN", 0x100A},
-	{"AL_MIN_GAIN", 0x100D},
-	{"AL_MAX_GAIN", 0x100E},
-	{"AL_ORIENTATION", 0x100F},
-	{"AL_CHANNEL_MASK", 0x3000},
-	{"AL_SOURCE_STATE", 0x1010},
-	{"AL_INITIAL", 0x1011},
-	{"AL_PLAYING", 0x1012},
-	{"AL_PAUSED", 0x1013},
-	{"AL_STOPPED", 0x1014},
-	{"AL_BUFFERS_QUEUED", 0x1015},
-	{"AL_BUFFERS_PROCESSED", 0x1016},
-	{"AL_SEC_OFFSET", 0x1024},
-	{"AL_SAMPLE_OFFSET", 0x1025},
-	{"AL_BYTE_OFFSET", 0x1026},
-	{"AL_SOURCE_TYPE", 0x1027},
-	{"AL_STATIC", 0x1028},
-	{"AL_STREAMING", 0x1029},
-	{"AL_UNDETERMINED", 0x1030},
-	{"AL_FORMAT_MONO8", 0x1100},
-	{"AL_FORMAT_MONO16", 0x1101},
-	{"AL_FORMAT_STEREO8", 0x1102},
-	{"AL_FORMAT_STEREO16", 0x1103},
-	{"AL_REFERENCE_DISTANCE", 0x1020},
-	{"AL_ROLLOFF_FACTOR", 0x1021},
-	{"AL_CONE_OUTER_GAIN", 0x1022},
-	{"AL_MAX_DISTANCE", 0x1023},
-	{"AL_FREQUENCY", 0x2001},
-	{"AL_BITS", 0x2002},
-	{"AL_CHANNELS", 0x2003},
-	{"AL_SIZE", 0x2004},
-	{"AL_UNUSED", 0x2010},
-	{"AL_PENDING", 0x2011},
-	{"AL_PROCESSED", 0x2012},
-	{"AL_NO_ERROR", 0},
-	{"AL_INVALID_NAME", 0xA001},
-	{"AL_ILLEGAL_ENUM", 0xA002},
-	{"AL_INVALID_ENUM", 0xA002},
-	{"AL_INVALID_VALUE", 0xA003},
-	{"AL_ILLEGAL_COMMAND", 0xA004},
-	{"AL_INVALID_OPERATION", 0xA004},
-	{"AL_OUT_OF_MEMORY", 0xA005},
-	{"AL_VENDOR", 0xB001},
-	{"AL_VERSION", 0xB002},
-	{"AL_RENDERER", 0xB003},
-	{"AL_EXTENSIONS", 0xB004},
-	{"AL_DOPPLER_FACTOR", 0xC000},
-	{"AL_DOPPLER_VELOCITY", 0xC001},
-	{"AL_SPEED_OF_SOUND", 0xC003},
-	{"AL_DISTANCE_MODEL", 0xD000},
-	{"AL_INVERSE_DISTANCE", 0xD001},
-	{"AL_INVERSE_DISTANCE_CLAMPED", 0xD002},
-	{"AL_LINEAR_DISTANCE", 0xD003},
-	{"AL_LINEAR_DISTANCE_CLAMPED", 0xD004},
-	{"AL_EXPONENT_DISTANCE", 0xD005},
-	{"AL_EXPONENT_DISTANCE_CLAMPED", 0xD006},
-	{"AL_VERSION_1_0", 1},
-	{"AL_VERSION_1_1", 1},
-	{"AL_NONE", 0}
-};
+static int lua_bankinfo(lua_State* L) {
+	const BankEntry* e = olual_checkbankentry(L, (SoundBank**)luaL_checkudata(L, 1, OLUAL_BANK));
+	lua_checkstack(L, 1);
+	if(e == 0) {
+		lua_pushnil(L);
+		return 1;
+	}
+	
+	lua_createtable(L, 0, 5);
+	
+	lua_pushnumber(L, e->channels);
+	lua_setfield(L, -2, "channels");
+	
+	lua_pushnumber(L, e->bps);
+	lua_setfield(L, -2, "bps");
+	
+	lua_pushnumber(L, e->sample_rate);
+	lua_setfield(L, -2, "sample_rate");
+	
+	lua_pushnumber(L, e->length);
+	lua_setfield(L, -2, "sound_size");
+	
+	lua_pushnumber(L, e->hash);
+	lua_setfield(L, -2, "hash");
+	
+	return 1;
+}
+
+// uploads straight from the mapping, the pcm never passes through lua;
+// banks travel between machines, so a layout this context cannot mix goes
+// through a fitted copy instead
+static int lua_bankbuffer(lua_State* L) {
+	SoundBank** bank = (SoundBank**)luaL_checkudata(L, 1, OLUAL_BANK);
+	const BankEntry* e = olual_checkbankentry(L, bank);
+	unsigned int buffer = luaL_checknumber(L, 3);
+	lua_checkstack(L, 1);
+	if(e == 0) {
+		lua_pushboolean(L, 0);
+		return 1;
+	}
+	
+	olual_Caps caps;
+	olual_probecaps(&caps);
+	if(olual_supported(&caps, e->channels, e->bps)) {
+		account_buffer_data(buffer, olual_format(e->channels, e->bps), bank_data(*bank, e), e->length, e->sample_rate);
+		lua_pushboolean(L, alGetError() == AL_NO_ERROR);
+		return 1;
+	}
+	
+	WaveData* wd = calloc(1, sizeof(WaveData));
+	unsigned char* copy = malloc(1 * (e->length ? e->length : 1));
+	if(wd == 0 || copy == 0) {
+		puts("Could not allocate memory.");
+		free(wd);
+		free(copy);
+		lua_pushboolean(L, 0);
+		return 1;
+	}
+	memcpy(copy, bank_data(*bank, e), e->length);
+	wd->format = e->bps == 32 ? WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM;
+	wd->channels = e->channels;
+	wd->bps = e->bps;
+	wd->sample_rate = e->sample_rate;
+	wd->block_align = e->channels * (e->bps / 8);
+	wd->sound_size = e->length;
+	wd->data = copy;
+	wd->sound_data = copy;
+	
+	int ok = olual_fitwave(wd, &caps);
+	if(ok) {
+		account_buffer_data(buffer, olual_format(wd->channels, wd->bps), wd->sound_data, wd->sound_size, wd->sample_rate);
+		ok = alGetError() == AL_NO_ERROR;
+	}
+	wave_free(wd);
+	lua_pushboolean(L, ok);
+	return 1;
+}
+
+// -----
+
+static int lua_setcachedir(lua_State* L) {
+	cache_set_dir(luaL_checkstring(L, 1));
+	return 0;
+}
+
+// uploads the cached conversion of a wave file, building it on a cold start
+// loadcached(path, buffer [, bps [, rate | true [, quality]]])
+static int lua_loadcached(lua_State* L) {
+	const char* path = luaL_checkstring(L, 1);
+	unsigned int buffer = luaL_checknumber(L, 2);
+	unsigned int bps = luaL_optnumber(L, 3, 0);
+	unsigned int rate = olual_optrate(L, 4);
+	int quality = luaL_optnumber(L, 5, RESAMPLE_DEFAULT);
+	
+  // fitted before it is stored, so the blob uploads as it is mapped
+	olual_Caps caps;
+	olual_probecaps(&caps);
+	CachedSound* cs = cache_load(path, bps, rate, quality, olual_fitcache, &caps, olual_capslayout(&caps));
+	lua_checkstack(L, 1);
+	if(cs == 0) {
+		lua_pushnil(L);
+		return 1;
+	}
+	
+	const CacheHeader* h = cs->header;
+	if(!olual_supported(&caps, h->channels, h->bps)) {
+		cache_close(cs);
+		lua_pushnil(L);
+		return 1;
+	}
+	account_buffer_data(buffer, olual_format(h->channels, h->bps), cs->sound_data, h->sound_size, h->sample_rate);
+	
+	lua_createtable(L, 0, 4);
+	
+	lua_pushnumber(L, h->channels);
+	lua_setfield(L, -2, "channels");
+	
+	lua_pushnumber(L, h->bps);
+	lua_setfield(L, -2, "bps");
+	
+	lua_pushnumber(L, h->sample_rate);
+	lua_setfield(L, -2, "sample_rate");
+	
+	lua_pushnumber(L, h->sound_size);
+	lua_setfield(L, -2, "sound_size");
+	
+	cache_close(cs);
+	return 1;
+}
+
+// -----
+
+// openstream(path, source [, {buffers = n, buffer_frames = n, loop = bool}])
+static int lua_openstream(lua_State* L) {
+	const char* path = luaL_checkstring(L, 1);
+	unsigned int source = luaL_checknumber(L, 2);
+	unsigned int buffers = 4;
+	size_t buffer_frames = 4096;
+	int loop = 0;
+	if(!lua_isnoneornil(L, 3)) {
+		luaL_checktable(L, 3);
+		lua_getfield(L, 3, "buffers");
+		buffers = luaL_optnumber(L, -1, 4);
+		lua_getfield(L, 3, "buffer_frames");
+		buffer_frames = luaL_optnumber(L, -1, 4096);
+		lua_getfield(L, 3, "loop");
+		loop = lua_toboolean(L, -1);
+		lua_pop(L, 3); // buffers, buffer_frames, loop
+	}
+	
+	Stream* stream = stream_open(path, source, buffers, buffer_frames, loop);
+	lua_checkstack(L, 1);
+	if(stream == 0) {
+		lua_pushnil(L);
+		return 1;
+	}
+	Stream** data = (Stream**)lua_newuserdata(L, sizeof(Stream*));
+	*data = stream;
+	return 1;
+}
+
+static int lua_updatestream(lua_State* L) {
+	Stream** data = (Stream**)luaL_checkuserdata(L, 1);
+	lua_checkstack(L, 1);
+	lua_pushboolean(L, *data != 0 && stream_update(*data));
+	return 1;
+}
+
+static int lua_closestream(lua_State* L) {
+	Stream** data = (Stream**)luaL_checkuserdata(L, 1);
+	stream_close(*data);
+	*data = 0;
+	return 0;
+}
+
+// -----
+
+// loadbatch(dir | {paths} | {name = path} [, {rate = n | true, quality = 0..3, decode = bool, io_uring = bool}])
+// returns {name = buffer} and a list of the paths that failed; io_uring
+// reads the files through one ring on Linux and is ignored elsewhere
+static int lua_loadbatch(lua_State* L) {
+	BatchOptions opts;
+	opts.rate = 0;
+	opts.quality = RESAMPLE_DEFAULT;
+	opts.io_uring = 0;
+	int decode = 0;
+	if(!lua_isnoneornil(L, 2)) {
+		luaL_checktable(L, 2);
+		lua_getfield(L, 2, "rate");
+		opts.rate = olual_optrate(L, -1);
+		lua_getfield(L, 2, "quality");
+		opts.quality = luaL_optnumber(L, -1, RESAMPLE_DEFAULT);
+		lua_getfield(L, 2, "decode");
+		decode = lua_toboolean(L, -1);
+		lua_getfield(L, 2, "io_uring");
+		opts.io_uring = lua_toboolean(L, -1);
+		lua_pop(L, 4); // rate, quality, decode, io_uring
+	}
+	olual_Caps caps;
+	olual_probecaps(&caps);
+	opts.keep = decode ? 0 : olual_keepadpcm;
+	opts.keep_ctx = &caps;
+	
+	char** listed = 0;
+	size_t count = 0;
+	const char** paths = 0;
+	const char** names = 0;
+	if(lua_type(L, 1) == LUA_TSTRING) {
+		listed = batch_list_dir(lua_tostring(L, 1), &count);
+		if(listed == 0) {
+			lua_pushnil(L);
+			return 1;
+		}
+		paths = malloc(1 * (count + 1) * sizeof(const char*));
+		names = malloc(1 * (count + 1) * sizeof(const char*));
+		if(paths != 0 && names != 0) {
+			size_t dirlen = luaL_tablelen(L, 1);
+			for(size_t i=0; i<count; i++) {
+				paths[i] = listed[i];
+				names[i] = listed[i] + dirlen + 1; // skip "dir/"
+			}
+		}
+	} else {
+	  // same table shapes as packbank
+		luaL_checktable(L, 1);
+		lua_pushnil(L);
+		while(lua_next(L, 1) != 0) {
+			count++;
+			lua_pop(L, 1); // value
+		}
+		paths = malloc(1 * (count + 1) * sizeof(const char*));
+		names = malloc(1 * (count + 1) * sizeof(const char*));
+		size_t i = 0;
+		lua_pushnil(L);
+		while(paths != 0 && names != 0 && lua_next(L, 1) != 0) {
+			paths[i] = lua_tostring(L, -1);
+			names[i] = lua_type(L, -2) == LUA_TSTRING ? lua_tostring(L, -2) : paths[i];
+			if(paths[i] == 0) {
+				free(paths);
+				free(names);
+				return luaL_error(L, "loadbatch expects file paths as values");
+			}
+			i++;
+			lua_pop(L, 1); // value; the strings stay alive in the table
+		}
+	}
+	
+	WaveData** loaded = calloc(count + 1, sizeof(WaveData*));
+	unsigned int* buffers = malloc(1 * (count + 1) * sizeof(unsigned int));
+	if(paths == 0 || names == 0 || loaded == 0 || buffers == 0) {
+		free(paths);
+		free(names);
+		free(loaded);
+		free(buffers);
+		batch_free_list(listed, count);
+		return luaL_error(L, "loadbatch could not allocate memory");
+	}
+	
+	size_t ok = batch_load(paths, count, loaded, &opts);
+	
+  // one name generation call for the whole batch
+	account_gen_buffers(ok, buffers, "loadbatch");
+	
+	lua_checkstack(L, 4);
+	lua_createtable(L, 0, ok);
+	lua_createtable(L, count - ok, 0);
+	size_t b = 0;
+	size_t failed = 0;
+	for(size_t i=0; i<count; i++) {
+		WaveData* wd = loaded[i];
+		if(wd != 0 && olual_adpcmformat(wd, &caps) == 0 && !olual_fitwave(wd, &caps)) {
+			wave_free(wd);
+			wd = 0;
+		}
+		if(wd == 0) {
+			lua_pushstring(L, paths[i]);
+			lua_rawseti(L, -2, ++failed);
+			continue;
+		}
+		if(wd->samples_per_block != 0 && caps.block_alignment)
+			account_bufferi(buffers[b], AL_UNPACK_BLOCK_ALIGNMENT_SOFT, wd->samples_per_block);
+		account_buffer_data(buffers[b], olual_waveformat(wd, &caps), wd->sound_data, wd->sound_size, wd->sample_rate);
+		wave_free(wd);
+		
+		lua_pushnumber(L, buffers[b++]);
+		lua_setfield(L, -3, names[i]);
+	}
+	
+  // names made for sounds that could not be fitted to the context
+	if(b < ok)
+		account_delete_buffers(ok - b, buffers + b);
+	
+	free(paths);
+	free(names);
+	free(loaded);
+	free(buffers);
+	batch_free_list(listed, count);
+	return 2;
+}
+
+// -----
+
+static float olual_fieldnumber(lua_State* L, int i, const char* name, float def) {
+	lua_getfield(L, i, name);
+	float n = luaL_optnumber(L, -1, def);
+	lua_pop(L, 1);
+	return n;
+}
+
+static void olual_checkvoice(lua_State* L, int i, SynthVoice* v) {
+	static const char* waves[5] = {"sine", "square", "saw", "triangle", "noise"};
+	luaL_checktable(L, i);
+	lua_getfield(L, i, "wave");
+	const char* wave = luaL_optstring(L, -1, "sine");
+	v->wave = -1;
+	for(int w=0; w<5; w++)
+		if(strcmp(wave, waves[w]) == 0)
+			v->wave = w;
+	lua_pop(L, 1);
+	if(v->wave < 0)
+		luaL_error(L, "unknown synth wave '%s'", wave);
+	
+	v->frequency = olual_fieldnumber(L, i, "frequency", 440);
+	v->frequency_end = olual_fieldnumber(L, i, "frequency_end", 0);
+	v->amplitude = olual_fieldnumber(L, i, "amplitude", 0.5);
+	v->duty = olual_fieldnumber(L, i, "duty", 0.5);
+	v->fm_ratio = olual_fieldnumber(L, i, "fm_ratio", 1);
+	v->fm_index = olual_fieldnumber(L, i, "fm_index", 0);
+	v->attack = olual_fieldnumber(L, i, "attack", 0.005);
+	v->decay = olual_fieldnumber(L, i, "decay", 0);
+	v->sustain = olual_fieldnumber(L, i, "sustain", 1);
+	v->release = olual_fieldnumber(L, i, "release", 0.005);
+	v->start = olual_fieldnumber(L, i, "start", 0);
+	v->length = olual_fieldnumber(L, i, "length", 1);
+}
+
+// a patch is one voice table or a list of them; *voices is pushed as a
+// userdata so a bad field can raise an error without leaking it
+static size_t olual_checkpatch(lua_State* L, int i, SynthVoice** voices) {
+	luaL_checktable(L, i);
+	size_t count = luaL_tablelen(L, i);
+	lua_checkstack(L, 2);
+	*voices = (SynthVoice*)lua_newuserdata(L, (count > 0 ? count : 1) * sizeof(SynthVoice));
+	if(count == 0) {
+		olual_checkvoice(L, i, *voices);
+		return 1;
+	}
+	for(size_t k=0; k<count; k++) {
+		lua_rawgeti(L, i, k + 1);
+		olual_checkvoice(L, lua_gettop(L), &(*voices)[k]);
+		lua_pop(L, 1);
+	}
+	return count;
+}
+
+// synth(buffer, patch [, rate | true]) renders the patch into buffer as
+// mono 16 bit, returns the frame count or nil
+static int lua_synth(lua_State* L) {
+	unsigned int buffer = luaL_checknumber(L, 1);
+	unsigned int rate = olual_optrate(L, 3);
+	if(rate == 0)
+		rate = 44100;
+	
+	SynthVoice* voices;
+	size_t count = olual_checkpatch(L, 2, &voices);
+	short* pcm;
+	size_t frames;
+	int ok = synth_render(voices, count, rate, &pcm, &frames);
+	lua_checkstack(L, 1);
+	if(!ok) {
+		lua_pushnil(L);
+		return 1;
+	}
+	
+	account_buffer_data(buffer, AL_FORMAT_MONO16, pcm, frames * sizeof(short), rate);
+	free(pcm);
+	lua_pushnumber(L, frames);
+	return 1;
+}
+
+// synthstream(source, patch [, {rate = n | true, buffers, buffer_frames, loop}])
+// renders on the stream thread instead, for long or looping patches
+static int lua_synthstream(lua_State* L) {
+	unsigned int source = luaL_checknumber(L, 1);
+	unsigned int rate = 0;
+	unsigned int buffers = 4;
+	size_t buffer_frames = 4096;
+	int loop = 0;
+	if(!lua_isnoneornil(L, 3)) {
+		luaL_checktable(L, 3);
+		lua_getfield(L, 3, "rate");
+		rate = olual_optrate(L, -1);
+		lua_getfield(L, 3, "buffers");
+		buffers = luaL_optnumber(L, -1, 4);
+		lua_getfield(L, 3, "buffer_frames");
+		buffer_frames = luaL_optnumber(L, -1, 4096);
+		lua_getfield(L, 3, "loop");
+		loop = lua_toboolean(L, -1);
+		lua_pop(L, 4); // rate, buffers, buffer_frames, loop
+	}
+	if(rate == 0)
+		rate = 44100;
+	
+	SynthVoice* voices;
+	size_t count = olual_checkpatch(L, 2, &voices);
+	Decoder* d = synth_decoder(voices, count, rate);
+	Stream* stream = d != 0 ? stream_open_decoder(d, source, buffers, buffer_frames, loop) : 0;
+	lua_checkstack(L, 1);
+	if(stream == 0) {
+		lua_pushnil(L);
+		return 1;
+	}
+	Stream** data = (Stream**)lua_newuserdata(L, sizeof(Stream*));
+	*data = stream;
+	return 1;
+}
+
+// -----
+
+// newsamples(type, channels, rate, frames), silent
+static int lua_newsamples(lua_State* L) {
+	int type = olual_checksampletype(L, 1);
+	olual_pushsamples(L, samples_new(type, luaL_checknumber(L, 2), luaL_checknumber(L, 3), luaL_checknumber(L, 4)));
+	return 1;
+}
+
+// tosamples(string, type, channels, rate) copies raw pcm in
+static int lua_tosamples(lua_State* L) {
+	size_t size = 0;
+	const char* data = luaL_checklstring(L, 1, &size);
+	int type = olual_checksampletype(L, 2);
+	unsigned int channels = luaL_checknumber(L, 3);
+	if(channels == 0)
+		return luaL_error(L, "tosamples needs at least one channel");
+	size_t frames = size / (channels * samples_type_size(type));
+	olual_pushsamples(L, samples_from(data, type, channels, luaL_checknumber(L, 4), frames));
+	return 1;
+}
+
+// interleave({mono, mono, ...})
+static int lua_interleave(lua_State* L) {
+	luaL_checktable(L, 1);
+	size_t count = luaL_tablelen(L, 1);
+	if(count == 0)
+		return luaL_error(L, "interleave needs at least one plane");
+	Samples** planes = (Samples**)lua_newuserdata(L, count * sizeof(Samples*));
+	for(size_t i=0; i<count; i++) {
+		lua_rawgeti(L, 1, i + 1);
+		planes[i] = olual_checksamples(L, lua_gettop(L));
+		lua_pop(L, 1);
+	}
+	olual_pushsamples(L, samples_interleave(planes, count));
+	return 1;
+}
+
+static int lua_samples_gain(lua_State* L) {
+	samples_gain(olual_checksamples(L, 1), luaL_checknumber(L, 2));
+	lua_settop(L, 1);
+	return 1;
+}
+
+// s:mix(other [, gain [, offset]]), offset in frames
+static int lua_samples_mix(lua_State* L) {
+	Samples* dst = olual_checksamples(L, 1);
+	Samples* src = olual_checksamples(L, 2);
+	if(!samples_mix(dst, src, luaL_optnumber(L, 3, 1), luaL_optnumber(L, 4, 0)))
+		return luaL_error(L, "mixed samples must share type and channels");
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int lua_samples_downmix(lua_State* L) {
+	olual_pushsamples(L, samples_downmix(olual_checksamples(L, 1)));
+	return 1;
+}
+
+static int lua_samples_deinterleave(lua_State* L) {
+	Samples* s = olual_checksamples(L, 1);
+	Samples** planes = (Samples**)lua_newuserdata(L, s->channels * sizeof(Samples*));
+	if(!samples_deinterleave(s, planes)) {
+		lua_pushnil(L);
+		return 1;
+	}
+	lua_createtable(L, s->channels, 0);
+	for(unsigned int c=0; c<s->channels; c++) {
+		olual_pushsamples(L, planes[c]);
+		lua_rawseti(L, -2, c + 1);
+	}
+	return 1;
+}
+
+static int lua_samples_convert(lua_State* L) {
+	Samples* s = olual_checksamples(L, 1);
+	olual_pushsamples(L, samples_convert(s, olual_checksampletype(L, 2)));
+	return 1;
+}
+
+static int lua_samples_reverse(lua_State* L) {
+	samples_reverse(olual_checksamples(L, 1));
+	lua_settop(L, 1);
+	return 1;
+}
+
+// s:slice(first [, count]), first counts frames from 0
+static int lua_samples_slice(lua_State* L) {
+	Samples* s = olual_checksamples(L, 1);
+	size_t first = luaL_checknumber(L, 2);
+	olual_pushsamples(L, samples_slice(s, first, luaL_optnumber(L, 3, s->frames)));
+	return 1;
+}
+
+// s:info() gives {type, channels, sample_rate, frames, size, format}
+static int lua_samples_info(lua_State* L) {
+	Samples* s = olual_checksamples(L, 1);
+	lua_checkstack(L, 2);
+	lua_createtable(L, 0, 6);
+	lua_pushstring(L, olual_sampletypes[s->type]);
+	lua_setfield(L, -2, "type");
+	lua_pushnumber(L, s->channels);
+	lua_setfield(L, -2, "channels");
+	lua_pushnumber(L, s->sample_rate);
+	lua_setfield(L, -2, "sample_rate");
+	lua_pushnumber(L, s->frames);
+	lua_setfield(L, -2, "frames");
+	lua_pushnumber(L, samples_size(s));
+	lua_setfield(L, -2, "size");
+	int format = olual_samplesformat(s);
+	if(format != 0) {
+		lua_pushnumber(L, format);
+		lua_setfield(L, -2, "format");
+	}
+	return 1;
+}
+
+static int lua_samples_tostring(lua_State* L) {
+	Samples* s = olual_checksamples(L, 1);
+	lua_checkstack(L, 1);
+	lua_pushlstring(L, (char*)s->data, samples_size(s));
+	return 1;
+}
+
+static int lua_samples_len(lua_State* L) {
+	lua_checkstack(L, 1);
+	lua_pushnumber(L, olual_checksamples(L, 1)->frames);
+	return 1;
+}
+
+// also the __gc, so memory can be handed back before the collector runs
+static int lua_samples_free(lua_State* L) {
+	Samples** data = (Samples**)luaL_checkudata(L, 1, OLUAL_SAMPLES);
+	samples_free(*data);
+	*data = 0;
+	return 0;
+}
+
+
+// -----
+
+// bytes per frame of a plain pcm format, 0 for anything else
+static size_t olual_framesize(int format) {
+	unsigned int channels, bps;
+	if(!olual_formatlayout(format, &channels, &bps))
+		return 0;
+	return channels * bps / 8;
+}
+
+// a view of pcm bytes held by a Lua value, nothing is copied
+typedef struct olual_PcmView {
+	const unsigned char* data;
+	size_t size;
+	int format; // set beforehand to override the value's own, or 0
+	unsigned int rate; // same
+	size_t frame;
+} olual_PcmView;
+
+// resolves a samples userdata, loadwav result or pcm string at i; whatever
+// it pushes stays on the stack so the bytes live for the whole call
+static void olual_checkpcm(lua_State* L, int i, olual_PcmView* v, const char* caller) {
+	lua_checkstack(L, 4);
+	v->data = 0;
+	v->size = 0;
+	Samples* samples = olual_tosamples(L, i);
+	if(samples == 0 && lua_istable(L, i)) {
+		lua_getfield(L, i, "samples");
+		samples = olual_tosamples(L, -1);
+		if(samples == 0) {
+			lua_getfield(L, i, "sound_data");
+			v->data = (const unsigned char*)lua_tolstring(L, -1, &v->size);
+			lua_getfield(L, i, "format");
+			if(v->format == 0)
+				v->format = luaL_optnumber(L, -1, 0);
+			lua_getfield(L, i, "sample_rate");
+			if(v->rate == 0)
+				v->rate = luaL_optnumber(L, -1, 0);
+			lua_pop(L, 2); // format, sample_rate
+		}
+	} else if(samples == 0)
+		v->data = (const unsigned char*)luaL_checklstring(L, i, &v->size);
+	if(samples != 0) {
+		v->data = samples->data;
+		v->size = samples_size(samples);
+		if(v->format == 0)
+			v->format = olual_samplesformat(samples);
+		if(v->rate == 0)
+			v->rate = samples->sample_rate;
+	}
+	
+	v->frame = olual_framesize(v->format);
+	if(v->data == 0 || v->frame == 0 || v->rate == 0)
+		luaL_error(L, "%s needs pcm data with a known format and sample rate", caller);
+}
+
+static size_t olual_regionfield(lua_State* L, int i, const char* name, int index, double unit, size_t def) {
+	lua_getfield(L, i, name);
+	if(lua_isnil(L, -1)) {
+		lua_pop(L, 1);
+		lua_rawgeti(L, i, index);
+	}
+	double n = luaL_optnumber(L, -1, -1);
+	lua_pop(L, 1);
+	return n < 0 ? def : (size_t) (n * unit);
+}
+
+// bufferregions(data, regions [, {unit = "frames" | "bytes" | "seconds", format, sample_rate}])
+// data is a samples userdata, a loadwav result or a pcm string (which
+// needs format and sample_rate). regions is a list or a name keyed map of
+// {offset, length [, name]}; each becomes its own buffer, uploaded from
+// data in place and cut on frame boundaries. Returns {name | index = buffer}.
+static int lua_bufferregions(lua_State* L) {
+	luaL_checktable(L, 2);
+	const char* unit = "frames";
+	olual_PcmView pcm;
+	pcm.format = 0;
+	pcm.rate = 0;
+	if(!lua_isnoneornil(L, 3)) {
+		luaL_checktable(L, 3);
+		lua_getfield(L, 3, "unit");
+		unit = luaL_optstring(L, -1, "frames");
+		lua_getfield(L, 3, "format");
+		pcm.format = luaL_optnumber(L, -1, 0);
+		lua_getfield(L, 3, "sample_rate");
+		pcm.rate = luaL_optnumber(L, -1, 0);
+		lua_pop(L, 3); // unit, format, sample_rate
+	}
+	olual_checkpcm(L, 1, &pcm, "bufferregions");
+	size_t size = pcm.size;
+	size_t frame = pcm.frame;
+	
+	double scale;
+	if(strcmp(unit, "frames") == 0)
+		scale = frame;
+	else if(strcmp(unit, "bytes") == 0)
+		scale = 1;
+	else if(strcmp(unit, "seconds") == 0)
+		scale = (double) pcm.rate * frame;
+	else
+		return luaL_error(L, "unknown region unit '%s'", unit);
+	
+  // every entry is checked before any name is made, so a bad one can not
+  // raise past buffers that would never be deleted
+	size_t count = 0;
+	lua_pushnil(L);
+	while(lua_next(L, 2)) {
+		int entry = lua_gettop(L);
+		luaL_checktable(L, entry);
+		olual_regionfield(L, entry, "offset", 1, 0, 0);
+		olual_regionfield(L, entry, "length", 2, 0, 0);
+		count++;
+		lua_pop(L, 1);
+	}
+	unsigned int* buffers = (unsigned int*)lua_newuserdata(L, (count > 0 ? count : 1) * sizeof(unsigned int));
+	lua_createtable(L, 0, count);
+	
+  // one name generation call for every region
+	account_gen_buffers(count, buffers, "bufferregions");
+	
+	size_t i = 0;
+	lua_pushnil(L);
+	while(lua_next(L, 2)) {
+		int entry = lua_gettop(L);
+		
+	  // byte offsets round down to a frame, lengths to whole frames
+		size_t offset = olual_regionfield(L, entry, "offset", 1, scale, 0) / frame * frame;
+		if(offset > size)
+			offset = size;
+		size_t length = olual_regionfield(L, entry, "length", 2, scale, size - offset) / frame * frame;
+		if(length > size - offset)
+			length = (size - offset) / frame * frame;
+		account_buffer_data(buffers[i], pcm.format, pcm.data + offset, length, pcm.rate);
+		
+		lua_getfield(L, entry, "name");
+		if(lua_isnil(L, -1)) {
+			lua_pop(L, 1);
+			lua_pushvalue(L, entry - 1);
+		}
+		lua_pushnumber(L, buffers[i++]);
+		lua_settable(L, entry - 2);
+		lua_pop(L, 1);
+	}
+	return 1;
+}
+
+
+// -----
+
+// bufferloop(data [, loop_start, loop_end]) builds what playloop needs from
+// data as bufferregions takes it. Points are frames, defaulting to the
+// loadwav loop fields and then to the whole sound. With AL_SOFT_loop_points
+// it returns one buffer carrying the points; otherwise the intro and the
+// loop as two buffers, or one when the loop starts at the first frame.
+static int lua_bufferloop(lua_State* L) {
+	olual_PcmView pcm;
+	pcm.format = 0;
+	pcm.rate = 0;
+	olual_checkpcm(L, 1, &pcm, "bufferloop");
+	size_t frames = pcm.size / pcm.frame;
+	
+	size_t start = 0;
+	size_t end = 0;
+	if(lua_istable(L, 1)) {
+		lua_getfield(L, 1, "loop_start");
+		start = luaL_optnumber(L, -1, 0);
+		lua_getfield(L, 1, "loop_end");
+		end = luaL_optnumber(L, -1, 0);
+		lua_pop(L, 2); // loop_start, loop_end
+	}
+	start = luaL_optnumber(L, 2, start);
+	end = luaL_optnumber(L, 3, end);
+	if(end == 0 || end > frames)
+		end = frames;
+	if(start >= end)
+		start = 0;
+	
+	lua_checkstack(L, 2);
+	unsigned int buffers[2];
+	if(start == 0 || alIsExtensionPresent("AL_SOFT_loop_points")) {
+		account_gen_buffers(1, buffers, "bufferloop");
+		account_buffer_data(buffers[0], pcm.format, pcm.data, end * pcm.frame, pcm.rate);
+		if(start != 0) {
+			int points[2] = {start, end};
+			alBufferiv(buffers[0], AL_LOOP_POINTS_SOFT, points);
+		}
+		lua_pushnumber(L, buffers[0]);
+		return 1;
+	}
+	
+	account_gen_buffers(2, buffers, "bufferloop");
+	account_buffer_data(buffers[0], pcm.format, pcm.data, start * pcm.frame, pcm.rate);
+	account_buffer_data(buffers[1], pcm.format, pcm.data + start * pcm.frame, (end - start) * pcm.frame, pcm.rate);
+	lua_pushnumber(L, buffers[0]);
+	lua_pushnumber(L, buffers[1]);
+	return 2;
+}
+
+// playloop(source, buffer [, loop_buffer]) plays buffer looping, or buffer
+// once and then loop_buffer forever with the switch done natively
+static int lua_playloop(lua_State* L) {
+	unsigned int source = luaL_checknumber(L, 1);
+	unsigned int buffer = luaL_checknumber(L, 2);
+	lua_checkstack(L, 1);
+	if(!lua_isnoneornil(L, 3)) {
+		lua_pushboolean(L, loop_play(source, buffer, luaL_checknumber(L, 3)));
+		return 1;
+	}
+	
+	loop_forget(source);
+	alSourceStop(source);
+	alSourcei(source, AL_BUFFER, buffer);
+	alSourcei(source, AL_LOOPING, AL_TRUE);
+	alSourcePlay(source);
+	lua_pushboolean(L, 1);
+	return 1;
+}
+
+static int lua_stoploop(lua_State* L) {
+	unsigned int source = luaL_checknumber(L, 1);
+	loop_forget(source);
+	alSourceStop(source);
+	alSourcei(source, AL_LOOPING, AL_FALSE);
+	return 0;
+}
+
+
+// -----
+
+// borrows a view as a samples block for the native kernels, nothing is copied
+static void olual_viewsamples(const olual_PcmView* v, Samples* s) {
+	unsigned int channels = 1, bps = 32;
+	olual_formatlayout(v->format, &channels, &bps);
+	s->type = bps == 8 ? SAMPLES_U8 : bps == 16 ? SAMPLES_S16 : SAMPLES_F32;
+	s->channels = v->frame / samples_type_size(s->type);
+	s->sample_rate = v->rate;
+	s->frames = v->size / v->frame;
+	s->data = (unsigned char*) v->data;
+}
+
+// convolve(data, ir [, {wet = 1, dry = 1, block = frames, samples = bool}])
+// bakes the impulse response ir into data, a samples userdata or decoded
+// loadwav result. ir is a sound file path, resampled to fit, or either of
+// those at the same rate. The
+// result carries the tail as well and is a new buffer with its length in
+// frames, or a samples userdata when samples is set; nil on failure.
+static int lua_convolve(lua_State* L) {
+	ConvolveOptions opts;
+	opts.wet = 1;
+	opts.dry = 1;
+	opts.block = 0;
+	int as_samples = 0;
+	if(!lua_isnoneornil(L, 3)) {
+		luaL_checktable(L, 3);
+		lua_getfield(L, 3, "wet");
+		opts.wet = luaL_optnumber(L, -1, 1);
+		lua_getfield(L, 3, "dry");
+		opts.dry = luaL_optnumber(L, -1, 1);
+		lua_getfield(L, 3, "block");
+		opts.block = luaL_optnumber(L, -1, 0);
+		lua_getfield(L, 3, "samples");
+		as_samples = lua_toboolean(L, -1);
+		lua_pop(L, 4); // wet, dry, block, samples
+	}
+	olual_PcmView pcm;
+	pcm.format = 0;
+	pcm.rate = 0;
+	olual_checkpcm(L, 1, &pcm, "convolve");
+	Samples dry;
+	olual_viewsamples(&pcm, &dry);
+	
+	Samples ir;
+	WaveData* w_data = 0;
+	if(lua_type(L, 2) == LUA_TSTRING) {
+		w_data = sound_load(lua_tostring(L, 2));
+		if(w_data == 0 || !wave_convert(w_data, 16, dry.sample_rate, RESAMPLE_DEFAULT)) {
+			if(w_data != 0)
+				wave_free(w_data);
+			lua_pushnil(L);
+			return 1;
+		}
+		ir.type = SAMPLES_S16;
+		ir.channels = w_data->channels;
+		ir.sample_rate = w_data->sample_rate;
+		ir.frames = w_data->sound_size / (w_data->channels * 2);
+		ir.data = w_data->sound_data;
+	} else {
+		olual_PcmView view;
+		view.format = 0;
+		view.rate = 0;
+		olual_checkpcm(L, 2, &view, "convolve");
+		olual_viewsamples(&view, &ir);
+	}
+	
+	Samples* out = convolve(&dry, &ir, &opts);
+	if(w_data != 0)
+		wave_free(w_data);
+	lua_checkstack(L, 2);
+	if(out == 0) {
+		lua_pushnil(L);
+		return 1;
+	}
+	if(as_samples) {
+		olual_pushsamples(L, out);
+		return 1;
+	}
+	
+	unsigned int buffer = 0;
+	account_gen_buffers(1, &buffer, "convolve");
+	account_buffer_data(buffer, olual_samplesformat(out), out->data, samples_size(out), out->sample_rate);
+	lua_pushnumber(L, buffer);
+	lua_pushnumber(L, out->frames);
+	samples_free(out);
+	return 2;
+}
+
+
+// -----
+
+#define OLUAL_CAPTURE "openlual.capture"
+
+static Capture* olual_checkcapture(lua_State* L, int i) {
+	Capture* c = *(Capture**)luaL_checkudata(L, i, OLUAL_CAPTURE);
+	if(c == 0)
+		luaL_error(L, "capture session used after close");
+	return c;
+}
+
+// capturesession(devicename, frequency, format, buffersize [, {block = seconds,
+//                spectrum = fft size, margin = dB, floor = dBFS, hangover = seconds,
+//                silence = bool, output = {type = "u8" | "s16" | "f32", channels, rate}}])
+// opens a capture device whose blocks are measured and voice gated natively;
+// output has the kept blocks mixed, resampled and converted on the way out,
+// anything left out stays as the device has it. nil on failure
+static int lua_capturesession(lua_State* L) {
+	const char* name = luaL_optstring(L, 1, 0);
+	unsigned int rate = luaL_checknumber(L, 2);
+	int format = luaL_checknumber(L, 3);
+	size_t frames = luaL_checknumber(L, 4);
+	CaptureOptions opts;
+	opts.block = rate / 50;
+	opts.spectrum = 0;
+	opts.margin = 9;
+	opts.floor = -50;
+	opts.hangover = 15;
+	opts.keep_silence = 0;
+	opts.out_type = -1;
+	opts.out_channels = 0;
+	opts.out_rate = 0;
+	if(!lua_isnoneornil(L, 5)) {
+		luaL_checktable(L, 5);
+		lua_getfield(L, 5, "block");
+		opts.block = luaL_optnumber(L, -1, 0.02) * rate;
+		lua_getfield(L, 5, "spectrum");
+		opts.spectrum = luaL_optnumber(L, -1, 0);
+		lua_getfield(L, 5, "margin");
+		opts.margin = luaL_optnumber(L, -1, 9);
+		lua_getfield(L, 5, "floor");
+		opts.floor = luaL_optnumber(L, -1, -50);
+		lua_getfield(L, 5, "hangover");
+		double hangover = luaL_optnumber(L, -1, 0.3);
+		lua_getfield(L, 5, "silence");
+		opts.keep_silence = lua_toboolean(L, -1);
+		lua_pop(L, 6); // block, spectrum, margin, floor, hangover, silence
+		opts.hangover = opts.block ? hangover * rate / opts.block + 0.5 : 0;
+		
+		lua_getfield(L, 5, "output");
+		if(!lua_isnil(L, -1)) {
+			luaL_checktable(L, -1);
+			lua_getfield(L, -1, "type");
+			opts.out_type = olual_checksampletype(L, -1);
+			lua_getfield(L, -2, "channels");
+			opts.out_channels = luaL_optnumber(L, -1, 0);
+			lua_getfield(L, -3, "rate");
+			opts.out_rate = luaL_optnumber(L, -1, 0);
+			lua_pop(L, 3); // type, channels, rate
+		}
+		lua_pop(L, 1); // output
+	}
+	
+	lua_checkstack(L, 2);
+	Capture** data = (Capture**)lua_newuserdata(L, sizeof(Capture*));
+	*data = 0;
+	luaL_getmetatable(L, OLUAL_CAPTURE);
+	lua_setmetatable(L, -2);
+	*data = capture_open(name, rate, format, frames, &opts);
+	if(*data == 0)
+		lua_pushnil(L);
+	return 1;
+}
+
+static int lua_capture_start(lua_State* L) {
+	capture_start(olual_checkcapture(L, 1));
+	return 0;
+}
+
+static int lua_capture_stop(lua_State* L) {
+	capture_stop(olual_checkcapture(L, 1));
+	return 0;
+}
+
+// session:poll([into]) -> {peak, rms, noise, voice, blocks [, spectrum]}, pcm | frames
+// levels are dBFS over the blocks that completed since the last poll and
+// the spectrum has fft size / 2 bins in dB. pcm holds the voiced blocks in
+// the output format, or nil when there were none. Given a samples userdata
+// of that type and channel count, as much as fits is written into it
+// instead and the frame count returned; the rest waits for the next poll.
+static int lua_capture_poll(lua_State* L) {
+	Capture* c = olual_checkcapture(L, 1);
+	Samples* into = lua_isnoneornil(L, 2) ? 0 : olual_checksamples(L, 2);
+	if(into != 0) {
+		int type = c->opts.out_type >= 0 ? c->opts.out_type : c->bps == 8 ? SAMPLES_U8 : c->bps == 16 ? SAMPLES_S16 : SAMPLES_F32;
+		unsigned int channels = c->opts.out_type >= 0 ? c->opts.out_channels : c->channels;
+		if(into->type != type || into->channels != channels)
+			return luaL_error(L, "poll needs a %s block of %d channels", olual_sampletypes[type], channels);
+	}
+	CaptureLevel level;
+	lua_checkstack(L, 4);
+	if(!capture_poll(c, &level)) {
+		lua_pushnil(L);
+		return 1;
+	}
+	
+	lua_createtable(L, 0, 6);
+	lua_pushnumber(L, level.peak);
+	lua_setfield(L, -2, "peak");
+	lua_pushnumber(L, level.rms);
+	lua_setfield(L, -2, "rms");
+	lua_pushnumber(L, level.noise);
+	lua_setfield(L, -2, "noise");
+	lua_pushboolean(L, level.voice);
+	lua_setfield(L, -2, "voice");
+	lua_pushnumber(L, level.blocks);
+	lua_setfield(L, -2, "blocks");
+	if(c->have_spectrum) {
+		size_t bins = c->opts.spectrum / 2;
+		lua_createtable(L, bins, 0);
+		for(size_t i=0; i<bins; i++) {
+			lua_pushnumber(L, c->spectrum[i]);
+			lua_rawseti(L, -2, i + 1);
+		}
+		lua_setfield(L, -2, "spectrum");
+	}
+	
+	if(into != 0) {
+		lua_pushnumber(L, capture_read(c, into->data, samples_size(into)) / c->out_frame);
+	} else if(c->out_size == 0) {
+		lua_pushnil(L);
+	} else {
+		lua_pushlstring(L, (const char*) c->out, c->out_size);
+		c->out_size = 0;
+	}
+	return 2;
+}
+
+static int lua_capture_close(lua_State* L) {
+	Capture** data = (Capture**)luaL_checkudata(L, 1, OLUAL_CAPTURE);
+	capture_close(*data);
+	*data = 0;
+	return 0;
+}
+
+
+// -----
+
+#define OLUAL_RECORDER "openlual.recorder"
+
+// record(path, devicename, frequency, format, buffersize [, {write_size = bytes}])
+// records the capture device into a wave file on native threads until
+// closed or collected; nil on failure
+static int lua_record(lua_State* L) {
+	const char* path = luaL_checkstring(L, 1);
+	const char* name = luaL_optstring(L, 2, 0);
+	unsigned int rate = luaL_checknumber(L, 3);
+	int format = luaL_checknumber(L, 4);
+	size_t frames = luaL_checknumber(L, 5);
+	size_t write_size = 0;
+	if(!lua_isnoneornil(L, 6)) {
+		luaL_checktable(L, 6);
+		lua_getfield(L, 6, "write_size");
+		write_size = luaL_optnumber(L, -1, 0);
+		lua_pop(L, 1);
+	}
+	
+	lua_checkstack(L, 2);
+	Recorder** data = (Recorder**)lua_newuserdata(L, sizeof(Recorder*));
+	*data = 0;
+	luaL_getmetatable(L, OLUAL_RECORDER);
+	lua_setmetatable(L, -2);
+	*data = recorder_open(path, name, rate, format, frames, write_size);
+	if(*data == 0)
+		lua_pushnil(L);
+	return 1;
+}
+
+// recorder:stats() -> {frames, bytes, writes, overruns, dropped}
+static int lua_recorder_stats(lua_State* L) {
+	Recorder* r = *(Recorder**)luaL_checkudata(L, 1, OLUAL_RECORDER);
+	if(r == 0)
+		return luaL_error(L, "recorder used after close");
+	RecorderStats stats;
+	recorder_stats(r, &stats);
+	lua_checkstack(L, 2);
+	lua_createtable(L, 0, 5);
+	lua_pushnumber(L, stats.frames);
+	lua_setfield(L, -2, "frames");
+	lua_pushnumber(L, stats.bytes);
+	lua_setfield(L, -2, "bytes");
+	lua_pushnumber(L, stats.writes);
+	lua_setfield(L, -2, "writes");
+	lua_pushnumber(L, stats.overruns);
+	lua_setfield(L, -2, "overruns");
+	lua_pushnumber(L, stats.dropped);
+	lua_setfield(L, -2, "dropped");
+	return 1;
+}
+
+// recorder:close() -> true when everything reached the disk
+static int lua_recorder_close(lua_State* L) {
+	Recorder** data = (Recorder**)luaL_checkudata(L, 1, OLUAL_RECORDER);
+	int ok = *data != 0 && recorder_close(*data);
+	*data = 0;
+	lua_checkstack(L, 1);
+	lua_pushboolean(L, ok);
+	return 1;
+}
+
+
+// -----
+
+#define OLUAL_FEED "openlual.feed"
+
+static Feed* olual_checkfeed(lua_State* L, int i) {
+	Feed* f = *(Feed**)luaL_checkudata(L, i, OLUAL_FEED);
+	if(f == 0)
+		luaL_error(L, "feed used after close");
+	return f;
+}
+
+// openfeed(source, path | patch | format [, {rate = n | true, frames = n, loop = bool}])
+// plays source from a callback buffer the mixer pulls out of a native ring
+// of frames frames, a tenth of a second by default. A path or a synth patch
+// is decoded into the ring on a thread of its own; a format leaves the
+// ring to feed:write at rate. nil without AL_SOFT_callback_buffer.
+static int lua_openfeed(lua_State* L) {
+	unsigned int source = luaL_checknumber(L, 1);
+	unsigned int rate = 0;
+	size_t frames = 0;
+	int loop = 0;
+	if(!lua_isnoneornil(L, 3)) {
+		luaL_checktable(L, 3);
+		lua_getfield(L, 3, "rate");
+		rate = olual_optrate(L, -1);
+		lua_getfield(L, 3, "frames");
+		frames = luaL_optnumber(L, -1, 0);
+		lua_getfield(L, 3, "loop");
+		loop = lua_toboolean(L, -1);
+		lua_pop(L, 3); // rate, frames, loop
+	}
+	
+	lua_checkstack(L, 2);
+	Feed** data = (Feed**)lua_newuserdata(L, sizeof(Feed*));
+	*data = 0;
+	luaL_getmetatable(L, OLUAL_FEED);
+	lua_setmetatable(L, -2);
+	
+	if(lua_type(L, 2) == LUA_TSTRING) {
+		Decoder* d = decoder_open(lua_tostring(L, 2));
+		*data = d != 0 ? feed_open_decoder(d, source, frames, loop) : 0;
+	} else if(lua_istable(L, 2)) {
+		SynthVoice* voices;
+		size_t count = olual_checkpatch(L, 2, &voices);
+		Decoder* d = synth_decoder(voices, count, rate != 0 ? rate : 44100);
+		*data = d != 0 ? feed_open_decoder(d, source, frames, loop) : 0;
+		lua_pop(L, 1); // voices
+	} else {
+		*data = feed_open(source, luaL_checknumber(L, 2), rate != 0 ? rate : 44100, frames);
+	}
+	if(*data == 0)
+		lua_pushnil(L);
+	return 1;
+}
+
+// feed:write(pcm | samples) -> bytes taken, only whole frames that fit
+static int lua_feed_write(lua_State* L) {
+	Feed* f = olual_checkfeed(L, 1);
+	size_t size;
+	const void* pcm;
+	Samples* samples = olual_tosamples(L, 2);
+	if(samples != 0) {
+		pcm = samples->data;
+		size = samples_size(samples);
+	} else {
+		pcm = luaL_checklstring(L, 2, &size);
+	}
+	lua_checkstack(L, 1);
+	lua_pushnumber(L, feed_write(f, pcm, size));
+	return 1;
+}
+
+// feed:space() -> frames write would take now
+static int lua_feed_space(lua_State* L) {
+	Feed* f = olual_checkfeed(L, 1);
+	lua_checkstack(L, 1);
+	lua_pushnumber(L, feed_space(f));
+	return 1;
+}
+
+// feed:finish() lets the source stop once what was written has played
+static int lua_feed_finish(lua_State* L) {
+	feed_finish(olual_checkfeed(L, 1));
+	return 0;
+}
+
+// feed:stats() -> {played, buffered, underruns}
+static int lua_feed_stats(lua_State* L) {
+	Feed* f = olual_checkfeed(L, 1);
+	FeedStats stats;
+	feed_stats(f, &stats);
+	lua_checkstack(L, 2);
+	lua_createtable(L, 0, 3);
+	lua_pushnumber(L, stats.played);
+	lua_setfield(L, -2, "played");
+	lua_pushnumber(L, stats.buffered);
+	lua_setfield(L, -2, "buffered");
+	lua_pushnumber(L, stats.underruns);
+	lua_setfield(L, -2, "underruns");
+	return 1;
+}
+
+static int lua_feed_close(lua_State* L) {
+	Feed** data = (Feed**)luaL_checkudata(L, 1, OLUAL_FEED);
+	feed_close(*data);
+	*data = 0;
+	return 0;
+}
+
+
+// -----
+
+// formats() -> {float32, mcformats, buffer_samples, ima4, msadpcm, block_alignment}
+// which of the format extensions the current context has; loadwav,
+// loadbatch, loadcached and bankbuffer keep float and multichannel sounds as
+// they are where float32 and mcformats allow
+static int lua_formats(lua_State* L) {
+	olual_Caps caps;
+	olual_probecaps(&caps);
+	lua_checkstack(L, 2);
+	lua_createtable(L, 0, 6);
+	lua_pushboolean(L, caps.float32);
+	lua_setfield(L, -2, "float32");
+	lua_pushboolean(L, caps.mcformats);
+	lua_setfield(L, -2, "mcformats");
+	lua_pushboolean(L, caps.buffer_samples);
+	lua_setfield(L, -2, "buffer_samples");
+	lua_pushboolean(L, caps.ima4);
+	lua_setfield(L, -2, "ima4");
+	lua_pushboolean(L, caps.msadpcm);
+	lua_setfield(L, -2, "msadpcm");
+	lua_pushboolean(L, caps.block_alignment);
+	lua_setfield(L, -2, "block_alignment");
+	return 1;
+}
+
+// resources([true]) -> {sources, buffers, bytes [, objects]}
+// counts the sources and buffers alive that were made through the library
+// and the bytes last uploaded into those buffers. With true, objects lists
+// each of them as {kind = "source" | "buffer", name, bytes, tag}.
+static int lua_resources(lua_State* L) {
+	int detail = lua_toboolean(L, 1);
+	AccountTotals totals;
+	AccountEntry* list = 0;
+	size_t count = 0;
+	if(!detail)
+		account_totals(&totals);
+	else if(!account_snapshot(&totals, &list, &count))
+		return luaL_error(L, "resources could not allocate memory");
+	
+	lua_checkstack(L, 4);
+	lua_createtable(L, 0, 4);
+	lua_pushnumber(L, totals.sources);
+	lua_setfield(L, -2, "sources");
+	lua_pushnumber(L, totals.buffers);
+	lua_setfield(L, -2, "buffers");
+	lua_pushnumber(L, totals.bytes);
+	lua_setfield(L, -2, "bytes");
+	if(!detail)
+		return 1;
+	
+	lua_createtable(L, count, 0);
+	for(size_t i=0; i<count; i++) {
+		lua_createtable(L, 0, 4);
+		lua_pushstring(L, list[i].kind == ACCOUNT_SOURCE ? "source" : "buffer");
+		lua_setfield(L, -2, "kind");
+		lua_pushnumber(L, list[i].name);
+		lua_setfield(L, -2, "name");
+		if(list[i].kind == ACCOUNT_BUFFER) {
+			lua_pushnumber(L, list[i].bytes);
+			lua_setfield(L, -2, "bytes");
+		}
+		if(list[i].tag != 0) {
+			lua_pushstring(L, list[i].tag);
+			lua_setfield(L, -2, "tag");
+		}
+		lua_rawseti(L, -2, i+1);
+	}
+	free(list);
+	lua_setfield(L, -2, "objects");
+	return 1;
+}
+
+// clock() -> nanoseconds
+// a monotonic wall clock from an arbitrary start, for timing spans from
+// scripts; unlike os.clock it runs while blocked and ignores other threads
+static int lua_clock(lua_State* L) {
+	lua_pushnumber(L, clock_ns());
+	return 1;
+}
+
+
+// -----
+
+typedef struct olual_CFReg {
+	const char* const name;
+	lua_CFunction cf;
+} olual_CFReg;
+
+typedef struct olual_CDReg {
+	const char* const name;
+	int data;
+} olual_CDReg;
+
+
+static const olual_CFReg wave_funcs[29] = {
+	{"loadwav", lua_loadwav},
+	{"packbank", lua_packbank},
+	{"openbank", lua_openbank},
+	{"closebank", lua_closebank},
+	{"bankhash", lua_bankhash},
+	{"bankinfo", lua_bankinfo},
+	{"bankbuffer", lua_bankbuffer},
+	{"setcachedir", lua_setcachedir},
+	{"loadcached", lua_loadcached},
+	{"openstream", lua_openstream},
+	{"updatestream", lua_updatestream},
+	{"closestream", lua_closestream},
+	{"loadbatch", lua_loadbatch},
+	{"synth", lua_synth},
+	{"synthstream", lua_synthstream},
+	{"newsamples", lua_newsamples},
+	{"tosamples", lua_tosamples},
+	{"interleave", lua_interleave},
+	{"bufferregions", lua_bufferregions},
+	{"bufferloop", lua_bufferloop},
+	{"playloop", lua_playloop},
+	{"stoploop", lua_stoploop},
+	{"convolve", lua_convolve},
+	{"capturesession", lua_capturesession},
+	{"record", lua_record},
+	{"resources", lua_resources},
+	{"openfeed", lua_openfeed},
+	{"formats", lua_formats},
+	{"clock", lua_clock}
+};
+
+static const olual_CFReg samples_methods[11] = {
+	{"gain", lua_samples_gain},
+	{"mix", lua_samples_mix},
+	{"downmix", lua_samples_downmix},
+	{"deinterleave", lua_samples_deinterleave},
+	{"convert", lua_samples_convert},
+	{"reverse", lua_samples_reverse},
+	{"slice", lua_samples_slice},
+	{"info", lua_samples_info},
+	{"tostring", lua_samples_tostring},
+	{"free", lua_samples_free},
+	{"__len", lua_samples_len}
+};
+
+static const olual_CFReg capture_methods[4] = {
+	{"start", lua_capture_start},
+	{"stop", lua_capture_stop},
+	{"poll", lua_capture_poll},
+	{"close", lua_capture_close}
+};
+
+static const olual_CFReg recorder_methods[2] = {
+	{"stats", lua_recorder_stats},
+	{"close", lua_recorder_close}
+};
+
+static const olual_CFReg feed_methods[5] = {
+	{"write", lua_feed_write},
+	{"space", lua_feed_space},
+	{"finish", lua_feed_finish},
+	{"stats", lua_feed_stats},
+	{"close", lua_feed_close}
+};
+
+static const olual_CFReg al_funcs[59] = {
+	{"alEnable", lua_alEnable},
+	{"alDisable", lua_alDisable},
+	{"alIsEnabled", lua_alIsEnabled},
+	{"alGetString", lua_alGetString},
+	{"alGetBooleanv", lua_alGetBooleanv},
+	{"alGetIntegerv", lua_alGetIntegerv},
+	{"alGetFloatv", lua_alGetFloatv},
+	{"alGetDoublev", lua_alGetDoublev},
+	{"alGetBoolean", lua_alGetBoolean},
+	{"alGetInteger", lua_alGetInteger},
+	{"alGetFloat", lua_alGetFloat},
+	{"alGetDouble", lua_alGetDouble},
+	{"alGetError", lua_alGetError},
+	{"alIsExtensionPresent", lua_alIsExtensionPresent},
+	{"alGetEnumValue", lua_alGetEnumValue},
+	{"alListenerf", lua_alListenerf},
+	{"alListener3f", lua_alListener3f},
+	{"alListener6f", lua_alListener6f},
+	{"alListeneri", lua_alListeneri},
+	{"alListener3i", lua_alListener3i},
+	{"alGetListenerf", lua_alGetListenerf},
+	{"alGetListener3f", lua_alGetListener3f},
+	{"alGetListeneri", lua_alGetListeneri},
+	{"alGetListener3i", lua_alGetListener3i},
+	{"alGenSources", lua_alGenSources},
+	{"alDeleteSources", lua_alDeleteSources},
+	{"alIsSource", lua_alIsSource},
+	{"alSourcef", lua_alSourcef},
+	{"alSource3f", lua_alSource3f},
+	{"alSourcei", lua_alSourcei},
+	{"alSource3i", lua_alSource3i},
+	{"alGetSourcef", lua_alGetSourcef},
+	{"alGetSource3f", lua_alGetSource3f},
+	{"alGetSourcei", lua_alGetSourcei},
+	{"alGetSource3i", lua_alGetSource3i},
+	{"alGetSourcedvSOFT", lua_alGetSourcedvSOFT},
+	{"alGetSourcei64vSOFT", lua_alGetSourcei64vSOFT},
+	{"alSourcePlay", lua_alSourcePlay},
+	{"alSourceStop", lua_alSourceStop},
+	{"alSourceRewind", lua_alSourceRewind},
+	{"alSourcePause", lua_alSourcePause},
+	{"alSourceQueueBuffers", lua_alSourceQueueBuffers},
+	{"alSourceUnqueueBuffers", lua_alSourceUnqueueBuffers},
+	{"alGenBuffers", lua_alGenBuffers},
+	{"alDeleteBuffers", lua_alDeleteBuffers},
+	{"alIsBuffer", lua_alIsBuffer},
+	{"alBufferData", lua_alBufferData},
+	{"alBufferf", lua_alBufferf},
+	{"alBuffer3f", lua_alBuffer3f},
+	{"alBufferi", lua_alBufferi},
+	{"alBuffer3i", lua_alBuffer3i},
+	{"alGetBufferf", lua_alGetBufferf},
+	{"alGetBuffer3f", lua_alGetBuffer3f},
+	{"alGetBufferi", lua_alGetBufferi},
+	{"alGetBuffer3i", lua_alGetBuffer3i},
+	{"alDopplerFactor", lua_alDopplerFactor},
+	{"alDopplerVelocity", lua_alDopplerVelocity},
+	{"alSpeedOfSound", lua_alSpeedOfSound},
+	{"alDistanceModel", lua_alDistanceModel}
+};
+
+static const olual_CFReg alc_funcs[19] = {
+	{"alcCreateContext", lua_alcCreateContext},
+	{"alcMakeContextCurrent", lua_alcMakeContextCurrent},
+	{"alcProcessContext", lua_alcProcessContext},
+	{"alcSuspendContext", lua_alcSuspendContext},
+	{"alcDestroyContext", lua_alcDestroyContext},
+	{"alcGetCurrentContext", lua_alcGetCurrentContext},
+	{"alcGetContextsDevice", lua_alcGetContextsDevice},
+	{"alcOpenDevice", lua_alcOpenDevice},
+	{"alcCloseDevice", lua_alcCloseDevice},
+	{"alcGetError", lua_alcGetError},
+	{"alcIsExtensionPresent", lua_alcIsExtensionPresent},
+	{"alcGetEnumValue", lua_alcGetEnumValue},
+	{"alcGetString", lua_alcGetString},
+	{"alcGetIntegerv", lua_alcGetIntegerv},
+	{"alcCaptureOpenDevice", lua_alcCaptureOpenDevice},
+	{"alcCaptureCloseDevice", lua_alcCaptureCloseDevice},
+	{"alcCaptureStart", lua_alcCaptureStart},
+	{"alcCaptureStop", lua_alcCaptureStop},
+	{"alcCaptureSamples", lua_alcCaptureSamples}
+};
+
+
+static const olual_CDReg al_consts[97] = {
+	{"AL_INVALID", -1},
+	{"AL_NONE", 0},
+	{"AL_FALSE", 0},
+	{"AL_TRUE", 1},
+	{"AL_SOURCE_RELATIVE", 0x202},
+	{"AL_CONE_INNER_ANGLE", 0x1001},
+	{"AL_CONE_OUTER_ANGLE", 0x1002},
+	{"AL_PITCH", 0x1003},
+	{"AL_POSITION", 0x1004},
+	{"AL_DIRECTION", 0x1005},
+	{"AL_VELOCITY", 0x1006},
+	{"AL_LOOPING", 0x1007},
+	{"AL_BUFFER", 0x1009},
+	{"AL_GAIN", 0x100A},
+	{"AL_MIN_GAIN", 0x100D},
+	{"AL_MAX_GAIN", 0x100E},
+	{"AL_ORIENTATION", 0x100F},
+	{"AL_CHANNEL_MASK", 0x3000},
+	{"AL_SOURCE_STATE", 0x1010},
+	{"AL_INITIAL", 0x1011},
+	{"AL_PLAYING", 0x1012},
+	{"AL_PAUSED", 0x1013},
+	{"AL_STOPPED", 0x1014},
+	{"AL_BUFFERS_QUEUED", 0x1015},
+	{"AL_BUFFERS_PROCESSED", 0x1016},
+	{"AL_SEC_OFFSET", 0x1024},
+	{"AL_SAMPLE_OFFSET", 0x1025},
+	{"AL_BYTE_OFFSET", 0x1026},
+	{"AL_SOURCE_TYPE", 0x1027},
+	{"AL_STATIC", 0x1028},
+	{"AL_STREAMING", 0x1029},
+	{"AL_UNDETERMINED", 0x1030},
+	{"AL_FORMAT_MONO8", 0x1100},
+	{"AL_FORMAT_MONO16", 0x1101},
+	{"AL_FORMAT_STEREO8", 0x1102},
+	{"AL_FORMAT_STEREO16", 0x1103},
+	{"AL_FORMAT_MONO_FLOAT32", 0x10010},
+	{"AL_FORMAT_STEREO_FLOAT32", 0x10011},
+	{"AL_FORMAT_QUAD8", 0x1204},
+	{"AL_FORMAT_QUAD16", 0x1205},
+	{"AL_FORMAT_QUAD32", 0x1206},
+	{"AL_FORMAT_REAR8", 0x1207},
+	{"AL_FORMAT_REAR16", 0x1208},
+	{"AL_FORMAT_REAR32", 0x1209},
+	{"AL_FORMAT_51CHN8", 0x120A},
+	{"AL_FORMAT_51CHN16", 0x120B},
+	{"AL_FORMAT_51CHN32", 0x120C},
+	{"AL_FORMAT_61CHN8", 0x120D},
+	{"AL_FORMAT_61CHN16", 0x120E},
+	{"AL_FORMAT_61CHN32", 0x120F},
+	{"AL_FORMAT_71CHN8", 0x1210},
+	{"AL_FORMAT_71CHN16", 0x1211},
+	{"AL_FORMAT_71CHN32", 0x1212},
+	{"AL_FORMAT_MONO_IMA4", 0x1300},
+	{"AL_FORMAT_STEREO_IMA4", 0x1301},
+	{"AL_FORMAT_MONO_MSADPCM_SOFT", 0x1302},
+	{"AL_FORMAT_STEREO_MSADPCM_SOFT", 0x1303},
+	{"AL_UNPACK_BLOCK_ALIGNMENT_SOFT", 0x200C},
+	{"AL_LOOP_POINTS_SOFT", 0x2015},
+	{"AL_SAMPLE_OFFSET_LATENCY_SOFT", 0x1200},
+	{"AL_SEC_OFFSET_LATENCY_SOFT", 0x1201},
+	{"AL_REFERENCE_DISTANCE", 0x1020},
+	{"AL_ROLLOFF_FACTOR", 0x1021},
+	{"AL_CONE_OUTER_GAIN", 0x1022},
+	{"AL_MAX_DISTANCE", 0x1023},
+	{"AL_FREQUENCY", 0x2001},
+	{"AL_BITS", 0x2002},
+	{"AL_CHANNELS", 0x2003},
+	{"AL_SIZE", 0x2004},
+	{"AL_UNUSED", 0x2010},
+	{"AL_PENDING", 0x2011},
+	{"AL_PROCESSED", 0x2012},
+	{"AL_NO_ERROR", 0},
+	{"AL_INVALID_NAME", 0xA001},
+	{"AL_ILLEGAL_ENUM", 0xA002},
+	{"AL_INVALID_ENUM", 0xA002},
+	{"AL_INVALID_VALUE", 0xA003},
+	{"AL_ILLEGAL_COMMAND", 0xA004},
+	{"AL_INVALID_OPERATION", 0xA004},
+	{"AL_OUT_OF_MEMORY", 0xA005},
+	{"AL_VENDOR", 0xB001},
+	{"AL_VERSION", 0xB002},
+	{"AL_RENDERER", 0xB003},
+	{"AL_EXTENSIONS", 0xB004},
+	{"AL_DOPPLER_FACTOR", 0xC000},
+	{"AL_DOPPLER_VELOCITY", 0xC001},
+	{"AL_SPEED_OF_SOUND", 0xC003},
+	{"AL_DISTANCE_MODEL", 0xD000},
+	{"AL_INVERSE_DISTANCE", 0xD001},
+	{"AL_INVERSE_DISTANCE_CLAMPED", 0xD002},
+	{"AL_LINEAR_DISTANCE", 0xD003},
+	{"AL_LINEAR_DISTANCE_CLAMPED", 0xD004},
+	{"AL_EXPONENT_DISTANCE", 0xD005},
+	{"AL_EXPONENT_DISTANCE_CLAMPED", 0xD006},
+	{"AL_VERSION_1_0", 1},
+	{"AL_VERSION_1_1", 1},
+	{"AL_NONE", 0}
+};
 
 static const olual_CDReg alc_consts[27] = {
 	{"ALC_INVALID", 0},
@@ -971,24 +2906,491 @@ static const olual_CDReg alc_consts[27] = {
 
 
 
+// -----
+
+// the instrumented builds wrap every al and alc binding in a closure that
+// times and traces it; the release build pushes them as they are
+#if defined(OPENLUAL_STATS) || defined(OPENLUAL_TRACE)
+
+#define OLUAL_MAX_WRAPPED 128
+
+typedef struct olual_Wrapped {
+	const olual_CFReg* reg;
+	int stats; // counter id, -1 without OPENLUAL_STATS
+} olual_Wrapped;
+
+static olual_Wrapped olual_wrapped[OLUAL_MAX_WRAPPED];
+static int olual_wrapped_count;
+
+#if defined(OPENLUAL_TRACE)
+
+#define OLUAL_TRACE_DEPTH 4 // nested tables deeper than this are left out
+
+static _Thread_local TraceBuf olual_tracebuf; // reused, a raised error cannot leak it
+
+static void olual_tracevalue(lua_State* L, int i, TraceBuf* b, int depth) {
+	size_t size;
+	const char* str;
+	switch(lua_type(L, i)) {
+		case LUA_TNIL:
+			tracebuf_byte(b, TRACE_NIL);
+			return;
+		case LUA_TBOOLEAN:
+			tracebuf_byte(b, lua_toboolean(L, i) ? TRACE_TRUE : TRACE_FALSE);
+			return;
+		case LUA_TNUMBER: {
+			double v = lua_tonumber(L, i);
+			if(v == floor(v) && fabs(v) < 9007199254740992.0) {
+				tracebuf_byte(b, v < 0 ? TRACE_NINT : TRACE_UINT);
+				tracebuf_varint(b, (uint64_t) fabs(v));
+			} else {
+				uint64_t bits;
+				memcpy(&bits, &v, sizeof(bits));
+				tracebuf_byte(b, TRACE_DOUBLE);
+				tracebuf_u64(b, bits);
+			}
+			return;
+		}
+		case LUA_TSTRING:
+			str = lua_tolstring(L, i, &size);
+			if(size < TRACE_INLINE) {
+				tracebuf_byte(b, TRACE_STRING);
+				tracebuf_varint(b, size);
+				tracebuf_bytes(b, str, size);
+			} else {
+				tracebuf_byte(b, TRACE_BLOB);
+				tracebuf_u64(b, trace_payload(str, size));
+			}
+			return;
+		case LUA_TTABLE:
+			if(depth >= OLUAL_TRACE_DEPTH)
+				break;
+			size = luaL_tablelen(L, i);
+			tracebuf_byte(b, TRACE_TABLE);
+			tracebuf_varint(b, size);
+			lua_checkstack(L, 1);
+			for(size_t k=1; k<=size; k++) {
+				lua_rawgeti(L, i, k);
+				olual_tracevalue(L, lua_gettop(L), b, depth + 1);
+				lua_pop(L, 1);
+			}
+			return;
+		case LUA_TUSERDATA: {
+			Samples* samples = olual_tosamples(L, i);
+			if(samples != 0) {
+				tracebuf_byte(b, TRACE_SAMPLES);
+				tracebuf_u64(b, trace_payload(samples->data, samples_size(samples)));
+				tracebuf_varint(b, samples->type);
+				tracebuf_varint(b, samples->channels);
+				tracebuf_varint(b, samples->sample_rate);
+				return;
+			}
+		  // devices and contexts are boxed pointers
+			tracebuf_byte(b, TRACE_HANDLE);
+			tracebuf_varint(b, trace_handle(*(void**)lua_touserdata(L, i)));
+			return;
+		}
+	}
+	tracebuf_byte(b, TRACE_OTHER);
+}
+
+static int olual_traced(lua_State* L, const olual_Wrapped* w, uint64_t* took) {
+	unsigned int id = trace_function(w->reg->name);
+	TraceBuf* b = &olual_tracebuf;
+	b->size = 0;
+	b->failed = 0;
+	int top = lua_gettop(L);
+	tracebuf_varint(b, top);
+	for(int i=1; i<=top; i++)
+		olual_tracevalue(L, i, b, 0);
+	
+  // what the binding does through the account layer is covered by this
+  // record; it runs protected so an error cannot leave the nesting raised
+	lua_checkstack(L, 1);
+	lua_pushcfunction(L, w->reg->cf);
+	lua_insert(L, 1);
+	trace_nest(1);
+	uint64_t start = clock_ns();
+	int status = lua_pcall(L, top, LUA_MULTRET, 0);
+	*took = clock_ns() - start;
+	trace_nest(-1);
+	if(status != 0)
+		return lua_error(L);
+	
+	int n = lua_gettop(L);
+	tracebuf_varint(b, n);
+	for(int i=1; i<=n; i++)
+		olual_tracevalue(L, i, b, 0);
+	trace_emit(id, start, b);
+	return n;
+}
+
+#endif
+
+static int olual_wrapper(lua_State* L) {
+	const olual_Wrapped* w = &olual_wrapped[(int) lua_tonumber(L, lua_upvalueindex(1))];
+	uint64_t took = 0;
+	int n;
+#if defined(OPENLUAL_TRACE)
+	if(trace_on()) {
+		n = olual_traced(L, w, &took);
+	} else
+#endif
+	{
+#if defined(OPENLUAL_STATS)
+		uint64_t start = clock_ns();
+		n = w->reg->cf(L);
+		took = clock_ns() - start;
+#else
+		n = w->reg->cf(L);
+#endif
+	}
+#if defined(OPENLUAL_STATS)
+	stats_record(w->stats, took);
+#endif
+	(void) took;
+	return n;
+}
+
+static void olual_pushwrapped(lua_State* L, const olual_CFReg* reg) {
+	int id = 0;
+	while(id < olual_wrapped_count && olual_wrapped[id].reg != reg)
+		id++;
+	if(id == OLUAL_MAX_WRAPPED) {
+		lua_pushcfunction(L, reg->cf);
+		return;
+	}
+	if(id == olual_wrapped_count) {
+		olual_wrapped[id].reg = reg;
+#if defined(OPENLUAL_STATS)
+		olual_wrapped[id].stats = stats_register(reg->name);
+#else
+		olual_wrapped[id].stats = -1;
+#endif
+		olual_wrapped_count++;
+	}
+	lua_pushnumber(L, id);
+	lua_pushcclosure(L, olual_wrapper, 1);
+}
+
+#	define olual_pushbinding(L, reg) olual_pushwrapped(L, reg)
+#else
+#	define olual_pushbinding(L, reg) lua_pushcfunction(L, (reg)->cf)
+#endif
+
+#if defined(OPENLUAL_STATS)
+
+// stats() -> {name = {calls, time, histogram}}
+// time is seconds in total; histogram[b] counts calls taking 2^(b-1) up to
+// 2^b nanoseconds. Only functions called since the last reset are listed.
+static int lua_stats(lua_State* L) {
+	size_t count = stats_count();
+	lua_checkstack(L, 4);
+	lua_createtable(L, 0, count);
+	for(size_t i=0; i<count; i++) {
+		StatsEntry e;
+		stats_sum(i, &e);
+		if(e.calls == 0)
+			continue;
+		lua_createtable(L, 0, 3);
+		lua_pushnumber(L, e.calls);
+		lua_setfield(L, -2, "calls");
+		lua_pushnumber(L, e.total_ns / 1e9);
+		lua_setfield(L, -2, "time");
+		lua_createtable(L, STATS_BUCKETS, 0);
+		for(int b=0; b<STATS_BUCKETS; b++) {
+			lua_pushnumber(L, e.buckets[b]);
+			lua_rawseti(L, -2, b + 1);
+		}
+		lua_setfield(L, -2, "histogram");
+		lua_setfield(L, -2, stats_name(i));
+	}
+	return 1;
+}
+
+static int lua_stats_reset(lua_State* L) {
+	stats_reset();
+	return 0;
+}
+
+#endif
+
+#if defined(OPENLUAL_TRACE)
+
+#define OLUAL_TRACEREADER "openlual.tracereader"
+
+typedef struct olual_Replay {
+	TraceReader* reader;
+	uint64_t time; // ns into the trace
+	uint64_t started; // clock_ns() of the first call, 0 before it
+	int realtime;
+} olual_Replay;
+
+// trace(path) starts writing every al and alc call to path, trace() stops.
+// The names, uploads and queueing the library's own functions do are
+// written as the al calls they amount to, so a replay makes them too.
+static int lua_trace(lua_State* L) {
+	lua_checkstack(L, 1);
+	if(lua_isnoneornil(L, 1)) {
+		trace_stop();
+		lua_pushboolean(L, 1);
+		return 1;
+	}
+	lua_pushboolean(L, trace_start(luaL_checkstring(L, 1)));
+	return 1;
+}
+
+static int olual_replayvalue(lua_State* L, olual_Replay* rp, int depth) {
+	TraceReader* r = rp->reader;
+	unsigned int tag;
+	uint64_t v, n;
+	const unsigned char* p;
+	const TracePayload* payload;
+	if(!trace_get_byte(r, &tag) || depth > 8)
+		return 0;
+	lua_checkstack(L, 2);
+	switch(tag) {
+		case TRACE_NIL: lua_pushnil(L); return 1;
+		case TRACE_FALSE: lua_pushboolean(L, 0); return 1;
+		case TRACE_TRUE: lua_pushboolean(L, 1); return 1;
+		case TRACE_OTHER: lua_pushnil(L); return 1;
+		case TRACE_UINT:
+		case TRACE_NINT:
+			if(!trace_get_varint(r, &v))
+				return 0;
+			lua_pushnumber(L, tag == TRACE_NINT ? -(double) v : (double) v);
+			return 1;
+		case TRACE_DOUBLE: {
+			if(!trace_get_u64(r, &v))
+				return 0;
+			double d;
+			memcpy(&d, &v, sizeof(d));
+			lua_pushnumber(L, d);
+			return 1;
+		}
+		case TRACE_STRING:
+			if(!trace_get_varint(r, &n) || !trace_get_bytes(r, n, &p))
+				return 0;
+			lua_pushlstring(L, (const char*) p, n);
+			return 1;
+		case TRACE_BLOB:
+			if(!trace_get_u64(r, &v) || (payload = trace_reader_payload(r, v)) == 0)
+				return 0;
+			lua_pushlstring(L, (const char*) payload->data, payload->size);
+			return 1;
+		case TRACE_SAMPLES: {
+			uint64_t type, channels, rate;
+			if(!trace_get_u64(r, &v) || !trace_get_varint(r, &type) || !trace_get_varint(r, &channels)
+				|| !trace_get_varint(r, &rate) || (payload = trace_reader_payload(r, v)) == 0
+				|| type > SAMPLES_F32 || channels == 0)
+				return 0;
+			size_t frames = payload->size / (channels * samples_type_size(type));
+			olual_pushsamples(L, samples_from(payload->data, type, channels, rate, frames));
+			return 1;
+		}
+		case TRACE_HANDLE:
+			if(!trace_get_varint(r, &v))
+				return 0;
+			lua_createtable(L, 0, 1);
+			lua_pushnumber(L, v);
+			lua_setfield(L, -2, "handle");
+			return 1;
+		case TRACE_TABLE:
+			if(!trace_get_varint(r, &n))
+				return 0;
+			lua_createtable(L, n < 4096 ? n : 4096, 0);
+			for(uint64_t k=1; k<=n; k++) {
+				if(!olual_replayvalue(L, rp, depth + 1))
+					return 0;
+				lua_rawseti(L, -2, k);
+			}
+			return 1;
+	}
+	return 0;
+}
+
+// values of one list as {n = count, ...}
+static int olual_replaylist(lua_State* L, olual_Replay* rp) {
+	uint64_t n;
+	if(!trace_get_varint(rp->reader, &n))
+		return 0;
+	lua_checkstack(L, 2);
+	lua_createtable(L, n < 64 ? n : 64, 1);
+	lua_pushnumber(L, n);
+	lua_setfield(L, -2, "n");
+	for(uint64_t k=1; k<=n; k++) {
+		if(!olual_replayvalue(L, rp, 0))
+			return 0;
+		lua_rawseti(L, -2, k);
+	}
+	return 1;
+}
+
+static void olual_sleepuntil(uint64_t when) {
+	uint64_t now = clock_ns();
+	if(when <= now)
+		return;
+#if defined(_WIN32) || defined(_WIN64)
+	Sleep((when - now) / 1000000);
+#else
+	struct timespec ts = {(when - now) / 1000000000, (when - now) % 1000000000};
+	nanosleep(&ts, 0);
+#endif
+}
+
+// next() -> name, seconds, args, results; nil at the end
+static int olual_replaynext(lua_State* L) {
+	olual_Replay* rp = (olual_Replay*)luaL_checkudata(L, lua_upvalueindex(1), OLUAL_TRACEREADER);
+	lua_checkstack(L, 4);
+	unsigned int id;
+	uint64_t delta;
+	if(rp->reader == 0 || !trace_reader_next(rp->reader, &id, &delta)) {
+		lua_pushnil(L);
+		return 1;
+	}
+	rp->time += delta;
+	if(rp->realtime) {
+		if(rp->started == 0)
+			rp->started = clock_ns() - rp->time;
+		olual_sleepuntil(rp->started + rp->time);
+	}
+	
+	const char* name = trace_reader_name(rp->reader, id);
+	int base = lua_gettop(L);
+	lua_pushstring(L, name ? name : "?");
+	lua_pushnumber(L, rp->time / 1e9);
+	if(!olual_replaylist(L, rp) || !olual_replaylist(L, rp)) {
+		lua_settop(L, base);
+		return luaL_error(L, "damaged trace call");
+	}
+	return 4;
+}
+
+static int olual_replayfree(lua_State* L) {
+	olual_Replay* rp = (olual_Replay*)luaL_checkudata(L, 1, OLUAL_TRACEREADER);
+	trace_reader_close(rp->reader);
+	rp->reader = 0;
+	return 0;
+}
+
+// readtrace(path [, {realtime = bool}]) -> iterator over the calls of a
+// trace as name, seconds, args, results. Both lists carry their length in
+// n, devices and contexts come as {handle = id} and realtime paces the
+// iterator to the recorded timing. nil when path is not a trace.
+static int lua_readtrace(lua_State* L) {
+	const char* path = luaL_checkstring(L, 1);
+	int realtime = 0;
+	if(!lua_isnoneornil(L, 2)) {
+		luaL_checktable(L, 2);
+		lua_getfield(L, 2, "realtime");
+		realtime = lua_toboolean(L, -1);
+		lua_pop(L, 1);
+	}
+	lua_checkstack(L, 2);
+	olual_Replay* rp = (olual_Replay*)lua_newuserdata(L, sizeof(olual_Replay));
+	memset(rp, 0, sizeof(olual_Replay));
+	rp->realtime = realtime;
+	if(luaL_newmetatable(L, OLUAL_TRACEREADER)) {
+		lua_pushcfunction(L, olual_replayfree);
+		lua_setfield(L, -2, "__gc");
+	}
+	lua_setmetatable(L, -2);
+	rp->reader = trace_reader_open(path);
+	if(rp->reader == 0) {
+		lua_pushnil(L);
+		return 1;
+	}
+	lua_pushcclosure(L, olual_replaynext, 1);
+	return 1;
+}
+
+#endif
+
+
+
 LUA_DLL_ENTRY luaopen_libopenlual(lua_State* L)
 {
 	
-	lua_createtable(L, 0, 57+19+72+27);
+  // methods sit on the metatable itself, which is also its __index
+	if(luaL_newmetatable(L, OLUAL_SAMPLES)) {
+		for(size_t i=0; i<11; i++) {
+			lua_pushcfunction(L, samples_methods[i].cf);
+			lua_setfield(L, -2, samples_methods[i].name);
+		}
+		lua_pushcfunction(L, lua_samples_free);
+		lua_setfield(L, -2, "__gc");
+		lua_pushvalue(L, -1);
+		lua_setfield(L, -2, "__index");
+	}
+	lua_pop(L, 1);
+	if(luaL_newmetatable(L, OLUAL_CAPTURE)) {
+		for(size_t i=0; i<4; i++) {
+			lua_pushcfunction(L, capture_methods[i].cf);
+			lua_setfield(L, -2, capture_methods[i].name);
+		}
+		lua_pushcfunction(L, lua_capture_close);
+		lua_setfield(L, -2, "__gc");
+		lua_pushvalue(L, -1);
+		lua_setfield(L, -2, "__index");
+	}
+	lua_pop(L, 1);
+	if(luaL_newmetatable(L, OLUAL_RECORDER)) {
+		for(size_t i=0; i<2; i++) {
+			lua_pushcfunction(L, recorder_methods[i].cf);
+			lua_setfield(L, -2, recorder_methods[i].name);
+		}
+		lua_pushcfunction(L, lua_recorder_close);
+		lua_setfield(L, -2, "__gc");
+		lua_pushvalue(L, -1);
+		lua_setfield(L, -2, "__index");
+	}
+	lua_pop(L, 1);
+	
+	if(luaL_newmetatable(L, OLUAL_BANK)) {
+		lua_pushcfunction(L, lua_closebank);
+		lua_setfield(L, -2, "__gc");
+	}
+	lua_pop(L, 1);
+	if(luaL_newmetatable(L, OLUAL_FEED)) {
+		for(size_t i=0; i<5; i++) {
+			lua_pushcfunction(L, feed_methods[i].cf);
+			lua_setfield(L, -2, feed_methods[i].name);
+		}
+		lua_pushcfunction(L, lua_feed_close);
+		lua_setfield(L, -2, "__gc");
+		lua_pushvalue(L, -1);
+		lua_setfield(L, -2, "__index");
+	}
+	lua_pop(L, 1);
 	
-	lua_pushcfunction(L, lua_loadwav);
-	lua_setfield(L, -2, "loadwav");
+	lua_createtable(L, 0, 29+59+19+97+27);
 	
-	for(size_t i=0; i<57; i++) {
-		lua_pushcfunction(L, al_funcs[i].cf);
+	for(size_t i=0; i<29; i++) {
+		lua_pushcfunction(L, wave_funcs[i].cf);
+		lua_setfield(L, -2, wave_funcs[i].name);
+	}
+	for(size_t i=0; i<59; i++) {
+		olual_pushbinding(L, &al_funcs[i]);
 		lua_setfield(L, -2, al_funcs[i].name);
 	}
 	for(size_t i=0; i<19; i++) {
-		lua_pushcfunction(L, alc_funcs[i].cf);
+		olual_pushbinding(L, &alc_funcs[i]);
 		lua_setfield(L, -2, alc_funcs[i].name);
 	}
+#if defined(OPENLUAL_STATS)
+	lua_pushcfunction(L, lua_stats);
+	lua_setfield(L, -2, "stats");
+	lua_pushcfunction(L, lua_stats_reset);
+	lua_setfield(L, -2, "stats_reset");
+#endif
+#if defined(OPENLUAL_TRACE)
+	lua_pushcfunction(L, lua_trace);
+	lua_setfield(L, -2, "trace");
+	lua_pushcfunction(L, lua_readtrace);
+	lua_setfield(L, -2, "readtrace");
+#endif
 	
-	for(size_t i=0; i<72; i++) {
+	for(size_t i=0; i<97; i++) {
 		lua_pushnumber(L, al_consts[i].data);
 		lua_setfield(L, -2, al_consts[i].name);
 	}
@@ -0,0 +1,156 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "pool.h"
+
+#include <stdatomic.h>
+#include <pthread.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+#	include <windows.h>
+#else
+#	include <unistd.h>
+#endif
+
+
+#define POOL_MAX_THREADS 64
+
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER; // one pool_run at a time
+static pthread_mutex_t pool_job_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_job_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_done_cond = PTHREAD_COND_INITIALIZER;
+static unsigned int pool_workers = 0;
+
+// the current job, guarded by pool_job_lock apart from the counters
+static void (*pool_fn)(void*, size_t) = 0;
+static void* pool_ctx = 0;
+static size_t pool_count = 0;
+static unsigned long pool_generation = 0;
+static atomic_size_t pool_next;
+static atomic_size_t pool_done;
+static unsigned int pool_active = 0;
+
+static _Thread_local int pool_in_job = 0;
+
+
+static unsigned int pool_cpu_count(void) {
+#if defined(_WIN32) || defined(_WIN64)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+#else
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? n : 1;
+#endif
+}
+
+static void pool_work(void (*fn)(void*, size_t), void* ctx, size_t count) {
+	size_t i;
+	while((i = atomic_fetch_add(&pool_next, 1)) < count) {
+		fn(ctx, i);
+		atomic_fetch_add(&pool_done, 1);
+	}
+}
+
+static void* pool_worker(void* arg) {
+	pool_in_job = 1;
+	unsigned long seen = 0;
+	for(;;) {
+		pthread_mutex_lock(&pool_job_lock);
+		while(pool_generation == seen)
+			pthread_cond_wait(&pool_job_cond, &pool_job_lock);
+		seen = pool_generation;
+		void (*fn)(void*, size_t) = pool_fn;
+		void* ctx = pool_ctx;
+		size_t count = pool_count;
+		pool_active++;
+		pthread_mutex_unlock(&pool_job_lock);
+		
+		pool_work(fn, ctx, count);
+		
+		pthread_mutex_lock(&pool_job_lock);
+		pool_active--;
+		pthread_cond_broadcast(&pool_done_cond);
+		pthread_mutex_unlock(&pool_job_lock);
+	}
+	return 0;
+}
+
+static void pool_start(void) {
+	unsigned int n = pool_cpu_count();
+	if(n > POOL_MAX_THREADS)
+		n = POOL_MAX_THREADS;
+	for(unsigned int i=1; i<n; i++) {
+		pthread_t t;
+		if(pthread_create(&t, 0, pool_worker, 0) != 0)
+			break;
+		pthread_detach(t);
+		pool_workers++;
+	}
+}
+
+
+unsigned int pool_threads(void) {
+	pthread_once(&pool_once, pool_start);
+	return pool_workers + 1;
+}
+
+void pool_run(void (*fn)(void* ctx, size_t i), void* ctx, size_t count) {
+	
+	if(count == 0)
+		return;
+	
+	pthread_once(&pool_once, pool_start);
+	if(count == 1 || pool_workers == 0 || pool_in_job || pthread_mutex_trylock(&pool_lock) != 0) {
+		for(size_t i=0; i<count; i++)
+			fn(ctx, i);
+		return;
+	}
+	
+	pthread_mutex_lock(&pool_job_lock);
+  // a worker that woke late may still hold the previous job, let it drain
+	while(pool_active > 0)
+		pthread_cond_wait(&pool_done_cond, &pool_job_lock);
+	pool_fn = fn;
+	pool_ctx = ctx;
+	pool_count = count;
+	atomic_store(&pool_next, 0);
+	atomic_store(&pool_done, 0);
+	pool_generation++;
+	pthread_cond_broadcast(&pool_job_cond);
+	pthread_mutex_unlock(&pool_job_lock);
+	
+	pool_in_job = 1;
+	pool_work(fn, ctx, count);
+	pool_in_job = 0;
+	
+  // wait for the last jobs and for every worker to let go of this one
+	pthread_mutex_lock(&pool_job_lock);
+	while(atomic_load(&pool_done) < count || pool_active > 0)
+		pthread_cond_wait(&pool_done_cond, &pool_job_lock);
+	pthread_mutex_unlock(&pool_job_lock);
+	
+	pthread_mutex_unlock(&pool_lock);
+}
@@ -0,0 +1,312 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "record.h"
+#include "capture.h"
+#include "ring.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "AL/al.h"
+#include "AL/alc.h"
+
+#define RECORD_POLL_NS		5000000 // 5 ms between device polls
+#define RECORD_RING_SECONDS	2 // the ring holds at least this much audio
+#define RECORD_RING_WRITES	4 // and at least this many writes
+
+
+struct Recorder {
+	ALCdevice* device;
+	FILE* file;
+	unsigned int channels;
+	unsigned int bps;
+	unsigned int rate;
+	size_t frame;
+	size_t device_frames;
+	size_t write_size;
+	
+	Ring ring;
+	unsigned char* chunk; // device pulls, one write worth
+	unsigned char* block; // RECORD_ALIGN aligned write buffer
+	
+	pthread_t puller;
+	pthread_t writer;
+	atomic_int stop;
+	atomic_int drained;
+	atomic_int failed;
+	
+	atomic_size_t frames;
+	atomic_size_t bytes;
+	atomic_size_t writes;
+	atomic_size_t overruns;
+	atomic_size_t dropped;
+};
+
+
+static void record_le32(unsigned char* p, uint32_t v) {
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+static void record_le16(unsigned char* p, uint16_t v) {
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+// RIFF, fmt and a JUNK chunk padding the header to RECORD_ALIGN, so the
+// samples start on an aligned offset and every full write stays aligned
+static void record_header(const Recorder* r, unsigned char* h, uint32_t data_size) {
+	memset(h, 0, RECORD_ALIGN);
+	memcpy(h, "RIFF", 4);
+	record_le32(h + 4, RECORD_ALIGN - 8 + data_size);
+	memcpy(h + 8, "WAVE", 4);
+	memcpy(h + 12, "fmt ", 4);
+	record_le32(h + 16, 16);
+	record_le16(h + 20, r->bps == 32 ? 3 : 1); // WAVE_FORMAT_IEEE_FLOAT or PCM
+	record_le16(h + 22, r->channels);
+	record_le32(h + 24, r->rate);
+	record_le32(h + 28, r->rate * r->frame);
+	record_le16(h + 32, r->frame);
+	record_le16(h + 34, r->bps);
+	memcpy(h + 36, "JUNK", 4);
+	record_le32(h + 40, RECORD_ALIGN - 8 - 44);
+	memcpy(h + RECORD_ALIGN - 8, "data", 4);
+	record_le32(h + RECORD_ALIGN - 4, data_size);
+}
+
+static void record_pull(Recorder* r) {
+	int avail = 0;
+	alcGetIntegerv(r->device, ALC_CAPTURE_SAMPLES, 1, &avail);
+	
+  // a full device buffer means it may have dropped frames already
+	if((size_t) avail >= r->device_frames)
+		atomic_fetch_add(&r->overruns, 1);
+	size_t most = r->write_size / r->frame;
+	while(avail > 0) {
+		size_t n = (size_t) avail < most ? (size_t) avail : most;
+		alcCaptureSamples(r->device, r->chunk, n);
+		avail -= n;
+		atomic_fetch_add(&r->frames, n);
+		
+		// whole pulls or nothing, a torn frame would shift the channels
+		if(ring_space(&r->ring) < n * r->frame) {
+			atomic_fetch_add(&r->overruns, 1);
+			atomic_fetch_add(&r->dropped, n * r->frame);
+			continue;
+		}
+		ring_write(&r->ring, r->chunk, n * r->frame);
+	}
+}
+
+static void* record_puller(void* arg) {
+	Recorder* r = arg;
+	while(!atomic_load(&r->stop)) {
+		record_pull(r);
+		struct timespec ts = {0, RECORD_POLL_NS};
+		nanosleep(&ts, 0);
+	}
+	alcCaptureStop(r->device);
+	record_pull(r);
+	atomic_store(&r->drained, 1);
+	return 0;
+}
+
+static void record_write(Recorder* r, size_t n) {
+	n = ring_read(&r->ring, r->block, n);
+	if(n == 0)
+		return;
+	if(fwrite(r->block, 1, n, r->file) != n) {
+		puts("Could not write recording.");
+		atomic_store(&r->failed, 1);
+	}
+	atomic_fetch_add(&r->bytes, n);
+	atomic_fetch_add(&r->writes, 1);
+}
+
+static void* record_writer(void* arg) {
+	Recorder* r = arg;
+	for(;;) {
+		int drained = atomic_load(&r->drained);
+		while(ring_used(&r->ring) >= r->write_size)
+			record_write(r, r->write_size);
+		if(drained)
+			break;
+		struct timespec ts = {0, RECORD_POLL_NS};
+		nanosleep(&ts, 0);
+	}
+	
+  // the tail is the only write shorter than write_size
+	record_write(r, r->write_size);
+	return 0;
+}
+
+static void* record_aligned(size_t size) {
+#if defined(_WIN32) || defined(_WIN64)
+	return _aligned_malloc(size, RECORD_ALIGN);
+#else
+	void* p = 0;
+	return posix_memalign(&p, RECORD_ALIGN, size) == 0 ? p : 0;
+#endif
+}
+
+static void record_aligned_free(void* p) {
+#if defined(_WIN32) || defined(_WIN64)
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+static void record_free(Recorder* r) {
+	if(r->file != 0)
+		fclose(r->file);
+	if(r->device != 0)
+		alcCaptureCloseDevice(r->device);
+	ring_free(&r->ring);
+	free(r->chunk);
+	record_aligned_free(r->block);
+	free(r);
+}
+
+
+Recorder* recorder_open(const char* path, const char* device, unsigned int rate, int format, size_t buffer_frames, size_t write_size) {
+	if(write_size == 0)
+		write_size = RECORD_WRITE_SIZE;
+	if(write_size % RECORD_ALIGN != 0) {
+		puts("Record write size must be a multiple of 4096.");
+		return 0;
+	}
+	
+	Recorder* r = calloc(1, sizeof(Recorder));
+	if(r == 0) {
+		puts("Could not allocate memory.");
+		return 0;
+	}
+	if(!capture_layout(format, &r->channels, &r->bps)) {
+		puts("Unsupported capture format.");
+		free(r);
+		return 0;
+	}
+	r->rate = rate;
+	r->frame = r->channels * (r->bps / 8);
+	r->device_frames = buffer_frames;
+	r->write_size = write_size;
+	atomic_init(&r->stop, 0);
+	atomic_init(&r->drained, 0);
+	atomic_init(&r->failed, 0);
+	atomic_init(&r->frames, 0);
+	atomic_init(&r->bytes, 0);
+	atomic_init(&r->writes, 0);
+	atomic_init(&r->overruns, 0);
+	atomic_init(&r->dropped, 0);
+	
+	size_t ring = (size_t) rate * r->frame * RECORD_RING_SECONDS;
+	if(ring < write_size * RECORD_RING_WRITES)
+		ring = write_size * RECORD_RING_WRITES;
+	r->chunk = malloc(write_size);
+	r->block = record_aligned(write_size);
+	if(r->chunk == 0 || r->block == 0 || !ring_init(&r->ring, ring)) {
+		puts("Could not allocate memory.");
+		record_free(r);
+		return 0;
+	}
+	
+  // stdio buffering off, the blocks are already as large as they get
+	r->file = fopen(path, "wb");
+	if(r->file == 0) {
+		puts("Could not open recording file.");
+		record_free(r);
+		return 0;
+	}
+	setvbuf(r->file, 0, _IONBF, 0);
+	record_header(r, r->block, 0);
+	if(fwrite(r->block, 1, RECORD_ALIGN, r->file) != RECORD_ALIGN) {
+		puts("Could not write recording.");
+		record_free(r);
+		return 0;
+	}
+	
+	r->device = alcCaptureOpenDevice(device, rate, format, buffer_frames);
+	if(r->device == 0) {
+		puts("Could not open capture device.");
+		record_free(r);
+		return 0;
+	}
+	alcCaptureStart(r->device);
+	if(pthread_create(&r->writer, 0, record_writer, r) != 0) {
+		puts("Could not start recorder thread.");
+		alcCaptureStop(r->device);
+		record_free(r);
+		return 0;
+	}
+	if(pthread_create(&r->puller, 0, record_puller, r) != 0) {
+		puts("Could not start recorder thread.");
+		alcCaptureStop(r->device);
+		atomic_store(&r->drained, 1);
+		pthread_join(r->writer, 0);
+		record_free(r);
+		return 0;
+	}
+	return r;
+}
+
+void recorder_stats(Recorder* r, RecorderStats* stats) {
+	stats->frames = atomic_load(&r->frames);
+	stats->bytes = atomic_load(&r->bytes);
+	stats->writes = atomic_load(&r->writes);
+	stats->overruns = atomic_load(&r->overruns);
+	stats->dropped = atomic_load(&r->dropped);
+}
+
+int recorder_close(Recorder* r) {
+	atomic_store(&r->stop, 1);
+	pthread_join(r->puller, 0);
+	pthread_join(r->writer, 0);
+	
+  // sizes past 4 GiB cannot be told, readers then go by the file length
+	size_t bytes = atomic_load(&r->bytes);
+	uint32_t size = bytes > UINT32_MAX - RECORD_ALIGN ? UINT32_MAX - RECORD_ALIGN : bytes;
+	unsigned char field[4];
+	int ok = !atomic_load(&r->failed);
+	if(bytes & 1)
+		ok = ok && fputc(0, r->file) != EOF; // chunks are padded to even sizes
+	record_le32(field, RECORD_ALIGN - 8 + size);
+	ok = ok && fseek(r->file, 4, SEEK_SET) == 0 && fwrite(field, 1, 4, r->file) == 4;
+	record_le32(field, size);
+	ok = ok && fseek(r->file, RECORD_ALIGN - 4, SEEK_SET) == 0 && fwrite(field, 1, 4, r->file) == 4;
+	ok = fclose(r->file) == 0 && ok;
+	r->file = 0;
+	if(!ok)
+		puts("Could not finish recording.");
+	record_free(r);
+	return ok;
+}
@@ -0,0 +1,53 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#define RECORD_WRITE_SIZE	(256 * 1024) // default bytes per disk write
+#define RECORD_ALIGN		4096
+
+typedef struct Recorder Recorder;
+
+typedef struct RecorderStats {
+	size_t frames; // captured
+	size_t bytes; // on disk, header excluded
+	size_t writes;
+	size_t overruns; // times the device or the ring filled up
+	size_t dropped; // bytes lost to a full ring
+} RecorderStats;
+
+// starts capturing from the device into a wave file at path on two threads
+// of its own, one pulling from the device and one writing write_size byte
+// blocks, a multiple of RECORD_ALIGN or 0 for RECORD_WRITE_SIZE. Returns 0
+// on failure.
+Recorder* recorder_open(const char* path, const char* device, unsigned int rate, int format, size_t buffer_frames, size_t write_size);
+
+// counters so far, safe while recording
+void recorder_stats(Recorder* r, RecorderStats* stats);
+
+// stops, writes out what is left and patches the header sizes; returns 0
+// when some write failed
+int recorder_close(Recorder* r);
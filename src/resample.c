@@ -0,0 +1,306 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "resample.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#if defined(__SSE__)
+#	include <xmmintrin.h>
+#endif
+
+
+// rate ratios with more phases than this share the nearest phase
+#define RESAMPLE_MAX_PHASES 1024
+
+static const struct {
+	unsigned int taps;
+	double rolloff;
+	double beta;
+} resample_qualities[4] = {
+	{8, 0.85, 5.0},
+	{16, 0.90, 6.5},
+	{32, 0.94, 8.0},
+	{64, 0.97, 9.5}
+};
+
+
+static unsigned int resample_gcd(unsigned int a, unsigned int b) {
+	while(b != 0) {
+		unsigned int t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+// zeroth order modified bessel function, for the kaiser window
+static double resample_bessel_i0(double x) {
+	double sum = 1;
+	double term = 1;
+	for(int k=1; k<32; k++) {
+		term *= (x / (2 * k)) * (x / (2 * k));
+		sum += term;
+	}
+	return sum;
+}
+
+static float* resample_table(unsigned int phases, unsigned int taps, double cutoff, double beta) {
+	float* table = malloc(1 * phases * taps * sizeof(float));
+	if(table == 0)
+		return 0;
+	
+	double half = taps / 2;
+	double norm = resample_bessel_i0(beta);
+	for(unsigned int p=0; p<phases; p++) {
+		float* row = &table[p * taps];
+		double sum = 0;
+		for(unsigned int k=0; k<taps; k++) {
+			double d = (double) k - half + 1 - (double) p / phases;
+			double s = d == 0 ? 1 : sin(M_PI * cutoff * d) / (M_PI * cutoff * d);
+			double w = d / half;
+			w = w * w >= 1 ? 0 : resample_bessel_i0(beta * sqrt(1 - w * w)) / norm;
+			row[k] = cutoff * s * w;
+			sum += row[k];
+		}
+	  // unity gain at dc for every phase
+		for(unsigned int k=0; k<taps; k++)
+			row[k] /= sum;
+	}
+	return table;
+}
+
+static inline float resample_dot(const float* a, const float* b, unsigned int n) {
+#if defined(__SSE__)
+	__m128 acc = _mm_setzero_ps();
+	for(unsigned int i=0; i<n; i+=4)
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+	acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+	acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+	return _mm_cvtss_f32(acc);
+#else
+	float acc = 0;
+	for(unsigned int i=0; i<n; i++)
+		acc += a[i] * b[i];
+	return acc;
+#endif
+}
+
+
+// one shot over either 16 bit or float input, writing the same type out
+static int resample_once(const short* in16, const float* in32, size_t frames, unsigned int channels,
+	unsigned int in_rate, unsigned int out_rate, int quality,
+	short** out16, float** out32, size_t* out_frames) {
+	
+	if(in_rate == 0 || out_rate == 0 || channels == 0) {
+		puts("Invalid resample rate.");
+		return 0;
+	}
+	if(quality < RESAMPLE_FAST || quality > RESAMPLE_BEST)
+		quality = RESAMPLE_DEFAULT;
+	
+	unsigned int g = resample_gcd(in_rate, out_rate);
+	unsigned int up = out_rate / g;
+	unsigned int down = in_rate / g;
+	unsigned int phases = up <= RESAMPLE_MAX_PHASES ? up : RESAMPLE_MAX_PHASES;
+	unsigned int taps = resample_qualities[quality].taps;
+	unsigned int half = taps / 2;
+	
+  // downsampling moves the cutoff below the new nyquist
+	double cutoff = out_rate < in_rate ? (double) out_rate / in_rate : 1;
+	cutoff *= resample_qualities[quality].rolloff;
+	
+	size_t nout = ((uint64_t) frames * up + down - 1) / down;
+	size_t padded = frames + taps + 1;
+	
+	size_t width = in32 != 0 ? sizeof(float) : sizeof(short);
+	float* table = resample_table(phases, taps, cutoff, resample_qualities[quality].beta);
+	float* plane = malloc(1 * padded * sizeof(float));
+	void* o = malloc(1 * (nout ? nout : 1) * channels * width);
+	if(table == 0 || plane == 0 || o == 0) {
+		puts("Could not allocate memory.");
+		free(table);
+		free(plane);
+		free(o);
+		return 0;
+	}
+	
+	for(unsigned int c=0; c<channels; c++) {
+		
+	  // planar float copy with room for the filter to run off both ends
+		for(size_t i=0; i<padded; i++)
+			plane[i] = 0;
+		for(size_t i=0; i<frames; i++)
+			plane[i + half - 1] = in32 != 0 ? in32[i * channels + c] : in16[i * channels + c];
+		
+		size_t ipos = 0;
+		unsigned int frac = 0;
+		for(size_t n=0; n<nout; n++) {
+			unsigned int p = phases == up ? frac : (unsigned int) ((uint64_t) frac * phases / up);
+			float v = resample_dot(&plane[ipos], &table[p * taps], taps);
+			if(in32 != 0) {
+				((float*) o)[n * channels + c] = v;
+			} else {
+				v = v < -32768.0f ? -32768.0f : (v > 32767.0f ? 32767.0f : v);
+				((short*) o)[n * channels + c] = (short) lrintf(v);
+			}
+			
+			frac += down;
+			ipos += frac / up;
+			frac %= up;
+		}
+	}
+	
+	free(table);
+	free(plane);
+	if(in32 != 0)
+		*out32 = o;
+	else
+		*out16 = o;
+	*out_frames = nout;
+	return 1;
+}
+
+int resample_s16(const short* in, size_t frames, unsigned int channels,
+	unsigned int in_rate, unsigned int out_rate, int quality,
+	short** out, size_t* out_frames) {
+	return resample_once(in, 0, frames, channels, in_rate, out_rate, quality, out, 0, out_frames);
+}
+
+int resample_f32(const float* in, size_t frames, unsigned int channels,
+	unsigned int in_rate, unsigned int out_rate, int quality,
+	float** out, size_t* out_frames) {
+	return resample_once(0, in, frames, channels, in_rate, out_rate, quality, 0, out, out_frames);
+}
+
+
+struct Resampler {
+	unsigned int channels;
+	unsigned int up;
+	unsigned int down;
+	unsigned int phases;
+	unsigned int taps;
+	float* table;
+	float* planes; // channels planes of cap samples
+	size_t cap;
+	size_t fill; // samples held in every plane
+	size_t ipos;
+	unsigned int frac;
+};
+
+Resampler* resample_open(unsigned int channels, unsigned int in_rate, unsigned int out_rate, int quality) {
+	if(in_rate == 0 || out_rate == 0 || channels == 0) {
+		puts("Invalid resample rate.");
+		return 0;
+	}
+	if(quality < RESAMPLE_FAST || quality > RESAMPLE_BEST)
+		quality = RESAMPLE_DEFAULT;
+	
+	Resampler* r = calloc(1, sizeof(Resampler));
+	if(r == 0) {
+		puts("Could not allocate memory.");
+		return 0;
+	}
+	unsigned int g = resample_gcd(in_rate, out_rate);
+	r->channels = channels;
+	r->up = out_rate / g;
+	r->down = in_rate / g;
+	r->phases = r->up <= RESAMPLE_MAX_PHASES ? r->up : RESAMPLE_MAX_PHASES;
+	r->taps = resample_qualities[quality].taps;
+	
+	double cutoff = out_rate < in_rate ? (double) out_rate / in_rate : 1;
+	cutoff *= resample_qualities[quality].rolloff;
+	r->table = resample_table(r->phases, r->taps, cutoff, resample_qualities[quality].beta);
+	
+  // starts with the same lead in of silence the one shot path pads with
+	r->cap = r->taps * 4;
+	r->fill = r->taps / 2 - 1;
+	r->planes = calloc(channels * r->cap, sizeof(float));
+	if(r->table == 0 || r->planes == 0) {
+		puts("Could not allocate memory.");
+		resample_close(r);
+		return 0;
+	}
+	return r;
+}
+
+size_t resample_room(const Resampler* r, size_t frames) {
+	return ((uint64_t) (frames + r->taps) * r->up) / r->down + 1;
+}
+
+size_t resample_process(Resampler* r, const float* in, size_t frames, float* out) {
+	unsigned int ch = r->channels;
+	if(r->fill + frames > r->cap) {
+		size_t cap = (r->fill + frames) * 2;
+		float* planes = malloc(ch * cap * sizeof(float));
+		if(planes == 0) {
+			puts("Could not allocate memory.");
+			return 0;
+		}
+		for(unsigned int c=0; c<ch; c++)
+			memcpy(planes + c * cap, r->planes + c * r->cap, r->fill * sizeof(float));
+		free(r->planes);
+		r->planes = planes;
+		r->cap = cap;
+	}
+	for(unsigned int c=0; c<ch; c++) {
+		float* plane = r->planes + c * r->cap + r->fill;
+		for(size_t i=0; i<frames; i++)
+			plane[i] = in[i * ch + c];
+	}
+	r->fill += frames;
+	
+	size_t n = 0;
+	while(r->ipos + r->taps <= r->fill) {
+		unsigned int p = r->phases == r->up ? r->frac : (unsigned int) ((uint64_t) r->frac * r->phases / r->up);
+		const float* row = &r->table[p * r->taps];
+		for(unsigned int c=0; c<ch; c++)
+			out[n * ch + c] = resample_dot(r->planes + c * r->cap + r->ipos, row, r->taps);
+		n++;
+		
+		r->frac += r->down;
+		r->ipos += r->frac / r->up;
+		r->frac %= r->up;
+	}
+	
+  // keep what the next window still needs at the front of every plane
+	size_t keep = r->fill > r->ipos ? r->fill - r->ipos : 0;
+	for(unsigned int c=0; c<ch; c++)
+		memmove(r->planes + c * r->cap, r->planes + c * r->cap + (r->fill - keep), keep * sizeof(float));
+	r->ipos -= r->fill - keep;
+	r->fill = keep;
+	return n;
+}
+
+void resample_close(Resampler* r) {
+	if(r == 0)
+		return;
+	free(r->table);
+	free(r->planes);
+	free(r);
+}
@@ -0,0 +1,61 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+// filter lengths 8, 16, 32 and 64 taps
+#define RESAMPLE_FAST		0
+#define RESAMPLE_MEDIUM		1
+#define RESAMPLE_GOOD		2
+#define RESAMPLE_BEST		3
+
+#define RESAMPLE_DEFAULT	RESAMPLE_GOOD
+
+// resamples interleaved 16 bit pcm with a windowed sinc polyphase filter,
+// *out is allocated and must be free'd, returns 0 on failure
+int resample_s16(const short* in, size_t frames, unsigned int channels,
+	unsigned int in_rate, unsigned int out_rate, int quality,
+	short** out, size_t* out_frames);
+
+// the same filter over interleaved float pcm, the output is not clipped
+int resample_f32(const float* in, size_t frames, unsigned int channels,
+	unsigned int in_rate, unsigned int out_rate, int quality,
+	float** out, size_t* out_frames);
+
+// streaming form for interleaved float pcm that arrives in pieces; the
+// filter history carries over between calls, delaying the output by half
+// the taps. Returns 0 on failure.
+typedef struct Resampler Resampler;
+
+Resampler* resample_open(unsigned int channels, unsigned int in_rate, unsigned int out_rate, int quality);
+
+// most frames one call with frames of input can give
+size_t resample_room(const Resampler* r, size_t frames);
+
+// writes up to resample_room(r, frames) frames to out and returns how many
+size_t resample_process(Resampler* r, const float* in, size_t frames, float* out);
+
+void resample_close(Resampler* r);
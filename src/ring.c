@@ -0,0 +1,93 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "ring.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+int ring_init(Ring* r, size_t size) {
+	size_t s = 1;
+	while(s < size)
+		s <<= 1;
+	r->data = malloc(s);
+	r->size = s;
+	atomic_init(&r->head, 0);
+	atomic_init(&r->tail, 0);
+	return r->data != 0;
+}
+
+void ring_free(Ring* r) {
+	free(r->data);
+	r->data = 0;
+	r->size = 0;
+}
+
+size_t ring_used(Ring* r) {
+  // tail first, so a third thread never sees the reader ahead of the writer;
+  // the writer can still move on meanwhile, hence the clamp
+	size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+	size_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+	return head - tail > r->size ? r->size : head - tail;
+}
+
+size_t ring_space(Ring* r) {
+	return r->size - ring_used(r);
+}
+
+size_t ring_write(Ring* r, const void* src, size_t n) {
+	size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+	size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+	size_t space = r->size - (head - tail);
+	if(n > space)
+		n = space;
+	
+	size_t at = head & (r->size - 1);
+	size_t first = r->size - at < n ? r->size - at : n;
+	memcpy(r->data + at, src, first);
+	memcpy(r->data, (const unsigned char*) src + first, n - first);
+	
+	atomic_store_explicit(&r->head, head + n, memory_order_release);
+	return n;
+}
+
+size_t ring_read(Ring* r, void* dst, size_t n) {
+	size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+	size_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+	if(n > head - tail)
+		n = head - tail;
+	
+	size_t at = tail & (r->size - 1);
+	size_t first = r->size - at < n ? r->size - at : n;
+	memcpy(dst, r->data + at, first);
+	memcpy((unsigned char*) dst + first, r->data, n - first);
+	
+	atomic_store_explicit(&r->tail, tail + n, memory_order_release);
+	return n;
+}
+
+void ring_clear(Ring* r) {
+	atomic_store_explicit(&r->tail, atomic_load_explicit(&r->head, memory_order_acquire), memory_order_release);
+}
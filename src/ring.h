@@ -0,0 +1,53 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+// single producer, single consumer byte ring, lock free
+typedef struct Ring {
+	unsigned char* data;
+	size_t size; // power of two
+	atomic_size_t head; // total bytes written
+	atomic_size_t tail; // total bytes read
+} Ring;
+
+// size is rounded up to a power of two, returns 0 on failure
+int ring_init(Ring* r, size_t size);
+
+void ring_free(Ring* r);
+
+size_t ring_used(Ring* r);
+size_t ring_space(Ring* r);
+
+// producer side, writes as much as fits and returns it
+size_t ring_write(Ring* r, const void* src, size_t n);
+
+// consumer side, reads as much as is there and returns it
+size_t ring_read(Ring* r, void* dst, size_t n);
+
+// consumer side, drops everything written so far
+void ring_clear(Ring* r);
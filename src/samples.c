@@ -0,0 +1,571 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "samples.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+#	include <malloc.h>
+#endif
+
+#if defined(__SSE2__)
+#	include <emmintrin.h>
+#endif
+
+
+// the scalar helpers round and clip exactly like the vector paths, so a
+// block gives the same result whichever way its samples went through
+
+static inline short samples_clip(float f) {
+	if(f >= 32767)
+		return 32767;
+	if(f <= -32768)
+		return -32768;
+	return (short) lrintf(f);
+}
+
+static inline short samples_u8_s16(unsigned char b) {
+	return (short) ((b - 128) * 256);
+}
+
+static inline unsigned char samples_s16_u8(short x) {
+	int y = x + 128;
+	if(y > 32767)
+		y = 32767;
+	return (unsigned char) ((y >> 8) + 128);
+}
+
+static inline short samples_adds(short a, short b) {
+	int s = a + b;
+	return s > 32767 ? 32767 : s < -32768 ? -32768 : s;
+}
+
+#if defined(__SSE2__)
+// 8 samples times g, rounded and clipped
+static inline __m128i samples_gain8(__m128i v, __m128 g) {
+	const __m128 top = _mm_set1_ps(32767);
+	const __m128 bottom = _mm_set1_ps(-32768);
+	__m128 lo = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)), g);
+	__m128 hi = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16)), g);
+	lo = _mm_max_ps(_mm_min_ps(lo, top), bottom);
+	hi = _mm_max_ps(_mm_min_ps(hi, top), bottom);
+	return _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi));
+}
+
+// 16 unsigned bytes widened to two vectors of 16 bit samples
+static inline void samples_widen(__m128i v, __m128i* lo, __m128i* hi) {
+	v = _mm_xor_si128(v, _mm_set1_epi8((char) 0x80));
+	*lo = _mm_unpacklo_epi8(_mm_setzero_si128(), v);
+	*hi = _mm_unpackhi_epi8(_mm_setzero_si128(), v);
+}
+
+static inline __m128i samples_narrow(__m128i lo, __m128i hi) {
+	const __m128i half = _mm_set1_epi16(128);
+	lo = _mm_srai_epi16(_mm_adds_epi16(lo, half), 8);
+	hi = _mm_srai_epi16(_mm_adds_epi16(hi, half), 8);
+	return _mm_xor_si128(_mm_packs_epi16(lo, hi), _mm_set1_epi8((char) 0x80));
+}
+#endif
+
+
+size_t samples_type_size(int type) {
+	return type == SAMPLES_U8 ? 1 : type == SAMPLES_S16 ? 2 : 4;
+}
+
+size_t samples_size(const Samples* s) {
+	return s->frames * s->channels * samples_type_size(s->type);
+}
+
+Samples* samples_new(int type, unsigned int channels, unsigned int sample_rate, size_t frames) {
+	if(type < SAMPLES_U8 || type > SAMPLES_F32 || channels == 0) {
+		puts("Invalid sample layout.");
+		return 0;
+	}
+	
+	Samples* s = malloc(sizeof(Samples));
+	if(s == 0) {
+		puts("Could not allocate memory.");
+		return 0;
+	}
+	s->type = type;
+	s->channels = channels;
+	s->sample_rate = sample_rate;
+	s->frames = frames;
+	
+  // rounded up to whole vectors so no kernel reads past its block
+	size_t size = (samples_size(s) + SAMPLES_ALIGN - 1) / SAMPLES_ALIGN * SAMPLES_ALIGN;
+	if(size == 0)
+		size = SAMPLES_ALIGN;
+#if defined(_WIN32) || defined(_WIN64)
+	s->data = _aligned_malloc(size, SAMPLES_ALIGN);
+#else
+	if(posix_memalign((void**) &s->data, SAMPLES_ALIGN, size) != 0)
+		s->data = 0;
+#endif
+	if(s->data == 0) {
+		puts("Could not allocate memory.");
+		free(s);
+		return 0;
+	}
+	
+	if(type == SAMPLES_U8)
+		memset(s->data, 0x80, size);
+	else
+		memset(s->data, 0, size);
+	return s;
+}
+
+Samples* samples_from(const void* data, int type, unsigned int channels, unsigned int sample_rate, size_t frames) {
+	Samples* s = samples_new(type, channels, sample_rate, frames);
+	if(s != 0)
+		memcpy(s->data, data, samples_size(s));
+	return s;
+}
+
+void samples_free(Samples* s) {
+	if(s == 0)
+		return;
+#if defined(_WIN32) || defined(_WIN64)
+	_aligned_free(s->data);
+#else
+	free(s->data);
+#endif
+	free(s);
+}
+
+
+void samples_gain(Samples* s, float gain) {
+	size_t n = s->frames * s->channels;
+	size_t i = 0;
+	
+	if(s->type == SAMPLES_F32) {
+		float* p = (float*) s->data;
+#if defined(__SSE2__)
+		__m128 g = _mm_set1_ps(gain);
+		for(; i+4<=n; i+=4)
+			_mm_store_ps(p + i, _mm_mul_ps(_mm_load_ps(p + i), g));
+#endif
+		for(; i<n; i++)
+			p[i] *= gain;
+	}
+	
+	else if(s->type == SAMPLES_S16) {
+		short* p = (short*) s->data;
+#if defined(__SSE2__)
+		__m128 g = _mm_set1_ps(gain);
+		for(; i+8<=n; i+=8)
+			_mm_store_si128((__m128i*) (p + i), samples_gain8(_mm_load_si128((__m128i*) (p + i)), g));
+#endif
+		for(; i<n; i++)
+			p[i] = samples_clip(p[i] * gain);
+	}
+	
+	else {
+		unsigned char* p = s->data;
+#if defined(__SSE2__)
+		__m128 g = _mm_set1_ps(gain);
+		for(; i+16<=n; i+=16) {
+			__m128i lo, hi;
+			samples_widen(_mm_load_si128((__m128i*) (p + i)), &lo, &hi);
+			_mm_store_si128((__m128i*) (p + i), samples_narrow(samples_gain8(lo, g), samples_gain8(hi, g)));
+		}
+#endif
+		for(; i<n; i++)
+			p[i] = samples_s16_u8(samples_clip(samples_u8_s16(p[i]) * gain));
+	}
+}
+
+int samples_mix(Samples* dst, const Samples* src, float gain, size_t offset) {
+	if(dst->type != src->type || dst->channels != src->channels) {
+		puts("Mixed samples do not match.");
+		return 0;
+	}
+	if(offset >= dst->frames)
+		return 1;
+	
+	size_t frames = dst->frames - offset < src->frames ? dst->frames - offset : src->frames;
+	size_t n = frames * src->channels;
+	size_t i = 0;
+	
+	if(src->type == SAMPLES_F32) {
+		float* d = (float*) dst->data + offset * dst->channels;
+		const float* p = (const float*) src->data;
+#if defined(__SSE2__)
+		__m128 g = _mm_set1_ps(gain);
+		for(; i+4<=n; i+=4)
+			_mm_storeu_ps(d + i, _mm_add_ps(_mm_loadu_ps(d + i), _mm_mul_ps(_mm_load_ps(p + i), g)));
+#endif
+		for(; i<n; i++)
+			d[i] += p[i] * gain;
+	}
+	
+	else if(src->type == SAMPLES_S16) {
+		short* d = (short*) dst->data + offset * dst->channels;
+		const short* p = (const short*) src->data;
+#if defined(__SSE2__)
+		__m128 g = _mm_set1_ps(gain);
+		for(; i+8<=n; i+=8) {
+			__m128i v = samples_gain8(_mm_load_si128((const __m128i*) (p + i)), g);
+			_mm_storeu_si128((__m128i*) (d + i), _mm_adds_epi16(_mm_loadu_si128((__m128i*) (d + i)), v));
+		}
+#endif
+		for(; i<n; i++)
+			d[i] = samples_adds(d[i], samples_clip(p[i] * gain));
+	}
+	
+	else {
+		unsigned char* d = dst->data + offset * dst->channels;
+		const unsigned char* p = src->data;
+#if defined(__SSE2__)
+		__m128 g = _mm_set1_ps(gain);
+		for(; i+16<=n; i+=16) {
+			__m128i dlo, dhi, plo, phi;
+			samples_widen(_mm_loadu_si128((__m128i*) (d + i)), &dlo, &dhi);
+			samples_widen(_mm_load_si128((const __m128i*) (p + i)), &plo, &phi);
+			dlo = _mm_adds_epi16(dlo, samples_gain8(plo, g));
+			dhi = _mm_adds_epi16(dhi, samples_gain8(phi, g));
+			_mm_storeu_si128((__m128i*) (d + i), samples_narrow(dlo, dhi));
+		}
+#endif
+		for(; i<n; i++)
+			d[i] = samples_s16_u8(samples_adds(samples_u8_s16(d[i]), samples_clip(samples_u8_s16(p[i]) * gain)));
+	}
+	return 1;
+}
+
+Samples* samples_downmix(const Samples* s) {
+	Samples* out = samples_new(s->type, 1, s->sample_rate, s->frames);
+	if(out == 0)
+		return 0;
+	
+	unsigned int ch = s->channels;
+	size_t n = s->frames;
+	size_t i = 0;
+	
+	if(s->type == SAMPLES_F32) {
+		const float* p = (const float*) s->data;
+		float* o = (float*) out->data;
+#if defined(__SSE2__)
+		if(ch == 2) {
+			__m128 half = _mm_set1_ps(0.5f);
+			for(; i+4<=n; i+=4) {
+				__m128 a = _mm_load_ps(p + 2*i);
+				__m128 b = _mm_load_ps(p + 2*i + 4);
+				__m128 l = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+				__m128 r = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+				_mm_store_ps(o + i, _mm_mul_ps(_mm_add_ps(l, r), half));
+			}
+		}
+#endif
+		float scale = 1.0f / ch;
+		for(; i<n; i++) {
+			float sum = 0;
+			for(unsigned int c=0; c<ch; c++)
+				sum += p[i*ch + c];
+			o[i] = sum * scale;
+		}
+	}
+	
+	else if(s->type == SAMPLES_S16) {
+		const short* p = (const short*) s->data;
+		short* o = (short*) out->data;
+#if defined(__SSE2__)
+		if(ch == 2) {
+			__m128i ones = _mm_set1_epi16(1);
+			for(; i+8<=n; i+=8) {
+				__m128i a = _mm_srai_epi32(_mm_madd_epi16(_mm_load_si128((const __m128i*) (p + 2*i)), ones), 1);
+				__m128i b = _mm_srai_epi32(_mm_madd_epi16(_mm_load_si128((const __m128i*) (p + 2*i + 8)), ones), 1);
+				_mm_store_si128((__m128i*) (o + i), _mm_packs_epi32(a, b));
+			}
+		}
+#endif
+		for(; i<n; i++) {
+			int sum = 0;
+			for(unsigned int c=0; c<ch; c++)
+				sum += p[i*ch + c];
+			o[i] = (sum >= 0 ? sum : sum - (int) ch + 1) / (int) ch;
+		}
+	}
+	
+	else {
+		const unsigned char* p = s->data;
+		unsigned char* o = out->data;
+#if defined(__SSE2__)
+		if(ch == 2) {
+			__m128i low = _mm_set1_epi16(0xFF);
+			for(; i+16<=n; i+=16) {
+				__m128i a = _mm_load_si128((const __m128i*) (p + 2*i));
+				__m128i b = _mm_load_si128((const __m128i*) (p + 2*i + 16));
+				__m128i sa = _mm_srli_epi16(_mm_add_epi16(_mm_and_si128(a, low), _mm_srli_epi16(a, 8)), 1);
+				__m128i sb = _mm_srli_epi16(_mm_add_epi16(_mm_and_si128(b, low), _mm_srli_epi16(b, 8)), 1);
+				_mm_store_si128((__m128i*) (o + i), _mm_packus_epi16(sa, sb));
+			}
+		}
+#endif
+		for(; i<n; i++) {
+			unsigned int sum = 0;
+			for(unsigned int c=0; c<ch; c++)
+				sum += p[i*ch + c];
+			o[i] = sum / ch;
+		}
+	}
+	return out;
+}
+
+Samples* samples_interleave(Samples* const* planes, unsigned int count) {
+	if(count == 0)
+		return 0;
+	size_t frames = planes[0]->frames;
+	for(unsigned int c=0; c<count; c++) {
+		if(planes[c]->channels != 1 || planes[c]->type != planes[0]->type) {
+			puts("Interleaved samples must be mono and of one type.");
+			return 0;
+		}
+		if(planes[c]->frames < frames)
+			frames = planes[c]->frames;
+	}
+	
+	Samples* out = samples_new(planes[0]->type, count, planes[0]->sample_rate, frames);
+	if(out == 0)
+		return 0;
+	
+	size_t sz = samples_type_size(out->type);
+	size_t i = 0;
+#if defined(__SSE2__)
+	if(count == 2) {
+		const unsigned char* l = planes[0]->data;
+		const unsigned char* r = planes[1]->data;
+		unsigned char* o = out->data;
+		size_t step = 16 / sz;
+		for(; i+step<=frames; i+=step) {
+			__m128i a = _mm_load_si128((const __m128i*) (l + i*sz));
+			__m128i b = _mm_load_si128((const __m128i*) (r + i*sz));
+			__m128i lo, hi;
+			if(sz == 1) {
+				lo = _mm_unpacklo_epi8(a, b);
+				hi = _mm_unpackhi_epi8(a, b);
+			} else if(sz == 2) {
+				lo = _mm_unpacklo_epi16(a, b);
+				hi = _mm_unpackhi_epi16(a, b);
+			} else {
+				lo = _mm_unpacklo_epi32(a, b);
+				hi = _mm_unpackhi_epi32(a, b);
+			}
+			_mm_store_si128((__m128i*) (o + 2*i*sz), lo);
+			_mm_store_si128((__m128i*) (o + 2*i*sz + 16), hi);
+		}
+	}
+#endif
+	for(; i<frames; i++)
+		for(unsigned int c=0; c<count; c++)
+			memcpy(out->data + (i*count + c) * sz, planes[c]->data + i*sz, sz);
+	return out;
+}
+
+int samples_deinterleave(const Samples* s, Samples** planes) {
+	unsigned int ch = s->channels;
+	for(unsigned int c=0; c<ch; c++) {
+		planes[c] = samples_new(s->type, 1, s->sample_rate, s->frames);
+		if(planes[c] == 0) {
+			while(c-- > 0)
+				samples_free(planes[c]);
+			return 0;
+		}
+	}
+	
+	size_t sz = samples_type_size(s->type);
+	size_t n = s->frames;
+	size_t i = 0;
+#if defined(__SSE2__)
+	if(ch == 2) {
+		const unsigned char* p = s->data;
+		unsigned char* l = planes[0]->data;
+		unsigned char* r = planes[1]->data;
+		size_t step = 16 / sz;
+		for(; i+step<=n; i+=step) {
+			__m128i a = _mm_load_si128((const __m128i*) (p + 2*i*sz));
+			__m128i b = _mm_load_si128((const __m128i*) (p + 2*i*sz + 16));
+			__m128i even, odd;
+			if(sz == 1) {
+				__m128i low = _mm_set1_epi16(0xFF);
+				even = _mm_packus_epi16(_mm_and_si128(a, low), _mm_and_si128(b, low));
+				odd = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+			} else if(sz == 2) {
+				even = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16), _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+				odd = _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+			} else {
+				__m128 fa = _mm_castsi128_ps(a);
+				__m128 fb = _mm_castsi128_ps(b);
+				even = _mm_castps_si128(_mm_shuffle_ps(fa, fb, _MM_SHUFFLE(2, 0, 2, 0)));
+				odd = _mm_castps_si128(_mm_shuffle_ps(fa, fb, _MM_SHUFFLE(3, 1, 3, 1)));
+			}
+			_mm_store_si128((__m128i*) (l + i*sz), even);
+			_mm_store_si128((__m128i*) (r + i*sz), odd);
+		}
+	}
+#endif
+	for(; i<n; i++)
+		for(unsigned int c=0; c<ch; c++)
+			memcpy(planes[c]->data + i*sz, s->data + (i*ch + c) * sz, sz);
+	return 1;
+}
+
+Samples* samples_convert(const Samples* s, int type) {
+	if(type == s->type)
+		return samples_slice(s, 0, s->frames);
+	
+  // 8 bit and float only meet through 16 bit
+	if((s->type == SAMPLES_U8 && type == SAMPLES_F32) || (s->type == SAMPLES_F32 && type == SAMPLES_U8)) {
+		Samples* mid = samples_convert(s, SAMPLES_S16);
+		if(mid == 0)
+			return 0;
+		Samples* out = samples_convert(mid, type);
+		samples_free(mid);
+		return out;
+	}
+	
+	Samples* out = samples_new(type, s->channels, s->sample_rate, s->frames);
+	if(out == 0)
+		return 0;
+	
+	size_t n = s->frames * s->channels;
+	size_t i = 0;
+	
+	if(s->type == SAMPLES_U8) {
+		const unsigned char* p = s->data;
+		short* o = (short*) out->data;
+#if defined(__SSE2__)
+		for(; i+16<=n; i+=16) {
+			__m128i lo, hi;
+			samples_widen(_mm_load_si128((const __m128i*) (p + i)), &lo, &hi);
+			_mm_store_si128((__m128i*) (o + i), lo);
+			_mm_store_si128((__m128i*) (o + i + 8), hi);
+		}
+#endif
+		for(; i<n; i++)
+			o[i] = samples_u8_s16(p[i]);
+	}
+	
+	else if(s->type == SAMPLES_S16 && type == SAMPLES_U8) {
+		const short* p = (const short*) s->data;
+		unsigned char* o = out->data;
+#if defined(__SSE2__)
+		for(; i+16<=n; i+=16) {
+			__m128i lo = _mm_load_si128((const __m128i*) (p + i));
+			__m128i hi = _mm_load_si128((const __m128i*) (p + i + 8));
+			_mm_store_si128((__m128i*) (o + i), samples_narrow(lo, hi));
+		}
+#endif
+		for(; i<n; i++)
+			o[i] = samples_s16_u8(p[i]);
+	}
+	
+	else if(s->type == SAMPLES_S16) {
+		const short* p = (const short*) s->data;
+		float* o = (float*) out->data;
+#if defined(__SSE2__)
+		__m128 scale = _mm_set1_ps(1.0f / 32768);
+		for(; i+8<=n; i+=8) {
+			__m128i v = _mm_load_si128((const __m128i*) (p + i));
+			_mm_store_ps(o + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)), scale));
+			_mm_store_ps(o + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16)), scale));
+		}
+#endif
+		for(; i<n; i++)
+			o[i] = p[i] * (1.0f / 32768);
+	}
+	
+	else {
+		const float* p = (const float*) s->data;
+		short* o = (short*) out->data;
+#if defined(__SSE2__)
+		__m128 scale = _mm_set1_ps(32768);
+		__m128 top = _mm_set1_ps(32767);
+		__m128 bottom = _mm_set1_ps(-32768);
+		for(; i+8<=n; i+=8) {
+			__m128 a = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_load_ps(p + i), scale), top), bottom);
+			__m128 b = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_load_ps(p + i + 4), scale), top), bottom);
+			_mm_store_si128((__m128i*) (o + i), _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+		}
+#endif
+		for(; i<n; i++)
+			o[i] = samples_clip(p[i] * 32768);
+	}
+	return out;
+}
+
+#if defined(__SSE2__)
+// reverses the order of the frames within 16 bytes
+static inline __m128i samples_flip(__m128i v, size_t frame_size) {
+	if(frame_size == 1)
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+	if(frame_size <= 2) {
+		v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+		v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+		return _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+	}
+	if(frame_size == 4)
+		return _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+	return _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+}
+#endif
+
+void samples_reverse(Samples* s) {
+	size_t fs = s->channels * samples_type_size(s->type);
+	size_t size = samples_size(s);
+	size_t front = 0;
+	size_t back = size;
+	
+  // whole vectors from both ends while they do not meet
+#if defined(__SSE2__)
+	if(fs == 1 || fs == 2 || fs == 4 || fs == 8) {
+		for(; back - front >= 32; front+=16, back-=16) {
+			__m128i a = _mm_load_si128((__m128i*) (s->data + front));
+			__m128i b = _mm_loadu_si128((__m128i*) (s->data + back - 16));
+			_mm_store_si128((__m128i*) (s->data + front), samples_flip(b, fs));
+			_mm_storeu_si128((__m128i*) (s->data + back - 16), samples_flip(a, fs));
+		}
+	}
+#endif
+	
+	for(; back - front >= 2 * fs; front+=fs, back-=fs)
+		for(size_t k=0; k<fs; k++) {
+			unsigned char t = s->data[front + k];
+			s->data[front + k] = s->data[back - fs + k];
+			s->data[back - fs + k] = t;
+		}
+}
+
+Samples* samples_slice(const Samples* s, size_t first, size_t count) {
+	if(first > s->frames)
+		first = s->frames;
+	if(count > s->frames - first)
+		count = s->frames - first;
+	size_t fs = s->channels * samples_type_size(s->type);
+	return samples_from(s->data + first * fs, s->type, s->channels, s->sample_rate, count);
+}
@@ -0,0 +1,82 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#define SAMPLES_U8		0 // unsigned 8 bit, as AL stores it
+#define SAMPLES_S16		1
+#define SAMPLES_F32		2
+
+#define SAMPLES_ALIGN	32
+
+// interleaved pcm in a 32 byte aligned block that the kernels below edit
+// in place or copy into a new block
+typedef struct Samples {
+	int type;
+	unsigned int channels;
+	unsigned int sample_rate;
+	size_t frames;
+	unsigned char* data;
+} Samples;
+
+size_t samples_type_size(int type);
+
+// bytes of sample data
+size_t samples_size(const Samples* s);
+
+// zero filled, returns 0 on failure
+Samples* samples_new(int type, unsigned int channels, unsigned int sample_rate, size_t frames);
+
+// copies frames of data in
+Samples* samples_from(const void* data, int type, unsigned int channels, unsigned int sample_rate, size_t frames);
+
+void samples_free(Samples* s);
+
+// scales every sample, clipping integer types
+void samples_gain(Samples* s, float gain);
+
+// adds src * gain into dst starting at frame offset, both must share
+// type and channel count; returns 0 when they do not
+int samples_mix(Samples* dst, const Samples* src, float gain, size_t offset);
+
+// averages the channels into a new mono block
+Samples* samples_downmix(const Samples* s);
+
+// weaves count mono blocks of one type into a new block, as long as the
+// shortest of them
+Samples* samples_interleave(Samples* const* planes, unsigned int count);
+
+// splits into s->channels new mono blocks written to planes, returns 0 on
+// failure with nothing allocated
+int samples_deinterleave(const Samples* s, Samples** planes);
+
+// new block of another sample type
+Samples* samples_convert(const Samples* s, int type);
+
+void samples_reverse(Samples* s);
+
+// new block holding count frames from first, clamped to what exists
+Samples* samples_slice(const Samples* s, size_t first, size_t count);
@@ -0,0 +1,200 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "sound.h"
+#include "vorbis.h"
+#include "flac.h"
+#include "adpcm.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+
+WaveData* sound_load(const char* path) {
+	
+  // open and read all file contents
+	FILE* f = 0;
+	if((f = fopen(path, "rb")) == 0) {
+		puts("Could not open file.");
+		return 0;
+	}
+	
+	fseek(f, 0, SEEK_END);
+	long file_size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	
+	unsigned char* buffer = malloc(file_size * sizeof(unsigned char));
+	if(buffer == 0) {
+		puts("Could not allocate memory.");
+		fclose(f);
+		return 0;
+	}
+	size_t read = fread(buffer, 1, file_size, f);
+	fclose(f);
+	
+	return sound_parse(buffer, read);
+}
+
+WaveData* sound_parse(unsigned char* buffer, size_t size) {
+	if(size >= 4 && memcmp(buffer, "OggS", 4) == 0)
+		return vorbis_parse(buffer, size);
+	if(size >= 4 && memcmp(buffer, "fLaC", 4) == 0)
+		return flac_parse(buffer, size);
+	return wave_parse(buffer, size);
+}
+
+
+// streams plain pcm straight out of a wave file
+typedef struct WaveDecoder {
+	Decoder base;
+	FILE* f;
+	unsigned int bps;
+	long data_offset;
+	size_t data_size;
+	size_t data_read;
+	unsigned char* scratch;
+	size_t scratch_size;
+} WaveDecoder;
+
+static size_t wave_decoder_read(Decoder* d, short* out, size_t frames) {
+	WaveDecoder* wd = (WaveDecoder*) d;
+	size_t frame_size = d->channels * (wd->bps / 8);
+	size_t left = (wd->data_size - wd->data_read) / frame_size;
+	if(frames > left)
+		frames = left;
+	if(frames == 0)
+		return 0;
+	
+	if(wd->bps == 16) {
+		frames = fread(out, frame_size, frames, wd->f);
+	} else {
+		if(wd->scratch_size < frames * frame_size) {
+			unsigned char* s = realloc(wd->scratch, frames * frame_size);
+			if(s == 0)
+				return 0;
+			wd->scratch = s;
+			wd->scratch_size = frames * frame_size;
+		}
+		frames = fread(wd->scratch, frame_size, frames, wd->f);
+		for(size_t i=0; i<frames * d->channels; i++)
+			out[i] = (short) ((wd->scratch[i] - 128) * 256);
+	}
+	wd->data_read += frames * frame_size;
+	return frames;
+}
+
+static int wave_decoder_rewind(Decoder* d) {
+	WaveDecoder* wd = (WaveDecoder*) d;
+	wd->data_read = 0;
+	return fseek(wd->f, wd->data_offset, SEEK_SET) == 0;
+}
+
+static void wave_decoder_close(Decoder* d) {
+	WaveDecoder* wd = (WaveDecoder*) d;
+	fclose(wd->f);
+	free(wd->scratch);
+	free(wd);
+}
+
+static unsigned int sound_u32(const unsigned char* p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
+static Decoder* wave_decoder_open(FILE* f) {
+	
+	unsigned char head[12];
+	if(fread(head, 1, 12, f) != 12 || memcmp(head, "RIFF", 4) != 0 || memcmp(head + 8, "WAVE", 4) != 0) {
+		puts("Invalid file header!");
+		fclose(f);
+		return 0;
+	}
+	
+	WaveDecoder* wd = calloc(1, sizeof(WaveDecoder));
+	if(wd == 0) {
+		puts("Could not allocate memory.");
+		fclose(f);
+		return 0;
+	}
+	
+  // walk the chunks up to data without reading the payload
+	unsigned int format = 0;
+	unsigned char chunk[24];
+	while(fread(chunk, 1, 8, f) == 8) {
+		size_t chunk_size = sound_u32(chunk + 4);
+		if(memcmp(chunk, "fmt ", 4) == 0 && chunk_size >= 16) {
+			if(fread(chunk + 8, 1, 16, f) != 16)
+				break;
+			format = chunk[8] | (chunk[9] << 8);
+			wd->base.channels = chunk[10] | (chunk[11] << 8);
+			wd->base.sample_rate = sound_u32(chunk + 12);
+			wd->bps = chunk[22] | (chunk[23] << 8);
+			chunk_size -= 16;
+		} else if(memcmp(chunk, "data", 4) == 0) {
+			wd->data_offset = ftell(f);
+			wd->data_size = chunk_size;
+			break;
+		}
+		if(fseek(f, chunk_size + (chunk_size & 1), SEEK_CUR) != 0)
+			break;
+	}
+	
+	wd->f = f;
+	wd->base.read = wave_decoder_read;
+	wd->base.rewind = wave_decoder_rewind;
+	wd->base.close = wave_decoder_close;
+	
+	if(wd->data_offset == 0 || format != WAVE_FORMAT_PCM || (wd->bps != 8 && wd->bps != 16)
+		|| wd->base.channels == 0 || wd->base.channels > 2) {
+		puts("Unsupported stream format!");
+		wave_decoder_close(&wd->base);
+		return 0;
+	}
+	return &wd->base;
+}
+
+
+Decoder* decoder_open(const char* path) {
+	
+	FILE* f = 0;
+	if((f = fopen(path, "rb")) == 0) {
+		puts("Could not open file.");
+		return 0;
+	}
+	
+	unsigned char magic[4] = {0};
+	size_t n = fread(magic, 1, 4, f);
+	if(n == 4 && memcmp(magic, "OggS", 4) == 0) {
+		fclose(f);
+		return vorbis_decoder_open(path);
+	}
+	
+	rewind(f);
+	return wave_decoder_open(f);
+}
+
+void decoder_close(Decoder* d) {
+	if(d != 0)
+		d->close(d);
+}
@@ -0,0 +1,53 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include "wave.h"
+
+// loads any supported file, picking the parser from its leading bytes
+WaveData* sound_load(const char* path);
+
+// same as sound_load for a file already in memory, takes ownership of buffer
+WaveData* sound_parse(unsigned char* buffer, size_t size);
+
+
+// incremental decoding into interleaved 16 bit pcm, used by streams
+typedef struct Decoder Decoder;
+
+struct Decoder {
+	unsigned int channels;
+	unsigned int sample_rate;
+	// fills out with up to frames frames, returns 0 at the end
+	size_t (*read)(Decoder* d, short* out, size_t frames);
+	// goes back to the first frame, returns 0 on failure
+	int (*rewind)(Decoder* d);
+	void (*close)(Decoder* d);
+};
+
+Decoder* decoder_open(const char* path);
+
+void decoder_close(Decoder* d);
@@ -0,0 +1,137 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#if defined(OPENLUAL_STATS)
+
+#include "stats.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+
+// one per thread, written only by its owner and summed by readers; relaxed
+// atomics keep that free of tearing without costing a fence per call
+typedef struct StatsBlock {
+	struct {
+		atomic_uint_least64_t calls;
+		atomic_uint_least64_t total_ns;
+		atomic_uint_least64_t buckets[STATS_BUCKETS];
+	} entries[STATS_MAX];
+	struct StatsBlock* next;
+} StatsBlock;
+
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static const char* stats_names[STATS_MAX];
+static atomic_int stats_used;
+static StatsBlock* stats_blocks; // every thread's, kept after it exits
+static _Thread_local StatsBlock* stats_mine;
+
+
+static StatsBlock* stats_block(void) {
+	if(stats_mine != 0)
+		return stats_mine;
+	StatsBlock* b = calloc(1, sizeof(StatsBlock));
+	if(b == 0) {
+		puts("Could not allocate memory.");
+		return 0;
+	}
+	pthread_mutex_lock(&stats_lock);
+	b->next = stats_blocks;
+	stats_blocks = b;
+	pthread_mutex_unlock(&stats_lock);
+	stats_mine = b;
+	return b;
+}
+
+static unsigned int stats_bucket(uint64_t ns) {
+	unsigned int b = 0;
+	while(ns > 1 && b < STATS_BUCKETS - 1) {
+		ns >>= 1;
+		b++;
+	}
+	return b;
+}
+
+
+int stats_register(const char* name) {
+	pthread_mutex_lock(&stats_lock);
+	int used = atomic_load(&stats_used);
+	int id = -1;
+	for(int i=0; i<used && id < 0; i++)
+		if(strcmp(stats_names[i], name) == 0)
+			id = i;
+	if(id < 0 && used < STATS_MAX) {
+		id = used;
+		stats_names[id] = name;
+		atomic_store(&stats_used, used + 1);
+	}
+	pthread_mutex_unlock(&stats_lock);
+	return id;
+}
+
+size_t stats_count(void) {
+	return atomic_load(&stats_used);
+}
+
+const char* stats_name(int id) {
+	return stats_names[id];
+}
+
+void stats_record(int id, uint64_t ns) {
+	StatsBlock* b = stats_block();
+	if(b == 0 || id < 0)
+		return;
+	atomic_fetch_add_explicit(&b->entries[id].calls, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&b->entries[id].total_ns, ns, memory_order_relaxed);
+	atomic_fetch_add_explicit(&b->entries[id].buckets[stats_bucket(ns)], 1, memory_order_relaxed);
+}
+
+void stats_sum(int id, StatsEntry* out) {
+	memset(out, 0, sizeof(StatsEntry));
+	pthread_mutex_lock(&stats_lock);
+	for(StatsBlock* b=stats_blocks; b!=0; b=b->next) {
+		out->calls += atomic_load_explicit(&b->entries[id].calls, memory_order_relaxed);
+		out->total_ns += atomic_load_explicit(&b->entries[id].total_ns, memory_order_relaxed);
+		for(int k=0; k<STATS_BUCKETS; k++)
+			out->buckets[k] += atomic_load_explicit(&b->entries[id].buckets[k], memory_order_relaxed);
+	}
+	pthread_mutex_unlock(&stats_lock);
+}
+
+void stats_reset(void) {
+	pthread_mutex_lock(&stats_lock);
+	for(StatsBlock* b=stats_blocks; b!=0; b=b->next)
+		for(int i=0; i<STATS_MAX; i++) {
+			atomic_store_explicit(&b->entries[i].calls, 0, memory_order_relaxed);
+			atomic_store_explicit(&b->entries[i].total_ns, 0, memory_order_relaxed);
+			for(int k=0; k<STATS_BUCKETS; k++)
+				atomic_store_explicit(&b->entries[i].buckets[k], 0, memory_order_relaxed);
+		}
+	pthread_mutex_unlock(&stats_lock);
+}
+
+#endif
@@ -0,0 +1,56 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// call counters for the instrumented build, see OPENLUAL_STATS in build.sh;
+// without it this is all left out
+
+#define STATS_MAX		128 // counted functions
+#define STATS_BUCKETS	32 // bucket b holds calls of 2^b up to 2^(b+1) ns
+
+typedef struct StatsEntry {
+	uint64_t calls;
+	uint64_t total_ns;
+	uint64_t buckets[STATS_BUCKETS];
+} StatsEntry;
+
+// names a counter and returns its id, or -1 once STATS_MAX are taken;
+// ids are handed out once per name
+int stats_register(const char* name);
+
+size_t stats_count(void);
+
+const char* stats_name(int id);
+
+// adds one call to the calling thread's counters
+void stats_record(int id, uint64_t ns);
+
+// counter id summed over every thread that recorded
+void stats_sum(int id, StatsEntry* out);
+
+void stats_reset(void);
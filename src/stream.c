@@ -0,0 +1,231 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "stream.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "AL/al.h"
+#include "account.h"
+
+
+static void* stream_worker(void* arg) {
+	Stream* s = arg;
+	size_t frame_size = s->decoder->channels * sizeof(short);
+	size_t chunk = s->buffer_size / frame_size;
+	short* pcm = malloc(chunk * frame_size);
+	if(pcm == 0) {
+		puts("Could not allocate memory.");
+		atomic_store(&s->finished, 1);
+		return 0;
+	}
+	
+	while(atomic_load(&s->running)) {
+		
+		if(!atomic_load(&s->finished) && ring_space(&s->ring) >= chunk * frame_size) {
+			size_t frames = s->decoder->read(s->decoder, pcm, chunk);
+			if(frames == 0) {
+				if(!s->loop || !s->decoder->rewind(s->decoder))
+					atomic_store(&s->finished, 1);
+				continue;
+			}
+			ring_write(&s->ring, pcm, frames * frame_size);
+			continue;
+		}
+		
+	  // full or done, sleep until stream_update drains some
+		struct timespec ts;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_nsec += 20000000;
+		if(ts.tv_nsec >= 1000000000) {
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000;
+		}
+		pthread_mutex_lock(&s->lock);
+		if(atomic_load(&s->running))
+			pthread_cond_timedwait(&s->wake, &s->lock, &ts);
+		pthread_mutex_unlock(&s->lock);
+	}
+	
+	free(pcm);
+	return 0;
+}
+
+// moves one buffer worth of the ring into buffer and queues it, returns 0 when the ring is short
+static int stream_fill(Stream* s, unsigned int buffer) {
+	size_t used = ring_used(&s->ring);
+	size_t n = s->buffer_size;
+	if(used < n) {
+	  // a partial buffer is only worth queueing at the very end
+		if(!atomic_load(&s->finished) || used == 0)
+			return 0;
+		n = used;
+	}
+	n = ring_read(&s->ring, s->scratch, n);
+	
+	pthread_mutex_lock(&s->lock);
+	pthread_cond_signal(&s->wake);
+	pthread_mutex_unlock(&s->lock);
+	
+	account_buffer_data(buffer, s->format, s->scratch, n, s->decoder->sample_rate);
+	account_queue_buffers(s->source, 1, &buffer);
+	return 1;
+}
+
+
+Stream* stream_open(const char* path, unsigned int source, unsigned int buffer_count, size_t buffer_frames, int loop) {
+	Decoder* d = decoder_open(path);
+	if(d == 0)
+		return 0;
+	return stream_open_decoder(d, source, buffer_count, buffer_frames, loop);
+}
+
+Stream* stream_open_decoder(Decoder* d, unsigned int source, unsigned int buffer_count, size_t buffer_frames, int loop) {
+	
+	if(d->channels == 0 || d->channels > 2) {
+		puts("Unsupported stream channel count!");
+		decoder_close(d);
+		return 0;
+	}
+	
+	Stream* s = calloc(1, sizeof(Stream));
+	if(s == 0) {
+		puts("Could not allocate memory.");
+		decoder_close(d);
+		return 0;
+	}
+	
+	if(buffer_count < 2)
+		buffer_count = 2;
+	if(buffer_frames == 0)
+		buffer_frames = 4096;
+	
+	s->decoder = d;
+	s->loop = loop;
+	s->source = source;
+	s->format = d->channels == 1 ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
+	s->buffer_count = buffer_count;
+	s->buffer_size = buffer_frames * d->channels * sizeof(short);
+	s->buffers = malloc(1 * buffer_count * sizeof(unsigned int));
+	s->idle = malloc(1 * buffer_count * sizeof(unsigned int));
+	s->scratch = malloc(s->buffer_size);
+	
+  // the ring holds a queue's worth of decoded audio ahead of the source
+	if(s->buffers == 0 || s->idle == 0 || s->scratch == 0 || !ring_init(&s->ring, s->buffer_size * buffer_count)) {
+		puts("Could not allocate memory.");
+		free(s->buffers);
+		free(s->idle);
+		free(s->scratch);
+		ring_free(&s->ring);
+		decoder_close(d);
+		free(s);
+		return 0;
+	}
+	
+	account_gen_buffers(buffer_count, s->buffers, "stream");
+	memcpy(s->idle, s->buffers, buffer_count * sizeof(unsigned int));
+	s->idle_count = buffer_count;
+	alSourcei(source, AL_BUFFER, 0);
+	
+	pthread_mutex_init(&s->lock, 0);
+	pthread_cond_init(&s->wake, 0);
+	atomic_init(&s->running, 1);
+	atomic_init(&s->finished, 0);
+	if(pthread_create(&s->thread, 0, stream_worker, s) != 0) {
+		puts("Could not start stream thread.");
+		atomic_store(&s->running, 0);
+		stream_close(s);
+		return 0;
+	}
+	
+  // prime the queue so the caller can play right away
+	for(int tries = 0; tries < 200 && s->idle_count > 0; tries++) {
+		if(stream_fill(s, s->idle[s->idle_count - 1]))
+			s->idle_count--;
+		else if(atomic_load(&s->finished) && ring_used(&s->ring) == 0)
+			break;
+		else {
+			struct timespec ts = {0, 1000000};
+			nanosleep(&ts, 0);
+		}
+	}
+	
+	return s;
+}
+
+int stream_update(Stream* s) {
+	
+	int processed = 0;
+	alGetSourcei(s->source, AL_BUFFERS_PROCESSED, &processed);
+	while(processed-- > 0) {
+		unsigned int buffer = 0;
+		account_unqueue_buffers(s->source, 1, &buffer);
+		s->idle[s->idle_count++] = buffer;
+	}
+	
+	while(s->idle_count > 0 && stream_fill(s, s->idle[s->idle_count - 1]))
+		s->idle_count--;
+	
+	int state = 0;
+	int queued = 0;
+	alGetSourcei(s->source, AL_SOURCE_STATE, &state);
+	alGetSourcei(s->source, AL_BUFFERS_QUEUED, &queued);
+	if(state == AL_PLAYING)
+		s->started = 1;
+	
+  // an underrun stops the source, pick it back up once data arrives
+	else if(s->started && queued > 0 && state == AL_STOPPED)
+		alSourcePlay(s->source);
+	
+	return !(atomic_load(&s->finished) && ring_used(&s->ring) == 0 && queued == 0);
+}
+
+void stream_close(Stream* s) {
+	if(s == 0)
+		return;
+	
+	if(atomic_load(&s->running)) {
+		pthread_mutex_lock(&s->lock);
+		atomic_store(&s->running, 0);
+		pthread_cond_signal(&s->wake);
+		pthread_mutex_unlock(&s->lock);
+		pthread_join(s->thread, 0);
+	}
+	
+	alSourceStop(s->source);
+	alSourcei(s->source, AL_BUFFER, 0);
+	account_delete_buffers(s->buffer_count, s->buffers);
+	
+	pthread_cond_destroy(&s->wake);
+	pthread_mutex_destroy(&s->lock);
+	ring_free(&s->ring);
+	decoder_close(s->decoder);
+	free(s->buffers);
+	free(s->idle);
+	free(s->scratch);
+	free(s);
+}
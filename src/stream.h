@@ -0,0 +1,69 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "sound.h"
+#include "ring.h"
+
+// A stream decodes on its own thread into a small ring; stream_update,
+// called from the thread owning the AL context, moves the ring into the
+// source's buffer queue. Memory stays at a few buffers whatever the length.
+typedef struct Stream {
+	Decoder* decoder;
+	Ring ring;
+	
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	atomic_int running;
+	atomic_int finished; // decoder ran out and is not looping
+	int loop;
+	
+	unsigned int source;
+	int format;
+	unsigned int buffer_count;
+	unsigned int* buffers;
+	unsigned int idle_count;
+	unsigned int* idle; // buffers not currently queued
+	size_t buffer_size;
+	unsigned char* scratch;
+	int started;
+} Stream;
+
+// opens path and queues its first buffers on source, returns 0 on failure
+Stream* stream_open(const char* path, unsigned int source, unsigned int buffer_count, size_t buffer_frames, int loop);
+
+// same for any decoder, which the stream takes ownership of
+Stream* stream_open_decoder(Decoder* d, unsigned int source, unsigned int buffer_count, size_t buffer_frames, int loop);
+
+// refills processed buffers, returns 0 once everything has played
+int stream_update(Stream* s);
+
+// stops the source and releases its buffers
+void stream_close(Stream* s);
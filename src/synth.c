@@ -0,0 +1,388 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "synth.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#	include <emmintrin.h>
+#endif
+
+#define SYNTH_BLOCK 256
+
+
+typedef struct SynthState {
+	double phase; // in cycles
+	double mod_phase;
+	unsigned int noise;
+	float held;
+} SynthState;
+
+static size_t synth_seconds(float seconds, unsigned int sample_rate) {
+	return seconds > 0 ? (size_t) (seconds * sample_rate + 0.5f) : 0;
+}
+
+static size_t synth_voice_end(const SynthVoice* v, unsigned int sample_rate) {
+	return synth_seconds(v->start, sample_rate) + synth_seconds(v->length, sample_rate) + synth_seconds(v->release, sample_rate);
+}
+
+size_t synth_frames(const SynthVoice* voices, size_t count, unsigned int sample_rate) {
+	size_t frames = 0;
+	for(size_t i=0; i<count; i++) {
+		size_t end = synth_voice_end(&voices[i], sample_rate);
+		if(end > frames)
+			frames = end;
+	}
+	return frames;
+}
+
+static void synth_reset(SynthState* state, size_t count) {
+	for(size_t i=0; i<count; i++) {
+		state[i].phase = 0;
+		state[i].mod_phase = 0;
+		state[i].noise = 0x9E3779B9u ^ (unsigned int) i;
+		state[i].held = 0;
+	}
+}
+
+
+// sin(2 pi x) for any x, folded to a quarter wave and evaluated as an odd
+// polynomial, about -100 dB from the real thing
+static void synth_sine(const float* x, float* out, size_t n) {
+	size_t i = 0;
+#if defined(__SSE2__)
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	const __m128 one = _mm_set1_ps(1);
+	const __m128 two = _mm_set1_ps(2);
+	for(; i+4<=n; i+=4) {
+		__m128 v = _mm_loadu_ps(x + i);
+		__m128 t = _mm_mul_ps(two, _mm_sub_ps(v, _mm_cvtepi32_ps(_mm_cvtps_epi32(v))));
+		__m128 s = _mm_and_ps(t, sign);
+		__m128 a = _mm_andnot_ps(sign, t);
+		a = _mm_min_ps(a, _mm_sub_ps(one, a));
+		__m128 u = _mm_or_ps(a, s);
+		__m128 u2 = _mm_mul_ps(u, u);
+		__m128 p = _mm_set1_ps(0.08214589f);
+		p = _mm_add_ps(_mm_mul_ps(p, u2), _mm_set1_ps(-0.59926453f));
+		p = _mm_add_ps(_mm_mul_ps(p, u2), _mm_set1_ps(2.55016404f));
+		p = _mm_add_ps(_mm_mul_ps(p, u2), _mm_set1_ps(-5.16771278f));
+		p = _mm_add_ps(_mm_mul_ps(p, u2), _mm_set1_ps(3.14159265f));
+		_mm_storeu_ps(out + i, _mm_mul_ps(p, u));
+	}
+#endif
+	for(; i<n; i++) {
+		float t = 2 * (x[i] - rintf(x[i]));
+		float a = fabsf(t);
+		a = fminf(a, 1 - a);
+		float u = copysignf(a, t);
+		float u2 = u * u;
+		out[i] = u * (3.14159265f + u2 * (-5.16771278f + u2 * (2.55016404f + u2 * (-0.59926453f + u2 * 0.08214589f))));
+	}
+}
+
+// smooths the step of a discontinuity t cycles away, dt is the phase step
+static inline float synth_blep(float t, float dt) {
+	if(t < dt) {
+		t /= dt;
+		return t + t - t * t - 1;
+	}
+	if(t > 1 - dt) {
+		t = (t - 1) / dt;
+		return t * t + t + t + 1;
+	}
+	return 0;
+}
+
+// envelope level at frame k of a voice held for hold frames
+static float synth_level(const SynthVoice* v, size_t k, size_t attack, size_t decay, size_t hold, size_t release) {
+	float level;
+	size_t t = k < hold ? k : hold;
+	if(t < attack)
+		level = (float) t / attack;
+	else if(t - attack < decay)
+		level = 1 - (1 - v->sustain) * (float) (t - attack) / decay;
+	else
+		level = v->sustain;
+	if(k >= hold)
+		level *= release > 0 ? 1 - (float) (k - hold) / release : 0;
+	return level;
+}
+
+// adds the part of voice v that falls in [position, position + n) to mix
+static void synth_voice(const SynthVoice* v, SynthState* st, unsigned int sample_rate, size_t position, float* mix, size_t n) {
+	size_t begin = synth_seconds(v->start, sample_rate);
+	size_t hold = synth_seconds(v->length, sample_rate);
+	size_t release = synth_seconds(v->release, sample_rate);
+	size_t end = begin + hold + release;
+	size_t a = position > begin ? position : begin;
+	size_t b = position + n < end ? position + n : end;
+	if(a >= b)
+		return;
+	size_t k = a - begin; // frame within the voice
+	mix += a - position;
+	n = b - a;
+	
+	float phase[SYNTH_BLOCK];
+	float step[SYNTH_BLOCK];
+	float wave[SYNTH_BLOCK];
+	float env[SYNTH_BLOCK];
+	
+  // per sample phase step, gliding geometrically over the held part
+	float nyquist = 0.5f * sample_rate;
+	float f0 = fminf(fabsf(v->frequency), nyquist);
+	float f1 = v->frequency_end > 0 ? fminf(v->frequency_end, nyquist) : f0;
+	double inc = f0 / sample_rate;
+	double ratio = 1;
+	if(f1 != f0 && f0 > 0 && hold > 0) {
+		inc *= pow(f1 / f0, (double) (k < hold ? k : hold) / hold);
+		ratio = pow(f1 / f0, 1.0 / hold);
+	}
+	for(size_t i=0; i<n; i++) {
+		step[i] = inc;
+		if(k + i < hold)
+			inc *= ratio;
+	}
+	
+	double p = st->phase;
+	for(size_t i=0; i<n; i++) {
+		phase[i] = p;
+		p += step[i];
+		if(p >= 1)
+			p -= floor(p);
+	}
+	st->phase = p;
+	
+  // frequency modulation bends the carrier phase by a sine of its own
+	if(v->fm_index != 0) {
+		double q = st->mod_phase;
+		for(size_t i=0; i<n; i++) {
+			wave[i] = q;
+			q += step[i] * v->fm_ratio;
+			q -= floor(q);
+		}
+		st->mod_phase = q;
+		synth_sine(wave, wave, n);
+		float depth = v->fm_index / 6.28318531f;
+		for(size_t i=0; i<n; i++) {
+			float x = phase[i] + depth * wave[i];
+			phase[i] = x - floorf(x);
+		}
+	}
+	
+	switch(v->wave) {
+		case SYNTH_SINE:
+			synth_sine(phase, wave, n);
+			break;
+		case SYNTH_SQUARE: {
+			float duty = v->duty > 0 && v->duty < 1 ? v->duty : 0.5f;
+			for(size_t i=0; i<n; i++) {
+				float x = phase[i];
+				float y = x + 1 - duty;
+				y -= floorf(y);
+				wave[i] = (x < duty ? 1 : -1) + synth_blep(x, step[i]) - synth_blep(y, step[i]);
+			}
+			break;
+		}
+		case SYNTH_SAW:
+			for(size_t i=0; i<n; i++)
+				wave[i] = 2 * phase[i] - 1 - synth_blep(phase[i], step[i]);
+			break;
+		case SYNTH_TRIANGLE:
+			for(size_t i=0; i<n; i++) {
+				float x = phase[i] + 0.25f;
+				wave[i] = 4 * fabsf(x - rintf(x)) - 1;
+			}
+			break;
+		case SYNTH_NOISE: {
+			unsigned int r = st->noise;
+			float held = st->held;
+			for(size_t i=0; i<n; i++) {
+				if(f0 == 0 || phase[i] < step[i] || k + i == 0) {
+					r ^= r << 13;
+					r ^= r >> 17;
+					r ^= r << 5;
+					held = (float) (int) r * (1.0f / 2147483648.0f);
+				}
+				wave[i] = held;
+			}
+			st->noise = r;
+			st->held = held;
+			break;
+		}
+		default:
+			return;
+	}
+	
+	size_t attack = synth_seconds(v->attack, sample_rate);
+	size_t decay = synth_seconds(v->decay, sample_rate);
+	for(size_t i=0; i<n; i++)
+		env[i] = synth_level(v, k + i, attack, decay, hold, release);
+	
+	size_t i = 0;
+	float amp = v->amplitude;
+#if defined(__SSE2__)
+	__m128 g = _mm_set1_ps(amp);
+	for(; i+4<=n; i+=4) {
+		__m128 s = _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(wave + i), _mm_loadu_ps(env + i)), g);
+		_mm_storeu_ps(mix + i, _mm_add_ps(_mm_loadu_ps(mix + i), s));
+	}
+#endif
+	for(; i<n; i++)
+		mix[i] += amp * env[i] * wave[i];
+}
+
+// clips the mix into 16 bit samples
+static void synth_pcm(const float* mix, short* out, size_t n) {
+	size_t i = 0;
+#if defined(__SSE2__)
+	__m128 scale = _mm_set1_ps(32767);
+	__m128 top = _mm_set1_ps(1);
+	__m128 bottom = _mm_set1_ps(-1);
+	for(; i+8<=n; i+=8) {
+		__m128 a = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(mix + i), top), bottom);
+		__m128 b = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(mix + i + 4), top), bottom);
+		__m128i lo = _mm_cvtps_epi32(_mm_mul_ps(a, scale));
+		__m128i hi = _mm_cvtps_epi32(_mm_mul_ps(b, scale));
+		_mm_storeu_si128((__m128i*) (out + i), _mm_packs_epi32(lo, hi));
+	}
+#endif
+	for(; i<n; i++) {
+		float s = mix[i] * 32767;
+		out[i] = s >= 32767 ? 32767 : s <= -32768 ? -32768 : (short) lrintf(s);
+	}
+}
+
+static void synth_block(const SynthVoice* voices, SynthState* state, size_t count, unsigned int sample_rate, size_t position, short* out, size_t n) {
+	float mix[SYNTH_BLOCK];
+	memset(mix, 0, n * sizeof(float));
+	for(size_t i=0; i<count; i++)
+		synth_voice(&voices[i], &state[i], sample_rate, position, mix, n);
+	synth_pcm(mix, out, n);
+}
+
+
+int synth_render(const SynthVoice* voices, size_t count, unsigned int sample_rate, short** out, size_t* frames) {
+	if(sample_rate == 0) {
+		puts("Invalid synth rate.");
+		return 0;
+	}
+	
+	size_t total = synth_frames(voices, count, sample_rate);
+	short* pcm = malloc((total > 0 ? total : 1) * sizeof(short));
+	SynthState* state = malloc((count > 0 ? count : 1) * sizeof(SynthState));
+	if(pcm == 0 || state == 0) {
+		puts("Could not allocate memory.");
+		free(pcm);
+		free(state);
+		return 0;
+	}
+	
+	synth_reset(state, count);
+	for(size_t pos=0; pos<total; pos+=SYNTH_BLOCK) {
+		size_t n = total - pos < SYNTH_BLOCK ? total - pos : SYNTH_BLOCK;
+		synth_block(voices, state, count, sample_rate, pos, pcm + pos, n);
+	}
+	free(state);
+	
+	*out = pcm;
+	*frames = total;
+	return 1;
+}
+
+
+typedef struct SynthDecoder {
+	Decoder base;
+	SynthVoice* voices;
+	SynthState* state;
+	size_t count;
+	size_t position;
+	size_t frames;
+} SynthDecoder;
+
+static size_t synth_read(Decoder* d, short* out, size_t frames) {
+	SynthDecoder* sd = (SynthDecoder*) d;
+	size_t done = 0;
+	while(done < frames && sd->position < sd->frames) {
+		size_t n = frames - done;
+		if(n > SYNTH_BLOCK)
+			n = SYNTH_BLOCK;
+		if(n > sd->frames - sd->position)
+			n = sd->frames - sd->position;
+		synth_block(sd->voices, sd->state, sd->count, d->sample_rate, sd->position, out + done, n);
+		sd->position += n;
+		done += n;
+	}
+	return done;
+}
+
+static int synth_rewind(Decoder* d) {
+	SynthDecoder* sd = (SynthDecoder*) d;
+	sd->position = 0;
+	synth_reset(sd->state, sd->count);
+	return 1;
+}
+
+static void synth_close(Decoder* d) {
+	SynthDecoder* sd = (SynthDecoder*) d;
+	free(sd->voices);
+	free(sd->state);
+	free(sd);
+}
+
+Decoder* synth_decoder(const SynthVoice* voices, size_t count, unsigned int sample_rate) {
+	if(sample_rate == 0) {
+		puts("Invalid synth rate.");
+		return 0;
+	}
+	
+	SynthDecoder* sd = calloc(1, sizeof(SynthDecoder));
+	if(sd == 0) {
+		puts("Could not allocate memory.");
+		return 0;
+	}
+	sd->voices = malloc((count > 0 ? count : 1) * sizeof(SynthVoice));
+	sd->state = malloc((count > 0 ? count : 1) * sizeof(SynthState));
+	if(sd->voices == 0 || sd->state == 0) {
+		puts("Could not allocate memory.");
+		free(sd->voices);
+		free(sd->state);
+		free(sd);
+		return 0;
+	}
+	memcpy(sd->voices, voices, count * sizeof(SynthVoice));
+	synth_reset(sd->state, count);
+	sd->count = count;
+	sd->frames = synth_frames(voices, count, sample_rate);
+	
+	sd->base.channels = 1;
+	sd->base.sample_rate = sample_rate;
+	sd->base.read = synth_read;
+	sd->base.rewind = synth_rewind;
+	sd->base.close = synth_close;
+	return &sd->base;
+}
@@ -0,0 +1,63 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include "sound.h"
+
+#define SYNTH_SINE		0
+#define SYNTH_SQUARE	1
+#define SYNTH_SAW		2
+#define SYNTH_TRIANGLE	3
+#define SYNTH_NOISE		4
+
+// one oscillator with its own envelope, a patch is a list of these mixed
+// together. Times are in seconds, sustain is a level between 0 and 1.
+typedef struct SynthVoice {
+	int wave;
+	float frequency; // for noise, how often a new value is picked; 0 is white
+	float frequency_end; // glides exponentially to this over length, 0 holds
+	float amplitude;
+	float duty; // fraction of a square cycle spent high
+	float fm_ratio; // sine modulator at frequency * fm_ratio
+	float fm_index; // modulation depth in radians, 0 disables fm
+	float attack;
+	float decay;
+	float sustain;
+	float release;
+	float start; // offset into the patch
+	float length; // held time before the release starts
+} SynthVoice;
+
+// total length of a patch in frames
+size_t synth_frames(const SynthVoice* voices, size_t count, unsigned int sample_rate);
+
+// renders a patch to mono 16 bit pcm, *out is allocated and must be
+// free'd, returns 0 on failure
+int synth_render(const SynthVoice* voices, size_t count, unsigned int sample_rate, short** out, size_t* frames);
+
+// mono decoder rendering the patch block by block, for streams
+Decoder* synth_decoder(const SynthVoice* voices, size_t count, unsigned int sample_rate);
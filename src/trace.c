@@ -0,0 +1,482 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#if defined(OPENLUAL_TRACE)
+
+#include "trace.h"
+#include "clock.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#define TRACE_FILE_BUFFER	(1 << 20)
+#define TRACE_MAX_NAMES		256
+
+#define FNV64_BASIS	14695981039346656037ull
+#define FNV64_PRIME	1099511628211ull
+
+
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_int trace_running;
+static FILE* trace_file;
+static uint64_t trace_last;
+
+// names get their ids for the life of the process, each trace writes out
+// the ones it uses
+static const char* trace_names[TRACE_MAX_NAMES];
+static unsigned int trace_name_count;
+static unsigned char trace_named[TRACE_MAX_NAMES];
+
+static const void** trace_handles;
+static unsigned int trace_handle_count;
+static unsigned int trace_handle_cap;
+
+static _Thread_local int trace_nesting;
+
+static uint64_t* trace_seen; // payload hashes written, open addressed
+static size_t trace_seen_cap;
+static size_t trace_seen_count;
+
+
+void tracebuf_byte(TraceBuf* b, unsigned int v) {
+	unsigned char c = v;
+	tracebuf_bytes(b, &c, 1);
+}
+
+void tracebuf_varint(TraceBuf* b, uint64_t v) {
+	unsigned char tmp[10];
+	size_t n = 0;
+	do {
+		tmp[n] = v & 0x7F;
+		v >>= 7;
+		if(v != 0)
+			tmp[n] |= 0x80;
+		n++;
+	} while(v != 0);
+	tracebuf_bytes(b, tmp, n);
+}
+
+void tracebuf_u64(TraceBuf* b, uint64_t v) {
+	unsigned char tmp[8];
+	for(int i=0; i<8; i++)
+		tmp[i] = v >> (8 * i);
+	tracebuf_bytes(b, tmp, 8);
+}
+
+void tracebuf_bytes(TraceBuf* b, const void* p, size_t n) {
+	if(b->failed)
+		return;
+	if(b->size + n > b->cap) {
+		size_t cap = b->cap ? b->cap : 256;
+		while(cap < b->size + n)
+			cap *= 2;
+		unsigned char* d = realloc(b->data, cap);
+		if(d == 0) {
+			puts("Could not allocate memory.");
+			b->failed = 1;
+			return;
+		}
+		b->data = d;
+		b->cap = cap;
+	}
+	memcpy(b->data + b->size, p, n);
+	b->size += n;
+}
+
+void tracebuf_int(TraceBuf* b, int64_t v) {
+	tracebuf_byte(b, v < 0 ? TRACE_NINT : TRACE_UINT);
+	tracebuf_varint(b, v < 0 ? -(uint64_t) v : (uint64_t) v);
+}
+
+void tracebuf_string(TraceBuf* b, const char* s) {
+	if(s == 0) {
+		tracebuf_byte(b, TRACE_NIL);
+		return;
+	}
+	tracebuf_data(b, s, strlen(s));
+}
+
+void tracebuf_names(TraceBuf* b, size_t n, const unsigned int* names) {
+	tracebuf_byte(b, TRACE_TABLE);
+	tracebuf_varint(b, n);
+	for(size_t i=0; i<n; i++)
+		tracebuf_int(b, names[i]);
+}
+
+// short data inline like a lua string, the rest as a payload
+void tracebuf_data(TraceBuf* b, const void* data, size_t size) {
+	if(data == 0) {
+		tracebuf_byte(b, TRACE_NIL);
+	} else if(size < TRACE_INLINE) {
+		tracebuf_byte(b, TRACE_STRING);
+		tracebuf_varint(b, size);
+		tracebuf_bytes(b, data, size);
+	} else {
+		tracebuf_byte(b, TRACE_BLOB);
+		tracebuf_u64(b, trace_payload(data, size));
+	}
+}
+
+// with trace_lock held
+static void trace_write(const TraceBuf* b) {
+	if(trace_file != 0 && !b->failed && fwrite(b->data, 1, b->size, trace_file) != b->size) {
+		puts("Could not write trace.");
+		fclose(trace_file);
+		trace_file = 0;
+		atomic_store(&trace_running, 0);
+	}
+}
+
+static int trace_seen_add(uint64_t hash) {
+	if(trace_seen_count * 2 >= trace_seen_cap) {
+		size_t cap = trace_seen_cap ? trace_seen_cap * 2 : 1024;
+		uint64_t* seen = calloc(cap, sizeof(uint64_t));
+		if(seen == 0)
+			return 1; // written again rather than lost
+		for(size_t i=0; i<trace_seen_cap; i++)
+			if(trace_seen[i] != 0)
+				for(size_t j=trace_seen[i] & (cap - 1); ; j=(j + 1) & (cap - 1))
+					if(seen[j] == 0) {
+						seen[j] = trace_seen[i];
+						break;
+					}
+		free(trace_seen);
+		trace_seen = seen;
+		trace_seen_cap = cap;
+	}
+	for(size_t j=hash & (trace_seen_cap - 1); ; j=(j + 1) & (trace_seen_cap - 1)) {
+		if(trace_seen[j] == hash)
+			return 0;
+		if(trace_seen[j] == 0) {
+			trace_seen[j] = hash;
+			trace_seen_count++;
+			return 1;
+		}
+	}
+}
+
+
+int trace_start(const char* path) {
+	trace_stop();
+	FILE* f = fopen(path, "wb");
+	if(f == 0) {
+		puts("Could not open trace file.");
+		return 0;
+	}
+	setvbuf(f, 0, _IOFBF, TRACE_FILE_BUFFER);
+	fwrite("OLTR", 1, 4, f);
+	fputc(TRACE_VERSION, f);
+	
+	pthread_mutex_lock(&trace_lock);
+	trace_file = f;
+	trace_last = clock_ns();
+	memset(trace_named, 0, sizeof(trace_named));
+	free(trace_seen);
+	trace_seen = 0;
+	trace_seen_cap = 0;
+	trace_seen_count = 0;
+	atomic_store(&trace_running, 1);
+	pthread_mutex_unlock(&trace_lock);
+	return 1;
+}
+
+void trace_stop(void) {
+	pthread_mutex_lock(&trace_lock);
+	atomic_store(&trace_running, 0);
+	if(trace_file != 0)
+		fclose(trace_file);
+	trace_file = 0;
+	pthread_mutex_unlock(&trace_lock);
+}
+
+int trace_on(void) {
+	return atomic_load_explicit(&trace_running, memory_order_relaxed);
+}
+
+unsigned int trace_function(const char* name) {
+	pthread_mutex_lock(&trace_lock);
+	unsigned int id = 0;
+	while(id < trace_name_count && strcmp(trace_names[id], name) != 0)
+		id++;
+	if(id == trace_name_count && id < TRACE_MAX_NAMES)
+		trace_names[trace_name_count++] = name;
+	if(id < TRACE_MAX_NAMES && !trace_named[id]) {
+		TraceBuf b = {0};
+		tracebuf_byte(&b, TRACE_NAME);
+		tracebuf_varint(&b, id);
+		tracebuf_varint(&b, strlen(name));
+		tracebuf_bytes(&b, name, strlen(name));
+		trace_write(&b);
+		free(b.data);
+		trace_named[id] = 1;
+	}
+	pthread_mutex_unlock(&trace_lock);
+	return id;
+}
+
+uint64_t trace_payload(const void* data, size_t size) {
+	uint64_t hash = FNV64_BASIS;
+	const unsigned char* p = data;
+	for(size_t i=0; i<size; i++) {
+		hash ^= p[i];
+		hash *= FNV64_PRIME;
+	}
+	if(hash == 0)
+		hash = 1; // 0 marks empty slots
+	
+	pthread_mutex_lock(&trace_lock);
+	if(trace_seen_add(hash)) {
+		TraceBuf b = {0};
+		tracebuf_byte(&b, TRACE_PAYLOAD);
+		tracebuf_u64(&b, hash);
+		tracebuf_varint(&b, size);
+		trace_write(&b);
+		free(b.data);
+		if(trace_file != 0 && fwrite(data, 1, size, trace_file) != size)
+			puts("Could not write trace.");
+	}
+	pthread_mutex_unlock(&trace_lock);
+	return hash;
+}
+
+unsigned int trace_handle(const void* p) {
+	pthread_mutex_lock(&trace_lock);
+	unsigned int id = 0;
+	while(id < trace_handle_count && trace_handles[id] != p)
+		id++;
+	if(id == trace_handle_count) {
+		if(trace_handle_count == trace_handle_cap) {
+			unsigned int cap = trace_handle_cap ? trace_handle_cap * 2 : 64;
+			const void** handles = realloc(trace_handles, cap * sizeof(void*));
+			
+		  // a shared id would point the replay at the wrong object, so the
+		  // trace ends here instead
+			if(handles == 0) {
+				puts("Could not allocate memory, the trace is stopped.");
+				atomic_store(&trace_running, 0);
+				if(trace_file != 0)
+					fclose(trace_file);
+				trace_file = 0;
+				pthread_mutex_unlock(&trace_lock);
+				return id;
+			}
+			trace_handles = handles;
+			trace_handle_cap = cap;
+		}
+		trace_handles[trace_handle_count++] = p;
+	}
+	pthread_mutex_unlock(&trace_lock);
+	return id;
+}
+
+void trace_emit(unsigned int id, uint64_t start, const TraceBuf* body) {
+	if(body->failed)
+		return;
+	TraceBuf head = {0};
+	pthread_mutex_lock(&trace_lock);
+	
+  // calls from other threads may land out of order, they then count as at once
+	uint64_t delta = start > trace_last ? start - trace_last : 0;
+	if(start > trace_last)
+		trace_last = start;
+	tracebuf_byte(&head, TRACE_CALL);
+	tracebuf_varint(&head, id);
+	tracebuf_varint(&head, delta);
+	trace_write(&head);
+	trace_write(body);
+	pthread_mutex_unlock(&trace_lock);
+	free(head.data);
+}
+
+void trace_nest(int delta) {
+	trace_nesting += delta;
+}
+
+int trace_native(void) {
+	return trace_nesting == 0 && trace_on();
+}
+
+void trace_native_emit(const char* name, const TraceBuf* body) {
+	trace_emit(trace_function(name), clock_ns(), body);
+}
+
+
+// -----
+
+int trace_get_byte(TraceReader* r, unsigned int* v) {
+	if(r->pos >= r->file.size)
+		return 0;
+	*v = r->file.data[r->pos++];
+	return 1;
+}
+
+int trace_get_varint(TraceReader* r, uint64_t* v) {
+	*v = 0;
+	for(int shift=0; shift<64; shift+=7) {
+		unsigned int c;
+		if(!trace_get_byte(r, &c))
+			return 0;
+		*v |= (uint64_t) (c & 0x7F) << shift;
+		if((c & 0x80) == 0)
+			return 1;
+	}
+	return 0;
+}
+
+int trace_get_u64(TraceReader* r, uint64_t* v) {
+	const unsigned char* p;
+	if(!trace_get_bytes(r, 8, &p))
+		return 0;
+	*v = 0;
+	for(int i=0; i<8; i++)
+		*v |= (uint64_t) p[i] << (8 * i);
+	return 1;
+}
+
+int trace_get_bytes(TraceReader* r, size_t n, const unsigned char** p) {
+	if(n > r->file.size - r->pos)
+		return 0;
+	*p = r->file.data + r->pos;
+	r->pos += n;
+	return 1;
+}
+
+static int trace_reader_keep(TraceReader* r, uint64_t hash, const unsigned char* data, size_t size) {
+	if(r->payload_count * 2 >= r->payload_cap) {
+		size_t cap = r->payload_cap ? r->payload_cap * 2 : 256;
+		TracePayload* table = calloc(cap, sizeof(TracePayload));
+		if(table == 0) {
+			puts("Could not allocate memory.");
+			return 0;
+		}
+		for(size_t i=0; i<r->payload_cap; i++)
+			if(r->payloads[i].hash != 0)
+				for(size_t j=r->payloads[i].hash & (cap - 1); ; j=(j + 1) & (cap - 1))
+					if(table[j].hash == 0) {
+						table[j] = r->payloads[i];
+						break;
+					}
+		free(r->payloads);
+		r->payloads = table;
+		r->payload_cap = cap;
+	}
+	for(size_t j=hash & (r->payload_cap - 1); ; j=(j + 1) & (r->payload_cap - 1))
+		if(r->payloads[j].hash == 0 || r->payloads[j].hash == hash) {
+			if(r->payloads[j].hash == 0)
+				r->payload_count++;
+			r->payloads[j].hash = hash;
+			r->payloads[j].data = data;
+			r->payloads[j].size = size;
+			return 1;
+		}
+}
+
+TraceReader* trace_reader_open(const char* path) {
+	TraceReader* r = calloc(1, sizeof(TraceReader));
+	if(r == 0) {
+		puts("Could not allocate memory.");
+		return 0;
+	}
+	if(!mapfile_open(&r->file, path)) {
+		free(r);
+		return 0;
+	}
+	if(r->file.size < 5 || memcmp(r->file.data, "OLTR", 4) != 0 || r->file.data[4] != TRACE_VERSION) {
+		puts("Not a trace file!");
+		trace_reader_close(r);
+		return 0;
+	}
+	r->pos = 5;
+	return r;
+}
+
+void trace_reader_close(TraceReader* r) {
+	if(r == 0)
+		return;
+	for(size_t i=0; i<r->name_count; i++)
+		free(r->names[i]);
+	free(r->names);
+	free(r->payloads);
+	mapfile_close(&r->file);
+	free(r);
+}
+
+int trace_reader_next(TraceReader* r, unsigned int* id, uint64_t* delta) {
+	unsigned int type;
+	while(trace_get_byte(r, &type)) {
+		uint64_t a, n;
+		const unsigned char* p;
+		switch(type) {
+			case TRACE_CALL:
+				if(!trace_get_varint(r, &a) || !trace_get_varint(r, delta))
+					return 0;
+				*id = a;
+				return 1;
+			case TRACE_NAME:
+				if(!trace_get_varint(r, &a) || !trace_get_varint(r, &n) || !trace_get_bytes(r, n, &p) || a >= TRACE_MAX_NAMES)
+					return 0;
+				if(a >= r->name_count) {
+					char** names = realloc(r->names, (a + 1) * sizeof(char*));
+					if(names == 0)
+						return 0;
+					memset(names + r->name_count, 0, (a + 1 - r->name_count) * sizeof(char*));
+					r->names = names;
+					r->name_count = a + 1;
+				}
+				free(r->names[a]);
+				r->names[a] = malloc(n + 1);
+				if(r->names[a] == 0)
+					return 0;
+				memcpy(r->names[a], p, n);
+				r->names[a][n] = 0;
+				break;
+			case TRACE_PAYLOAD:
+				if(!trace_get_u64(r, &a) || !trace_get_varint(r, &n) || !trace_get_bytes(r, n, &p) || !trace_reader_keep(r, a, p, n))
+					return 0;
+				break;
+			default:
+				puts("Damaged trace record!");
+				return 0;
+		}
+	}
+	return 0;
+}
+
+const char* trace_reader_name(const TraceReader* r, unsigned int id) {
+	return id < r->name_count ? r->names[id] : 0;
+}
+
+const TracePayload* trace_reader_payload(const TraceReader* r, uint64_t hash) {
+	if(r->payload_cap == 0)
+		return 0;
+	for(size_t j=hash & (r->payload_cap - 1); r->payloads[j].hash != 0; j=(j + 1) & (r->payload_cap - 1))
+		if(r->payloads[j].hash == hash)
+			return &r->payloads[j];
+	return 0;
+}
+
+#endif
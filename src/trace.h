@@ -0,0 +1,141 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mapfile.h"
+
+// binary call trace of the instrumented build, see OPENLUAL_TRACE in
+// build.sh. The file is "OLTR", a version byte and then records:
+//   TRACE_NAME     varint id, varint length, name
+//   TRACE_PAYLOAD  u64 hash, varint size, bytes; before its first use
+//   TRACE_CALL     varint id, varint ns since the previous call,
+//                  varint count, values, varint count, values
+// for arguments and then results. Every value starts with its tag.
+
+#define TRACE_VERSION	1
+
+#define TRACE_NAME		1
+#define TRACE_PAYLOAD	2
+#define TRACE_CALL		3
+
+#define TRACE_NIL		0
+#define TRACE_FALSE		1
+#define TRACE_TRUE		2
+#define TRACE_UINT		3 // varint
+#define TRACE_NINT		4 // varint of the negated value
+#define TRACE_DOUBLE	5 // 8 bytes
+#define TRACE_STRING	6 // varint length, bytes
+#define TRACE_BLOB		7 // u64 payload hash
+#define TRACE_TABLE		8 // varint count, values of its array part
+#define TRACE_HANDLE	9 // varint id of a device or context
+#define TRACE_OTHER		10
+#define TRACE_SAMPLES	11 // u64 payload hash, varint type, channels, rate
+
+#define TRACE_INLINE	64 // longer strings are stored as payloads
+
+// a record being put together, appended to the file whole
+typedef struct TraceBuf {
+	unsigned char* data;
+	size_t size;
+	size_t cap;
+	int failed;
+} TraceBuf;
+
+void tracebuf_byte(TraceBuf* b, unsigned int v);
+void tracebuf_varint(TraceBuf* b, uint64_t v);
+void tracebuf_u64(TraceBuf* b, uint64_t v);
+void tracebuf_bytes(TraceBuf* b, const void* p, size_t n);
+
+// tagged values, laid out the way the lua bindings' arguments are
+void tracebuf_int(TraceBuf* b, int64_t v);
+void tracebuf_string(TraceBuf* b, const char* s); // nil for 0
+void tracebuf_names(TraceBuf* b, size_t n, const unsigned int* names);
+void tracebuf_data(TraceBuf* b, const void* data, size_t size);
+
+// starts a trace at path, replacing any running one; returns 0 on failure
+int trace_start(const char* path);
+
+void trace_stop(void);
+
+int trace_on(void);
+
+// the id of a function name, writing its TRACE_NAME record the first time
+unsigned int trace_function(const char* name);
+
+// the hash of a payload, writing its TRACE_PAYLOAD record the first time
+uint64_t trace_payload(const void* data, size_t size);
+
+// small stable id for a device or context pointer
+unsigned int trace_handle(const void* p);
+
+// appends a TRACE_CALL record of function id, started at clock_ns() start,
+// whose values are in body; the buffer is left to the caller
+void trace_emit(unsigned int id, uint64_t start, const TraceBuf* body);
+
+// the library's own al calls are recorded as calls of the lua binding with
+// the same name, so a replay runs them through it. While a traced binding
+// runs, nesting is above zero and what it calls is left to its own record.
+void trace_nest(int delta);
+int trace_native(void);
+void trace_native_emit(const char* name, const TraceBuf* body);
+
+
+typedef struct TracePayload {
+	uint64_t hash;
+	const unsigned char* data;
+	size_t size;
+} TracePayload;
+
+typedef struct TraceReader {
+	MappedFile file;
+	size_t pos;
+	char** names;
+	size_t name_count;
+	TracePayload* payloads; // open addressed by hash
+	size_t payload_cap;
+	size_t payload_count;
+} TraceReader;
+
+// returns 0 when path is not a trace
+TraceReader* trace_reader_open(const char* path);
+
+void trace_reader_close(TraceReader* r);
+
+// skips to the next TRACE_CALL and reads its id and time delta, leaving the
+// values to read; returns 0 at the end or on a damaged record
+int trace_reader_next(TraceReader* r, unsigned int* id, uint64_t* delta);
+
+const char* trace_reader_name(const TraceReader* r, unsigned int id);
+
+const TracePayload* trace_reader_payload(const TraceReader* r, uint64_t hash);
+
+// raw reads, returning 0 past the end
+int trace_get_byte(TraceReader* r, unsigned int* v);
+int trace_get_varint(TraceReader* r, uint64_t* v);
+int trace_get_u64(TraceReader* r, uint64_t* v);
+int trace_get_bytes(TraceReader* r, size_t n, const unsigned char** p);
@@ -0,0 +1,299 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "trim.h"
+#include "adpcm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#	include <emmintrin.h>
+#endif
+
+
+// sample indices of the first and last loud samples, n when there is none
+static void trim_find16(const short* p, size_t n, int threshold, size_t* first, size_t* last) {
+	size_t i = 0;
+	*first = n;
+	*last = n;
+#if defined(__SSE2__)
+	// both signs compared, -32768 has no magnitude on 16 bits
+	__m128i t = _mm_set1_epi16(threshold);
+	__m128i nt = _mm_set1_epi16(-threshold);
+	for(; i+8<=n; i+=8) {
+		__m128i v = _mm_loadu_si128((const __m128i*) (p + i));
+		int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpgt_epi16(v, t), _mm_cmplt_epi16(v, nt)));
+		if(mask != 0) {
+			*first = i + __builtin_ctz(mask) / 2;
+			break;
+		}
+	}
+	if(*first == n)
+#endif
+	for(; i<n; i++)
+		if(abs(p[i]) > threshold) {
+			*first = i;
+			break;
+		}
+	if(*first == n)
+		return;
+	
+	size_t j = n;
+#if defined(__SSE2__)
+	for(; j>=*first+8; j-=8) {
+		__m128i v = _mm_loadu_si128((const __m128i*) (p + j - 8));
+		int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpgt_epi16(v, t), _mm_cmplt_epi16(v, nt)));
+		if(mask != 0) {
+			*last = j - 8 + (31 - __builtin_clz(mask)) / 2;
+			return;
+		}
+	}
+#endif
+	for(; j>*first; j--)
+		if(abs(p[j - 1]) > threshold) {
+			*last = j - 1;
+			return;
+		}
+	*last = *first;
+}
+
+static void trim_find8(const unsigned char* p, size_t n, int threshold, size_t* first, size_t* last) {
+	size_t i = 0;
+	*first = n;
+	*last = n;
+	int t8 = threshold >> 8; // compared on the 8 bit scale
+#if defined(__SSE2__)
+	__m128i bias = _mm_set1_epi8((char) 0x80);
+	__m128i t = _mm_set1_epi8((char) t8);
+	__m128i nt = _mm_set1_epi8((char) -t8);
+	for(; i+16<=n; i+=16) {
+		__m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i*) (p + i)), bias);
+		int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpgt_epi8(v, t), _mm_cmplt_epi8(v, nt)));
+		if(mask != 0) {
+			*first = i + __builtin_ctz(mask);
+			break;
+		}
+	}
+	if(*first == n)
+#endif
+	for(; i<n; i++)
+		if(abs(p[i] - 128) > t8) {
+			*first = i;
+			break;
+		}
+	if(*first == n)
+		return;
+	
+	size_t j = n;
+#if defined(__SSE2__)
+	for(; j>=*first+16; j-=16) {
+		__m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i*) (p + j - 16)), bias);
+		int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpgt_epi8(v, t), _mm_cmplt_epi8(v, nt)));
+		if(mask != 0) {
+			*last = j - 16 + (31 - __builtin_clz(mask));
+			return;
+		}
+	}
+#endif
+	for(; j>*first; j--)
+		if(abs(p[j - 1] - 128) > t8) {
+			*last = j - 1;
+			return;
+		}
+	*last = *first;
+}
+
+static void trim_find32(const float* p, size_t n, int threshold, size_t* first, size_t* last) {
+	size_t i = 0;
+	*first = n;
+	*last = n;
+	float tf = threshold * (1.0f / 32768);
+#if defined(__SSE2__)
+	__m128 sign = _mm_set1_ps(-0.0f);
+	__m128 t = _mm_set1_ps(tf);
+	for(; i+4<=n; i+=4) {
+		int mask = _mm_movemask_ps(_mm_cmpgt_ps(_mm_andnot_ps(sign, _mm_loadu_ps(p + i)), t));
+		if(mask != 0) {
+			*first = i + __builtin_ctz(mask);
+			break;
+		}
+	}
+	if(*first == n)
+#endif
+	for(; i<n; i++)
+		if(fabsf(p[i]) > tf) {
+			*first = i;
+			break;
+		}
+	if(*first == n)
+		return;
+	
+	size_t j = n;
+#if defined(__SSE2__)
+	for(; j>=*first+4; j-=4) {
+		int mask = _mm_movemask_ps(_mm_cmpgt_ps(_mm_andnot_ps(sign, _mm_loadu_ps(p + j - 4)), t));
+		if(mask != 0) {
+			*last = j - 4 + (31 - __builtin_clz(mask));
+			return;
+		}
+	}
+#endif
+	for(; j>*first; j--)
+		if(fabsf(p[j - 1]) > tf) {
+			*last = j - 1;
+			return;
+		}
+	*last = *first;
+}
+
+// largest magnitude over n samples, on the 16 bit scale
+static int trim_peak(const void* pcm, unsigned int bps, size_t n) {
+	size_t i = 0;
+	int peak = 0;
+	if(bps == 32) {
+	  // float may go past full scale, kept well inside an int
+		const float* p = pcm;
+		float m = 0;
+		for(; i<n; i++)
+			if(fabsf(p[i]) > m)
+				m = fabsf(p[i]);
+		return m >= 32768 ? 1 << 30 : (int) lrintf(m * 32768);
+	}
+	if(bps == 16) {
+		const short* p = pcm;
+#if defined(__SSE2__)
+		// min and max apart, -32768 would saturate as a magnitude
+		__m128i mn = _mm_setzero_si128();
+		__m128i mx = mn;
+		for(; i+8<=n; i+=8) {
+			__m128i v = _mm_loadu_si128((const __m128i*) (p + i));
+			mn = _mm_min_epi16(mn, v);
+			mx = _mm_max_epi16(mx, v);
+		}
+		short lmn[8], lmx[8];
+		_mm_storeu_si128((__m128i*) lmn, mn);
+		_mm_storeu_si128((__m128i*) lmx, mx);
+		for(int k=0; k<8; k++) {
+			if(-lmn[k] > peak)
+				peak = -lmn[k];
+			if(lmx[k] > peak)
+				peak = lmx[k];
+		}
+#endif
+		for(; i<n; i++)
+			if(abs(p[i]) > peak)
+				peak = abs(p[i]);
+		return peak;
+	}
+	
+	const unsigned char* p = pcm;
+	int lo = 128, hi = 128;
+#if defined(__SSE2__)
+	__m128i mn = _mm_set1_epi8((char) 128);
+	__m128i mx = mn;
+	for(; i+16<=n; i+=16) {
+		__m128i v = _mm_loadu_si128((const __m128i*) (p + i));
+		mn = _mm_min_epu8(mn, v);
+		mx = _mm_max_epu8(mx, v);
+	}
+	unsigned char lmn[16], lmx[16];
+	_mm_storeu_si128((__m128i*) lmn, mn);
+	_mm_storeu_si128((__m128i*) lmx, mx);
+	for(int k=0; k<16; k++) {
+		if(lmn[k] < lo)
+			lo = lmn[k];
+		if(lmx[k] > hi)
+			hi = lmx[k];
+	}
+#endif
+	for(; i<n; i++) {
+		if(p[i] < lo)
+			lo = p[i];
+		if(p[i] > hi)
+			hi = p[i];
+	}
+	peak = 128 - lo > hi - 128 ? 128 - lo : hi - 128;
+	return peak * 256;
+}
+
+
+int trim_scan(const void* pcm, unsigned int bps, size_t frames, unsigned int channels, int threshold, size_t* first, size_t* end) {
+	size_t n = frames * channels;
+	size_t a, b;
+	threshold = threshold > 32767 ? 32767 : threshold < 0 ? 0 : threshold;
+	if(bps == 32)
+		trim_find32(pcm, n, threshold, &a, &b);
+	else if(bps == 16)
+		trim_find16(pcm, n, threshold, &a, &b);
+	else
+		trim_find8(pcm, n, threshold, &a, &b);
+	if(a == n) {
+		*first = *end = 0;
+		return 0;
+	}
+	*first = a / channels;
+	*end = b / channels + 1;
+	size_t frame = channels * (bps / 8);
+	return trim_peak((const unsigned char*) pcm + *first * frame, bps, (*end - *first) * channels);
+}
+
+int trim_wave(WaveData* wd, double threshold_db, size_t pad, TrimInfo* info) {
+	int is_float = wd->format == WAVE_FORMAT_IEEE_FLOAT && wd->bps == 32;
+	if(!is_float && (wd->format != WAVE_FORMAT_PCM || (wd->bps != 8 && wd->bps != 16))) {
+		puts("Trimming needs 8 or 16 bit pcm or float.");
+		return 0;
+	}
+	
+	size_t frame = wd->channels * (wd->bps / 8);
+	size_t frames = wd->sound_size / frame;
+	double level = 32768 * pow(10, threshold_db / 20);
+	int threshold = level >= 32767 ? 32767 : (int) level;
+	
+	size_t first, end;
+	info->peak = trim_scan(wd->sound_data, wd->bps, frames, wd->channels, threshold, &first, &end);
+	if(first == end) {
+		// nothing is that loud, a quiet sound is still a sound
+		info->head = info->tail = 0;
+		info->peak = trim_peak(wd->sound_data, wd->bps, frames * wd->channels);
+		return 1;
+	}
+	first = first > pad ? first - pad : 0;
+	end = end + pad < frames ? end + pad : frames;
+	
+  // the window moves inside the same buffer, nothing is copied
+	info->head = first;
+	info->tail = frames - end;
+	wd->sound_data += first * frame;
+	wd->sound_size = (end - first) * frame;
+	
+	wd->loop_start = wd->loop_start > first ? wd->loop_start - first : 0;
+	wd->loop_end = wd->loop_end > first ? wd->loop_end - first : 0;
+	if(wd->loop_end > end - first)
+		wd->loop_end = end - first;
+	for(unsigned int i=0; i<wd->cue_count; i++)
+		wd->cues[i].position = wd->cues[i].position > first ? wd->cues[i].position - first : 0;
+	return 1;
+}
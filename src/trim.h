@@ -0,0 +1,45 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include "wave.h"
+
+typedef struct TrimInfo {
+	size_t head; // frames cut from the start
+	size_t tail; // frames cut from the end
+	int peak; // largest magnitude kept, on the 16 bit scale
+} TrimInfo;
+
+// first and last frame holding a sample louder than threshold (16 bit
+// scale) in interleaved 8 bit unsigned, 16 bit or 32 bit float pcm; *end is exclusive
+// and *first == *end when nothing is that loud. Returns the peak.
+int trim_scan(const void* pcm, unsigned int bps, size_t frames, unsigned int channels, int threshold, size_t* first, size_t* end);
+
+// drops the quiet frames at both ends of decoded pcm, keeping pad frames
+// of them; threshold_db is relative to full scale. The sound keeps its
+// buffer and only its window moves, loop and cue points move along.
+int trim_wave(WaveData* wd, double threshold_db, size_t pad, TrimInfo* info);
@@ -0,0 +1,404 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "uring.h"
+
+#if defined(__linux__) && defined(__has_include)
+#	if __has_include(<linux/io_uring.h>)
+#		define OLUAL_URING 1
+#	endif
+#endif
+
+#ifdef OLUAL_URING
+
+#include "sound.h"
+#include "pool.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#ifndef __NR_io_uring_setup
+#	define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+#	define __NR_io_uring_enter 426
+#endif
+#ifndef __NR_io_uring_register
+#	define __NR_io_uring_register 427
+#endif
+
+#define URING_DEPTH 64 // reads in flight
+#define URING_WINDOW 256 // files opened and registered at a time
+#define URING_CHUNK (1u << 30) // largest single read
+
+
+typedef struct Uring {
+	int fd;
+	unsigned int* sq_head;
+	unsigned int* sq_tail;
+	unsigned int* sq_mask;
+	unsigned int* sq_array;
+	struct io_uring_sqe* sqes;
+	unsigned int* cq_head;
+	unsigned int* cq_tail;
+	unsigned int* cq_mask;
+	struct io_uring_cqe* cqes;
+	void* sq_ring;
+	size_t sq_ring_size;
+	void* cq_ring;
+	size_t cq_ring_size;
+	size_t sqes_size;
+} Uring;
+
+static int uring_setup(Uring* r, unsigned int entries) {
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+	memset(r, 0, sizeof(*r));
+	r->fd = syscall(__NR_io_uring_setup, entries, &p);
+	if(r->fd < 0)
+		return 0;
+	
+	r->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	r->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if(p.features & IORING_FEAT_SINGLE_MMAP) {
+		if(r->cq_ring_size > r->sq_ring_size)
+			r->sq_ring_size = r->cq_ring_size;
+		r->cq_ring_size = r->sq_ring_size;
+	}
+	
+	r->sq_ring = mmap(0, r->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+	if(r->sq_ring == MAP_FAILED)
+		goto fail_sq;
+	if(p.features & IORING_FEAT_SINGLE_MMAP)
+		r->cq_ring = r->sq_ring;
+	else {
+		r->cq_ring = mmap(0, r->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+		if(r->cq_ring == MAP_FAILED)
+			goto fail_cq;
+	}
+	r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	r->sqes = mmap(0, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+	if(r->sqes == MAP_FAILED)
+		goto fail_sqes;
+	
+	unsigned char* sq = r->sq_ring;
+	unsigned char* cq = r->cq_ring;
+	r->sq_head = (unsigned int*) (sq + p.sq_off.head);
+	r->sq_tail = (unsigned int*) (sq + p.sq_off.tail);
+	r->sq_mask = (unsigned int*) (sq + p.sq_off.ring_mask);
+	r->sq_array = (unsigned int*) (sq + p.sq_off.array);
+	r->cq_head = (unsigned int*) (cq + p.cq_off.head);
+	r->cq_tail = (unsigned int*) (cq + p.cq_off.tail);
+	r->cq_mask = (unsigned int*) (cq + p.cq_off.ring_mask);
+	r->cqes = (struct io_uring_cqe*) (cq + p.cq_off.cqes);
+	return 1;
+	
+	fail_sqes:
+	if(r->cq_ring != r->sq_ring)
+		munmap(r->cq_ring, r->cq_ring_size);
+	fail_cq:
+	munmap(r->sq_ring, r->sq_ring_size);
+	fail_sq:
+	close(r->fd);
+	return 0;
+}
+
+static void uring_teardown(Uring* r) {
+	munmap(r->sqes, r->sqes_size);
+	if(r->cq_ring != r->sq_ring)
+		munmap(r->cq_ring, r->cq_ring_size);
+	munmap(r->sq_ring, r->sq_ring_size);
+	close(r->fd);
+}
+
+// queues a read, the caller keeps in-flight reads under the ring size so
+// the submission queue never fills
+static void uring_push_read(Uring* r, int fd, void* addr, unsigned int len, size_t offset, int buf_index, unsigned long long user_data) {
+	unsigned int tail = *r->sq_tail;
+	unsigned int idx = tail & *r->sq_mask;
+	struct io_uring_sqe* sqe = &r->sqes[idx];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = buf_index >= 0 ? IORING_OP_READ_FIXED : IORING_OP_READ;
+	sqe->fd = fd;
+	sqe->addr = (unsigned long long) (size_t) addr;
+	sqe->len = len;
+	sqe->off = offset;
+	if(buf_index >= 0)
+		sqe->buf_index = buf_index;
+	sqe->user_data = user_data;
+	r->sq_array[idx] = idx;
+	__atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+
+typedef struct UringFile {
+	int fd;
+	int buf_index; // -1 when the window's buffers are not registered
+	size_t size;
+	size_t done;
+	unsigned char* data;
+} UringFile;
+
+typedef struct UringLoad {
+	Uring ring;
+	const char** paths;
+	size_t count;
+	WaveData** out;
+	const BatchOptions* opts;
+	UringFile* files;
+	
+	// files in the order their reads finished, parse jobs take them in turn
+	size_t* ready;
+	size_t ready_count;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	
+	int lost; // the ring failed with reads still in flight, it is not used again
+} UringLoad;
+
+static void uring_publish(UringLoad* u, size_t i, int ok) {
+	UringFile* f = &u->files[i];
+	if(f->fd >= 0)
+		close(f->fd);
+	f->fd = -1;
+	if(!ok) {
+		free(f->data);
+		f->data = 0;
+	}
+	
+	pthread_mutex_lock(&u->lock);
+	u->ready[u->ready_count++] = i;
+	pthread_cond_broadcast(&u->cond);
+	pthread_mutex_unlock(&u->lock);
+}
+
+static void uring_window(UringLoad* u, size_t first, size_t n) {
+	Uring* r = &u->ring;
+	size_t* queue = malloc(n * sizeof(size_t));
+	struct iovec* iov = malloc(n * sizeof(struct iovec));
+	if(queue == 0 || iov == 0 || u->lost) {
+		if(!u->lost)
+			puts("Could not allocate memory.");
+		for(size_t i=first; i<first+n; i++)
+			uring_publish(u, i, 0);
+		goto exit;
+	}
+	
+  // open everything in the window and size its buffer
+	size_t queued = 0;
+	unsigned int registered = 0;
+	for(size_t i=first; i<first+n; i++) {
+		UringFile* f = &u->files[i];
+		f->fd = open(u->paths[i], O_RDONLY | O_CLOEXEC);
+		struct stat st;
+		if(f->fd < 0 || fstat(f->fd, &st) != 0 || st.st_size <= 0) {
+			uring_publish(u, i, 0);
+			continue;
+		}
+		f->size = st.st_size;
+		f->done = 0;
+		f->data = malloc(f->size);
+		if(f->data == 0) {
+			uring_publish(u, i, 0);
+			continue;
+		}
+		f->buf_index = registered;
+		iov[registered].iov_base = f->data;
+		iov[registered].iov_len = f->size;
+		registered++;
+		queue[queued++] = i;
+	}
+	
+  // pin the buffers so the kernel skips mapping them on every read, plain
+  // reads still work when that is refused
+	int fixed = registered > 0 && syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_BUFFERS, iov, registered) == 0;
+	if(!fixed)
+		for(size_t k=0; k<queued; k++)
+			u->files[queue[k]].buf_index = -1;
+	
+  // keep the ring full and requeue short reads until every file is in
+	size_t head = 0;
+	size_t tail = queued;
+	size_t inflight = 0;
+	int failed = 0;
+	while(head != tail || inflight > 0) {
+		while(!failed && head != tail && inflight < URING_DEPTH) {
+			UringFile* f = &u->files[queue[head % n]];
+			size_t left = f->size - f->done;
+			uring_push_read(r, f->fd, f->data + f->done, left > URING_CHUNK ? URING_CHUNK : left, f->done, f->buf_index, queue[head % n]);
+			head++;
+			inflight++;
+		}
+		
+		// counted from the kernel's head so entries left by an interrupted
+		// enter go out with the next one
+		unsigned int submit = *r->sq_tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+		int ret = syscall(__NR_io_uring_enter, r->fd, submit, 1, IORING_ENTER_GETEVENTS, 0, 0);
+		if(ret < 0 && errno != EINTR) {
+			if(failed) {
+				// the kernel may still write into the buffers, so they are
+				// given up rather than free'd
+				puts("Could not drain io_uring reads.");
+				u->lost = 1;
+				break;
+			}
+			puts("Could not submit io_uring reads.");
+			failed = 1;
+			
+			// the kernel never took these, without SQPOLL they can be withdrawn
+			unsigned int sq = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+			inflight -= *r->sq_tail - sq;
+			__atomic_store_n(r->sq_tail, sq, __ATOMIC_RELEASE);
+			head = tail;
+		}
+		
+		unsigned int ch = *r->cq_head;
+		unsigned int ct = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+		for(; ch != ct; ch++) {
+			struct io_uring_cqe* cqe = &r->cqes[ch & *r->cq_mask];
+			size_t i = cqe->user_data;
+			UringFile* f = &u->files[i];
+			inflight--;
+			if(cqe->res < 0)
+				uring_publish(u, i, 0);
+			else if(cqe->res == 0 || (f->done += cqe->res) >= f->size) {
+				f->size = f->done; // a file cut short parses what was read
+				uring_publish(u, i, 1);
+			} else if(failed)
+				uring_publish(u, i, 0);
+			else
+				queue[tail++ % n] = i;
+		}
+		__atomic_store_n(r->cq_head, ch, __ATOMIC_RELEASE);
+	}
+	
+  // anything still open lost its ring, fail it rather than hang the parsers;
+  // every read has completed by now unless the ring itself was lost
+	for(size_t i=first; i<first+n; i++) {
+		if(u->files[i].fd < 0)
+			continue;
+		if(u->lost)
+			u->files[i].data = 0;
+		uring_publish(u, i, 0);
+	}
+	
+	if(fixed && !u->lost)
+		syscall(__NR_io_uring_register, r->fd, IORING_UNREGISTER_BUFFERS, 0, 0);
+	
+	exit:
+	free(queue);
+	free(iov);
+}
+
+static void* uring_reader(void* arg) {
+	UringLoad* u = arg;
+	for(size_t first=0; first<u->count; first+=URING_WINDOW)
+		uring_window(u, first, u->count - first < URING_WINDOW ? u->count - first : URING_WINDOW);
+	return 0;
+}
+
+static void uring_parse_job(void* ctx, size_t k) {
+	UringLoad* u = ctx;
+	pthread_mutex_lock(&u->lock);
+	while(u->ready_count <= k)
+		pthread_cond_wait(&u->cond, &u->lock);
+	size_t i = u->ready[k];
+	pthread_mutex_unlock(&u->lock);
+	
+	UringFile* f = &u->files[i];
+	u->out[i] = f->data == 0 ? 0 : batch_prepare(sound_parse(f->data, f->size), u->opts);
+}
+
+long uring_batch_load(const char** paths, size_t count, WaveData** out, const BatchOptions* opts) {
+	if(count == 0)
+		return 0;
+	
+	UringLoad u;
+	memset(&u, 0, sizeof(u));
+	if(!uring_setup(&u.ring, URING_DEPTH))
+		return -1;
+	u.paths = paths;
+	u.count = count;
+	u.out = out;
+	u.opts = opts;
+	u.files = malloc(count * sizeof(UringFile));
+	u.ready = malloc(count * sizeof(size_t));
+	if(u.files == 0 || u.ready == 0) {
+		puts("Could not allocate memory.");
+		free(u.files);
+		free(u.ready);
+		uring_teardown(&u.ring);
+		return -1;
+	}
+	for(size_t i=0; i<count; i++) {
+		u.files[i].fd = -1;
+		u.files[i].data = 0;
+	}
+	pthread_mutex_init(&u.lock, 0);
+	pthread_cond_init(&u.cond, 0);
+	
+  // one thread drives the ring while the pool parses files as they land
+	pthread_t reader;
+	if(pthread_create(&reader, 0, uring_reader, &u) != 0) {
+		pthread_mutex_destroy(&u.lock);
+		pthread_cond_destroy(&u.cond);
+		free(u.files);
+		free(u.ready);
+		uring_teardown(&u.ring);
+		return -1;
+	}
+	pool_run(uring_parse_job, &u, count);
+	pthread_join(reader, 0);
+	
+	pthread_mutex_destroy(&u.lock);
+	pthread_cond_destroy(&u.cond);
+	free(u.files);
+	free(u.ready);
+	uring_teardown(&u.ring);
+	
+	long loaded = 0;
+	for(size_t i=0; i<count; i++)
+		if(out[i] != 0)
+			loaded++;
+	return loaded;
+}
+
+#else
+
+long uring_batch_load(const char** paths, size_t count, WaveData** out, const BatchOptions* opts) {
+	return -1;
+}
+
+#endif
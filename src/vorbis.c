@@ -0,0 +1,1305 @@
+/*
+MIT License
+
+Copyright (c) 2018 Cody Tilkins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "vorbis.h"
+#include "adpcm.h"
+#include "fft.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+
+// Vorbis I as laid out in the Xiph specification. Only floor 1 is
+// handled, no encoder has written floor 0 since 2002, and only the first
+// logical stream of a chained file is played.
+
+#define VORBIS_MAX_CHANNELS		8
+#define VORBIS_FAST_BITS		10
+#define VORBIS_FLOOR_VALUES		256 // 2 + 31 partitions * 8
+
+typedef struct OggStream {
+	FILE* f; // either a file or the memory below
+	const unsigned char* data;
+	size_t size;
+	size_t pos;
+	
+	uint32_t serial;
+	int started;
+	int ended; // the eos page went by
+	int eos;
+	int continued; // the page starts with the tail of a packet
+	int64_t granule;
+	unsigned char lacing[255];
+	unsigned int segments;
+	unsigned int segment;
+	unsigned char body[255 * 255];
+	size_t body_pos;
+	
+	unsigned char* packet;
+	size_t packet_size;
+	size_t packet_cap;
+} OggStream;
+
+typedef struct VorbisBits {
+	const unsigned char* data;
+	size_t size;
+	size_t pos; // in bits
+} VorbisBits;
+
+typedef struct VorbisBook {
+	unsigned int dimensions;
+	unsigned int entries;
+	unsigned char* lengths; // 0 for unused entries
+	uint32_t* codes; // bit reversed, so they match lsb first reads
+	int32_t fast[1 << VORBIS_FAST_BITS]; // entry for the next bits, -1 when longer
+	uint32_t* slow; // entries too long for the fast table
+	unsigned int slow_count;
+	float* vectors; // entries * dimensions, 0 for books without a lookup
+} VorbisBook;
+
+typedef struct VorbisFloor {
+	unsigned int partitions;
+	unsigned char partition_class[32];
+	unsigned char class_dimensions[16];
+	unsigned char class_subclasses[16];
+	unsigned char class_masterbook[16];
+	int16_t subclass_books[16][8];
+	unsigned int multiplier;
+	unsigned int values;
+	uint16_t x[VORBIS_FLOOR_VALUES];
+	unsigned char order[VORBIS_FLOOR_VALUES]; // by x
+	unsigned char low[VORBIS_FLOOR_VALUES]; // neighbours among the earlier values
+	unsigned char high[VORBIS_FLOOR_VALUES];
+} VorbisFloor;
+
+typedef struct VorbisResidue {
+	unsigned int type;
+	unsigned int begin;
+	unsigned int end;
+	unsigned int partition_size;
+	unsigned int classifications;
+	unsigned int classbook;
+	int16_t books[64][8];
+} VorbisResidue;
+
+typedef struct VorbisMapping {
+	unsigned int submaps;
+	unsigned int coupling_steps;
+	unsigned char magnitude[256];
+	unsigned char angle[256];
+	unsigned char mux[VORBIS_MAX_CHANNELS];
+	unsigned char submap_floor[16];
+	unsigned char submap_residue[16];
+} VorbisMapping;
+
+typedef struct VorbisMode {
+	unsigned int blockflag;
+	unsigned int mapping;
+} VorbisMode;
+
+typedef struct VorbisFile {
+	OggStream ogg;
+	unsigned int channels;
+	unsigned int sample_rate;
+	unsigned int blocksize[2];
+	
+	unsigned int book_count;
+	VorbisBook* books;
+	unsigned int floor_count;
+	VorbisFloor* floors;
+	unsigned int residue_count;
+	VorbisResidue* residues;
+	unsigned int mapping_count;
+	VorbisMapping* mappings;
+	unsigned int mode_count;
+	VorbisMode modes[64];
+	
+	FftPlan* plan[2];
+	float* twiddle[2]; // pre then post rotation, cos and sin pairs
+	float* slope[2]; // rising window half of blocksize / 2 samples
+	float* block[VORBIS_MAX_CHANNELS]; // coefficients in, samples out
+	float* overlap[VORBIS_MAX_CHANNELS]; // right half of the last block
+	int* floor_y[VORBIS_MAX_CHANNELS];
+	float* curve;
+	float* dct;
+	float* re;
+	float* im;
+	float* interleave; // residue type 2 works on all channels at once
+	unsigned char* classes;
+	
+	unsigned int prev_n; // 0 until the first block primes the overlap
+	float* out; // decoded frames, interleaved
+	size_t out_frames;
+	size_t out_pos;
+	uint64_t produced;
+} VorbisFile;
+
+
+// ----- ogg
+
+static uint32_t ogg_u32(const unsigned char* p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static int ogg_fill(OggStream* o, unsigned char* out, size_t n) {
+	if(o->f != 0)
+		return fread(out, 1, n, o->f) == n;
+	if(n > o->size - o->pos)
+		return 0;
+	memcpy(out, o->data + o->pos, n);
+	o->pos += n;
+	return 1;
+}
+
+static void ogg_rewind(OggStream* o) {
+	if(o->f != 0)
+		fseek(o->f, 0, SEEK_SET);
+	o->pos = 0;
+	o->started = 0;
+	o->ended = 0;
+	o->eos = 0;
+	o->segments = 0;
+	o->segment = 0;
+}
+
+// reads the next page of our logical stream, pages of others are skipped
+static int ogg_page(OggStream* o) {
+	unsigned char h[27];
+	for(;;) {
+		if(o->ended || !ogg_fill(o, h, 27))
+			return 0;
+		if(memcmp(h, "OggS", 4) != 0 || h[4] != 0)
+			return 0;
+		unsigned int segments = h[26];
+		if(!ogg_fill(o, o->lacing, segments))
+			return 0;
+		size_t body = 0;
+		for(unsigned int i=0; i<segments; i++)
+			body += o->lacing[i];
+		if(!ogg_fill(o, o->body, body))
+			return 0;
+		
+		uint32_t serial = ogg_u32(h + 14);
+		if(!o->started) {
+			if(!(h[5] & 2))
+				continue;
+			o->serial = serial;
+			o->started = 1;
+		} else if(serial != o->serial) {
+			continue;
+		}
+		o->continued = h[5] & 1;
+		o->eos = (h[5] & 4) != 0;
+		o->ended = o->eos;
+		o->granule = (int64_t) ((uint64_t) ogg_u32(h + 6) | ((uint64_t) ogg_u32(h + 10) << 32));
+		o->segments = segments;
+		o->segment = 0;
+		o->body_pos = 0;
+		return 1;
+	}
+}
+
+// assembles the next packet, last is set for the final one on the eos page
+static int ogg_packet(OggStream* o, int* last) {
+	o->packet_size = 0;
+	for(;;) {
+		if(o->segment == o->segments) {
+			if(!ogg_page(o))
+				return 0;
+			
+		  // the tail of a packet we never saw the start of
+			if(o->continued && o->packet_size == 0) {
+				while(o->segment < o->segments) {
+					unsigned int len = o->lacing[o->segment++];
+					o->body_pos += len;
+					if(len < 255)
+						break;
+				}
+			}
+			continue;
+		}
+		
+		unsigned int len = o->lacing[o->segment++];
+		if(o->packet_size + len > o->packet_cap) {
+			size_t cap = o->packet_cap ? o->packet_cap * 2 : 4096;
+			unsigned char* p = realloc(o->packet, cap);
+			if(p == 0) {
+				puts("Could not allocate memory.");
+				return 0;
+			}
+			o->packet = p;
+			o->packet_cap = cap;
+		}
+		memcpy(o->packet + o->packet_size, o->body + o->body_pos, len);
+		o->body_pos += len;
+		o->packet_size += len;
+		if(len == 255)
+			continue;
+		
+		*last = o->eos;
+		for(unsigned int i=o->segment; i<o->segments && *last; i++)
+			if(o->lacing[i] < 255)
+				*last = 0;
+		return 1;
+	}
+}
+
+
+// ----- bits
+
+static inline uint64_t vorbis_peek(const VorbisBits* b) {
+	size_t byte = b->pos >> 3;
+	uint64_t v = 0;
+	if(byte + 8 <= b->size) {
+		for(int i=7; i>=0; i--)
+			v = (v << 8) | b->data[byte + i];
+	} else {
+		for(int i=7; i>=0; i--)
+			v = (v << 8) | (byte + i < b->size ? b->data[byte + i] : 0);
+	}
+	return v >> (b->pos & 7);
+}
+
+// up to 32 bits, lsb first
+static inline uint32_t vorbis_bits(VorbisBits* b, unsigned int n) {
+	if(n == 0)
+		return 0;
+	uint32_t v = (uint32_t) (vorbis_peek(b) & (((uint64_t) 1 << n) - 1));
+	b->pos += n;
+	return v;
+}
+
+static inline int vorbis_overrun(const VorbisBits* b) {
+	return b->pos > b->size * 8;
+}
+
+static unsigned int vorbis_ilog(uint32_t v) {
+	unsigned int r = 0;
+	while(v != 0) {
+		r++;
+		v >>= 1;
+	}
+	return r;
+}
+
+
+// ----- codebooks
+
+static float vorbis_float32(uint32_t x) {
+	double mantissa = x & 0x1fffff;
+	int exponent = (x & 0x7fe00000) >> 21;
+	if(x & 0x80000000)
+		mantissa = -mantissa;
+	return ldexp(mantissa, exponent - 788);
+}
+
+// the largest r with r^dimensions <= entries
+static unsigned int vorbis_lookup1(unsigned int entries, unsigned int dimensions) {
+	unsigned int r = (unsigned int) floor(exp(log((double) entries) / dimensions));
+	while(pow(r + 1, dimensions) <= entries)
+		r++;
+	while(r > 0 && pow(r, dimensions) > entries)
+		r--;
+	return r;
+}
+
+static uint32_t vorbis_reverse(uint32_t v) {
+	v = ((v >> 1) & 0x55555555) | ((v & 0x55555555) << 1);
+	v = ((v >> 2) & 0x33333333) | ((v & 0x33333333) << 2);
+	v = ((v >> 4) & 0x0F0F0F0F) | ((v & 0x0F0F0F0F) << 4);
+	v = ((v >> 8) & 0x00FF00FF) | ((v & 0x00FF00FF) << 8);
+	return (v >> 16) | (v << 16);
+}
+
+// hands out codewords in entry order, each taking the lowest free leaf
+static int vorbis_book_codes(VorbisBook* c) {
+	uint32_t available[33] = {0};
+	unsigned int used = 0;
+	for(unsigned int i=0; i<c->entries; i++) {
+		unsigned int len = c->lengths[i];
+		if(len == 0)
+			continue;
+		uint32_t code = 0;
+		if(used == 0) {
+			for(unsigned int k=1; k<=len; k++)
+				available[k] = (uint32_t) 1 << (32 - k);
+		} else {
+			unsigned int z = len;
+			while(z > 0 && available[z] == 0)
+				z--;
+			if(z == 0)
+				return 0; // overspecified
+			code = available[z];
+			available[z] = 0;
+			for(unsigned int y=len; y>z; y--)
+				available[y] = code + ((uint32_t) 1 << (32 - y));
+		}
+		c->codes[i] = vorbis_reverse(code);
+		used++;
+	}
+	
+	for(unsigned int i=0; i<(1 << VORBIS_FAST_BITS); i++)
+		c->fast[i] = -1;
+	for(unsigned int i=0; i<c->entries; i++) {
+		unsigned int len = c->lengths[i];
+		if(len == 0)
+			continue;
+		if(used == 1) {
+		  // a lone entry is read whatever its bits say
+			for(unsigned int k=0; k<(1 << VORBIS_FAST_BITS); k++)
+				c->fast[k] = i;
+		} else if(len <= VORBIS_FAST_BITS) {
+			for(uint32_t k=c->codes[i]; k<(1 << VORBIS_FAST_BITS); k+=(uint32_t) 1 << len)
+				c->fast[k] = i;
+		} else {
+			c->slow[c->slow_count++] = i;
+		}
+	}
+	return 1;
+}
+
+static int vorbis_decode(VorbisBits* b, const VorbisBook* c) {
+	uint64_t v = vorbis_peek(b);
+	int32_t e = c->fast[v & ((1 << VORBIS_FAST_BITS) - 1)];
+	if(e < 0) {
+		for(unsigned int i=0; i<c->slow_count; i++) {
+			uint32_t s = c->slow[i];
+			if((v & (((uint64_t) 1 << c->lengths[s]) - 1)) == c->codes[s]) {
+				e = s;
+				break;
+			}
+		}
+		if(e < 0)
+			return -1;
+	}
+	b->pos += c->lengths[e];
+	if(vorbis_overrun(b))
+		return -1;
+	return e;
+}
+
+static int vorbis_read_book(VorbisBits* b, VorbisBook* c) {
+	if(vorbis_bits(b, 24) != 0x564342)
+		return 0;
+	c->dimensions = vorbis_bits(b, 16);
+	c->entries = vorbis_bits(b, 24);
+	if(c->dimensions == 0 || c->entries == 0)
+		return 0;
+	c->lengths = calloc(c->entries, 1);
+	c->codes = calloc(c->entries, sizeof(uint32_t));
+	c->slow = calloc(c->entries, sizeof(uint32_t));
+	if(c->lengths == 0 || c->codes == 0 || c->slow == 0) {
+		puts("Could not allocate memory.");
+		return 0;
+	}
+	
+	if(vorbis_bits(b, 1)) {
+		unsigned int entry = 0;
+		unsigned int length = vorbis_bits(b, 5) + 1;
+		while(entry < c->entries) {
+			unsigned int count = vorbis_bits(b, vorbis_ilog(c->entries - entry));
+			if(count > c->entries - entry || length > 32 || vorbis_overrun(b))
+				return 0;
+			memset(c->lengths + entry, length, count);
+			entry += count;
+			length++;
+		}
+	} else {
+		int sparse = vorbis_bits(b, 1);
+		for(unsigned int i=0; i<c->entries; i++)
+			if(!sparse || vorbis_bits(b, 1))
+				c->lengths[i] = vorbis_bits(b, 5) + 1;
+	}
+	
+	unsigned int lookup = vorbis_bits(b, 4);
+	if(lookup == 1 || lookup == 2) {
+		float minimum = vorbis_float32(vorbis_bits(b, 32));
+		float delta = vorbis_float32(vorbis_bits(b, 32));
+		unsigned int value_bits = vorbis_bits(b, 4) + 1;
+		int sequence = vorbis_bits(b, 1);
+		uint64_t values = lookup == 1
+			? vorbis_lookup1(c->entries, c->dimensions)
+			: (uint64_t) c->entries * c->dimensions;
+		
+	  // every value is in the packet, which bounds the allocations
+		if(values == 0 || values * value_bits > b->size * 8 - (b->pos < b->size * 8 ? b->pos : b->size * 8)
+			|| (uint64_t) c->entries * c->dimensions > ((uint64_t) 1 << 24))
+			return 0;
+		uint32_t* multiplicands = malloc(values * sizeof(uint32_t));
+		c->vectors = malloc((size_t) c->entries * c->dimensions * sizeof(float));
+		if(multiplicands == 0 || c->vectors == 0) {
+			puts("Could not allocate memory.");
+			free(multiplicands);
+			return 0;
+		}
+		for(uint64_t i=0; i<values; i++)
+			multiplicands[i] = vorbis_bits(b, value_bits);
+		
+		for(unsigned int e=0; e<c->entries; e++) {
+			float* v = c->vectors + (size_t) e * c->dimensions;
+			float last = 0;
+			uint64_t divisor = 1;
+			for(unsigned int i=0; i<c->dimensions; i++) {
+				uint64_t index = lookup == 1
+					? (e / divisor) % values
+					: (uint64_t) e * c->dimensions + i;
+				v[i] = multiplicands[index] * delta + minimum + last;
+				if(sequence)
+					last = v[i];
+				divisor *= values;
+			}
+		}
+		free(multiplicands);
+	} else if(lookup != 0) {
+		return 0;
+	}
+	
+	if(vorbis_overrun(b))
+		return 0;
+	return vorbis_book_codes(c);
+}
+
+
+// ----- floors
+
+static int vorbis_read_floor(VorbisBits* b, VorbisFloor* f, unsigned int books) {
+	if(vorbis_bits(b, 16) != 1) {
+		puts("Vorbis floor 0 is not supported.");
+		return 0;
+	}
+	f->partitions = vorbis_bits(b, 5);
+	int classes = -1;
+	for(unsigned int i=0; i<f->partitions; i++) {
+		f->partition_class[i] = vorbis_bits(b, 4);
+		if(f->partition_class[i] > classes)
+			classes = f->partition_class[i];
+	}
+	for(int i=0; i<=classes; i++) {
+		f->class_dimensions[i] = vorbis_bits(b, 3) + 1;
+		f->class_subclasses[i] = vorbis_bits(b, 2);
+		if(f->class_subclasses[i] != 0) {
+			f->class_masterbook[i] = vorbis_bits(b, 8);
+			if(f->class_masterbook[i] >= books)
+				return 0;
+		}
+		for(unsigned int j=0; j<(1u << f->class_subclasses[i]); j++) {
+			f->subclass_books[i][j] = (int16_t) vorbis_bits(b, 8) - 1;
+			if(f->subclass_books[i][j] >= (int) books)
+				return 0;
+		}
+	}
+	
+	f->multiplier = vorbis_bits(b, 2) + 1;
+	unsigned int range_bits = vorbis_bits(b, 4);
+	f->x[0] = 0;
+	f->x[1] = 1 << range_bits;
+	f->values = 2;
+	for(unsigned int i=0; i<f->partitions; i++)
+		for(unsigned int j=0; j<f->class_dimensions[f->partition_class[i]]; j++)
+			f->x[f->values++] = vorbis_bits(b, range_bits);
+	if(vorbis_overrun(b))
+		return 0;
+	
+	for(unsigned int i=0; i<f->values; i++) {
+		unsigned int j = i;
+		for(; j>0 && f->x[f->order[j - 1]] > f->x[i]; j--)
+			f->order[j] = f->order[j - 1];
+		f->order[j] = i;
+	}
+	for(unsigned int i=1; i<f->values; i++)
+		if(f->x[f->order[i]] == f->x[f->order[i - 1]])
+			return 0;
+	for(unsigned int i=2; i<f->values; i++) {
+		int low = -1, high = -1;
+		for(unsigned int j=0; j<i; j++) {
+			if(f->x[j] < f->x[i] && (low < 0 || f->x[j] > f->x[low]))
+				low = j;
+			if(f->x[j] > f->x[i] && (high < 0 || f->x[j] < f->x[high]))
+				high = j;
+		}
+		f->low[i] = low;
+		f->high[i] = high;
+	}
+	return 1;
+}
+
+static int vorbis_point(int x0, int y0, int x1, int y1, int x) {
+	int dy = y1 - y0;
+	int off = abs(dy) * (x - x0) / (x1 - x0);
+	return dy < 0 ? y0 - off : y0 + off;
+}
+
+// reads the floor of one channel into y, points left out of the curve
+// are -1; returns 0 when the channel is silent in this packet
+static int vorbis_floor_decode(VorbisBits* b, const VorbisFile* v, const VorbisFloor* f, int* y) {
+	if(vorbis_bits(b, 1) == 0)
+		return 0;
+	static const int ranges[4] = {256, 128, 86, 64};
+	int range = ranges[f->multiplier - 1];
+	unsigned int y_bits = vorbis_ilog(range - 1);
+	int raw[VORBIS_FLOOR_VALUES];
+	raw[0] = vorbis_bits(b, y_bits);
+	raw[1] = vorbis_bits(b, y_bits);
+	
+	unsigned int offset = 2;
+	for(unsigned int i=0; i<f->partitions; i++) {
+		unsigned int cls = f->partition_class[i];
+		unsigned int dims = f->class_dimensions[cls];
+		unsigned int sub_bits = f->class_subclasses[cls];
+		unsigned int sub_mask = (1 << sub_bits) - 1;
+		int cval = 0;
+		if(sub_bits != 0) {
+			cval = vorbis_decode(b, &v->books[f->class_masterbook[cls]]);
+			if(cval < 0)
+				return 0;
+		}
+		for(unsigned int j=0; j<dims; j++) {
+			int book = f->subclass_books[cls][cval & sub_mask];
+			cval >>= sub_bits;
+			raw[offset + j] = 0;
+			if(book >= 0 && (raw[offset + j] = vorbis_decode(b, &v->books[book])) < 0)
+				return 0;
+		}
+		offset += dims;
+	}
+	if(vorbis_overrun(b))
+		return 0;
+	
+  // each point is coded against the line through its neighbours
+	unsigned char used[VORBIS_FLOOR_VALUES];
+	used[0] = used[1] = 1;
+	y[0] = raw[0];
+	y[1] = raw[1];
+	for(unsigned int i=2; i<f->values; i++) {
+		unsigned int low = f->low[i], high = f->high[i];
+		int predicted = vorbis_point(f->x[low], y[low], f->x[high], y[high], f->x[i]);
+		int val = raw[i];
+		int high_room = range - predicted;
+		int low_room = predicted;
+		int room = (high_room < low_room ? high_room : low_room) * 2;
+		used[i] = val != 0;
+		if(val == 0) {
+			y[i] = predicted;
+			continue;
+		}
+		used[low] = used[high] = 1;
+		if(val >= room)
+			y[i] = high_room > low_room ? val - low_room + predicted : predicted - val + high_room - 1;
+		else
+			y[i] = val & 1 ? predicted - (val + 1) / 2 : predicted + val / 2;
+	}
+	for(unsigned int i=0; i<f->values; i++)
+		if(!used[i])
+			y[i] = -1;
+	return 1;
+}
+
+static float vorbis_db[256];
+
+static void vorbis_line(int x0, int y0, int x1, int y1, float* out, int n) {
+	int dy = y1 - y0;
+	int adx = x1 - x0;
+	int base = dy / adx;
+	int sy = dy < 0 ? base - 1 : base + 1;
+	int ady = abs(dy) - abs(base) * adx;
+	int y = y0, err = 0;
+	if(x0 < n)
+		out[x0] = vorbis_db[y & 255];
+	for(int x=x0+1; x<x1 && x<n; x++) {
+		err += ady;
+		if(err >= adx) {
+			err -= adx;
+			y += sy;
+		} else {
+			y += base;
+		}
+		out[x] = vorbis_db[y & 255];
+	}
+}
+
+static void vorbis_floor_render(const VorbisFloor* f, const int* y, float* out, int n) {
+	int lx = 0, ly = y[0] * f->multiplier;
+	for(unsigned int i=1; i<f->values; i++) {
+		unsigned int k = f->order[i];
+		if(y[k] < 0)
+			continue;
+		int hy = y[k] * f->multiplier;
+		vorbis_line(lx, ly, f->x[k], hy, out, n);
+		lx = f->x[k];
+		ly = hy;
+	}
+	if(lx < n)
+		vorbis_line(lx, ly, n, ly, out, n);
+}
+
+
+// ----- residues
+
+static int vorbis_read_residue(VorbisBits* b, VorbisResidue* r, const VorbisFile* v) {
+	r->type = vorbis_bits(b, 16);
+	if(r->type > 2)
+		return 0;
+	r->begin = vorbis_bits(b, 24);
+	r->end = vorbis_bits(b, 24);
+	r->partition_size = vorbis_bits(b, 24) + 1;
+	r->classifications = vorbis_bits(b, 6) + 1;
+	r->classbook = vorbis_bits(b, 8);
+	if(r->classbook >= v->book_count)
+		return 0;
+	
+	unsigned int cascade[64];
+	for(unsigned int i=0; i<r->classifications; i++) {
+		cascade[i] = vorbis_bits(b, 3);
+		if(vorbis_bits(b, 1))
+			cascade[i] |= vorbis_bits(b, 5) << 3;
+	}
+	for(unsigned int i=0; i<r->classifications; i++)
+		for(unsigned int pass=0; pass<8; pass++) {
+			r->books[i][pass] = -1;
+			if(cascade[i] & (1 << pass)) {
+				r->books[i][pass] = vorbis_bits(b, 8);
+				if(r->books[i][pass] >= (int) v->book_count || v->books[r->books[i][pass]].vectors == 0)
+					return 0;
+			}
+		}
+	return !vorbis_overrun(b);
+}
+
+// adds the coded vectors into vecs, each size long; a packet that runs
+// out early leaves the rest as it is
+static void vorbis_residue_partitions(VorbisFile* v, const VorbisResidue* r, VorbisBits* b,
+		float** vecs, unsigned int count, const int* skip, size_t size, int interleaved) {
+	
+	size_t begin = r->begin < size ? r->begin : size;
+	size_t end = r->end < size ? r->end : size;
+	if(end <= begin)
+		return;
+	size_t psize = r->partition_size;
+	size_t partitions = (end - begin) / psize;
+	const VorbisBook* classbook = &v->books[r->classbook];
+	unsigned int per_word = classbook->dimensions;
+	size_t stride = partitions + per_word;
+	
+	for(unsigned int pass=0; pass<8; pass++) {
+		size_t p = 0;
+		while(p < partitions) {
+			if(pass == 0) {
+				for(unsigned int j=0; j<count; j++) {
+					if(skip[j])
+						continue;
+					int word = vorbis_decode(b, classbook);
+					if(word < 0)
+						return;
+					for(unsigned int i=per_word; i-->0; ) {
+						v->classes[j * stride + p + i] = word % r->classifications;
+						word /= r->classifications;
+					}
+				}
+			}
+			for(unsigned int i=0; i<per_word && p<partitions; i++, p++) {
+				for(unsigned int j=0; j<count; j++) {
+					if(skip[j])
+						continue;
+					int book = r->books[v->classes[j * stride + p]][pass];
+					if(book < 0)
+						continue;
+					const VorbisBook* c = &v->books[book];
+					unsigned int dims = c->dimensions;
+					float* out = vecs[j] + begin + p * psize;
+					if(!interleaved && r->type == 0) {
+						size_t step = psize / dims;
+						for(size_t k=0; k<step; k++) {
+							int e = vorbis_decode(b, c);
+							if(e < 0)
+								return;
+							const float* t = c->vectors + (size_t) e * dims;
+							for(unsigned int d=0; d<dims; d++)
+								out[k + d * step] += t[d];
+						}
+					} else {
+						for(size_t k=0; k<psize; ) {
+							int e = vorbis_decode(b, c);
+							if(e < 0)
+								return;
+							const float* t = c->vectors + (size_t) e * dims;
+							for(unsigned int d=0; d<dims && k<psize; d++, k++)
+								out[k] += t[d];
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+static void vorbis_residue_decode(VorbisFile* v, const VorbisResidue* r, VorbisBits* b,
+		float** vecs, unsigned int count, const int* skip, size_t n) {
+	
+	if(r->type != 2) {
+		vorbis_residue_partitions(v, r, b, vecs, count, skip, n, 0);
+		return;
+	}
+	
+  // type 2 codes the channels interleaved into one long vector
+	unsigned int any = 0;
+	for(unsigned int j=0; j<count; j++)
+		any |= !skip[j];
+	if(!any)
+		return;
+	memset(v->interleave, 0, count * n * sizeof(float));
+	int none = 0;
+	vorbis_residue_partitions(v, r, b, &v->interleave, 1, &none, count * n, 1);
+	for(unsigned int j=0; j<count; j++)
+		for(size_t i=0; i<n; i++)
+			vecs[j][i] = v->interleave[i * count + j];
+}
+
+
+// ----- setup
+
+static int vorbis_read_mapping(VorbisBits* b, VorbisMapping* m, const VorbisFile* v) {
+	if(vorbis_bits(b, 16) != 0)
+		return 0;
+	m->submaps = vorbis_bits(b, 1) ? vorbis_bits(b, 4) + 1 : 1;
+	m->coupling_steps = vorbis_bits(b, 1) ? vorbis_bits(b, 8) + 1 : 0;
+	unsigned int bits = vorbis_ilog(v->channels - 1);
+	for(unsigned int i=0; i<m->coupling_steps; i++) {
+		m->magnitude[i] = vorbis_bits(b, bits);
+		m->angle[i] = vorbis_bits(b, bits);
+		if(m->magnitude[i] == m->angle[i] || m->magnitude[i] >= v->channels || m->angle[i] >= v->channels)
+			return 0;
+	}
+	if(vorbis_bits(b, 2) != 0)
+		return 0;
+	for(unsigned int i=0; i<v->channels; i++) {
+		m->mux[i] = m->submaps > 1 ? vorbis_bits(b, 4) : 0;
+		if(m->mux[i] >= m->submaps)
+			return 0;
+	}
+	for(unsigned int i=0; i<m->submaps; i++) {
+		vorbis_bits(b, 8); // unused time configuration
+		m->submap_floor[i] = vorbis_bits(b, 8);
+		m->submap_residue[i] = vorbis_bits(b, 8);
+		if(m->submap_floor[i] >= v->floor_count || m->submap_residue[i] >= v->residue_count)
+			return 0;
+	}
+	return !vorbis_overrun(b);
+}
+
+static int vorbis_read_setup(VorbisFile* v, const unsigned char* p, size_t size) {
+	if(size < 7 || p[0] != 5 || memcmp(p + 1, "vorbis", 6) != 0)
+		return 0;
+	VorbisBits b = {p + 7, size - 7, 0};
+	
+	v->book_count = vorbis_bits(&b, 8) + 1;
+	v->books = calloc(v->book_count, sizeof(VorbisBook));
+	if(v->books == 0)
+		return 0;
+	for(unsigned int i=0; i<v->book_count; i++)
+		if(!vorbis_read_book(&b, &v->books[i]))
+			return 0;
+	
+	unsigned int times = vorbis_bits(&b, 6) + 1;
+	for(unsigned int i=0; i<times; i++)
+		if(vorbis_bits(&b, 16) != 0)
+			return 0;
+	
+	v->floor_count = vorbis_bits(&b, 6) + 1;
+	v->floors = calloc(v->floor_count, sizeof(VorbisFloor));
+	if(v->floors == 0)
+		return 0;
+	for(unsigned int i=0; i<v->floor_count; i++)
+		if(!vorbis_read_floor(&b, &v->floors[i], v->book_count))
+			return 0;
+	
+	v->residue_count = vorbis_bits(&b, 6) + 1;
+	v->residues = calloc(v->residue_count, sizeof(VorbisResidue));
+	if(v->residues == 0)
+		return 0;
+	for(unsigned int i=0; i<v->residue_count; i++)
+		if(!vorbis_read_residue(&b, &v->residues[i], v))
+			return 0;
+	
+	v->mapping_count = vorbis_bits(&b, 6) + 1;
+	v->mappings = calloc(v->mapping_count, sizeof(VorbisMapping));
+	if(v->mappings == 0)
+		return 0;
+	for(unsigned int i=0; i<v->mapping_count; i++)
+		if(!vorbis_read_mapping(&b, &v->mappings[i], v))
+			return 0;
+	
+	v->mode_count = vorbis_bits(&b, 6) + 1;
+	for(unsigned int i=0; i<v->mode_count; i++) {
+		v->modes[i].blockflag = vorbis_bits(&b, 1);
+		unsigned int window = vorbis_bits(&b, 16);
+		unsigned int transform = vorbis_bits(&b, 16);
+		v->modes[i].mapping = vorbis_bits(&b, 8);
+		if(window != 0 || transform != 0 || v->modes[i].mapping >= v->mapping_count)
+			return 0;
+	}
+	return vorbis_bits(&b, 1) == 1 && !vorbis_overrun(&b);
+}
+
+static void vorbis_db_init(void) {
+	if(vorbis_db[255] != 0)
+		return;
+	for(int i=0; i<256; i++)
+		vorbis_db[i] = (float) pow(10, (i - 255) * 7.0 / 256);
+}
+
+// the window slopes, mdct rotations and per channel scratch
+static int vorbis_alloc(VorbisFile* v) {
+	vorbis_db_init();
+	size_t n = v->blocksize[1];
+	for(int i=0; i<2; i++) {
+		size_t m = v->blocksize[i] / 2, k = m / 2;
+		v->plan[i] = fft_plan(k);
+		v->twiddle[i] = malloc(4 * k * sizeof(float));
+		v->slope[i] = malloc(m * sizeof(float));
+		if(v->plan[i] == 0 || v->twiddle[i] == 0 || v->slope[i] == 0)
+			return 0;
+		for(size_t j=0; j<k; j++) {
+			double pre = -M_PI * (4 * j + 1) / (4.0 * m);
+			double post = -M_PI * j / m;
+			v->twiddle[i][4 * j + 0] = cos(pre);
+			v->twiddle[i][4 * j + 1] = sin(pre);
+			v->twiddle[i][4 * j + 2] = cos(post);
+			v->twiddle[i][4 * j + 3] = sin(post);
+		}
+		for(size_t j=0; j<m; j++) {
+			double s = sin((j + 0.5) / m * M_PI / 2);
+			v->slope[i][j] = sin(M_PI / 2 * s * s);
+		}
+	}
+	for(unsigned int c=0; c<v->channels; c++) {
+		v->block[c] = malloc(n * sizeof(float));
+		v->overlap[c] = calloc(n / 2, sizeof(float));
+		v->floor_y[c] = malloc(VORBIS_FLOOR_VALUES * sizeof(int));
+		if(v->block[c] == 0 || v->overlap[c] == 0 || v->floor_y[c] == 0)
+			return 0;
+	}
+	v->curve = malloc(n / 2 * sizeof(float));
+	v->dct = malloc(n / 2 * sizeof(float));
+	v->re = malloc(n / 4 * sizeof(float));
+	v->im = malloc(n / 4 * sizeof(float));
+	v->interleave = malloc(v->channels * n / 2 * sizeof(float));
+	v->classes = malloc(v->channels * (n / 2 + 64));
+	v->out = malloc(v->channels * n / 2 * sizeof(float));
+	return v->curve != 0 && v->dct != 0 && v->re != 0 && v->im != 0
+		&& v->interleave != 0 && v->classes != 0 && v->out != 0;
+}
+
+static int vorbis_headers(VorbisFile* v) {
+	int last = 0;
+	OggStream* o = &v->ogg;
+	
+	if(!ogg_packet(o, &last) || o->packet_size < 30 || o->packet[0] != 1 || memcmp(o->packet + 1, "vorbis", 6) != 0)
+		return 0;
+	const unsigned char* p = o->packet;
+	v->channels = p[11];
+	v->sample_rate = ogg_u32(p + 12);
+	v->blocksize[0] = 1 << (p[28] & 15);
+	v->blocksize[1] = 1 << (p[28] >> 4);
+	if(ogg_u32(p + 7) != 0 || v->sample_rate == 0 || (p[29] & 1) == 0
+		|| v->blocksize[0] < 64 || v->blocksize[1] > 8192 || v->blocksize[0] > v->blocksize[1])
+		return 0;
+	if(v->channels == 0 || v->channels > VORBIS_MAX_CHANNELS) {
+		puts("Unsupported channel count!");
+		return 0;
+	}
+	
+	if(!ogg_packet(o, &last) || o->packet_size < 7 || o->packet[0] != 3)
+		return 0;
+	if(!ogg_packet(o, &last) || !vorbis_read_setup(v, o->packet, o->packet_size))
+		return 0;
+	return 1;
+}
+
+
+// ----- audio
+
+// y[i] = sum X[k] cos(2pi/n (i + 1/2 + n/4)(k + 1/2)), through a dct-iv
+// of n/2 done as an n/4 point complex fft
+static void vorbis_imdct(VorbisFile* v, int blockflag, float* buf) {
+	unsigned int n = v->blocksize[blockflag], m = n / 2, k = n / 4;
+	const float* t = v->twiddle[blockflag];
+	float* re = v->re;
+	float* im = v->im;
+	for(unsigned int i=0; i<k; i++) {
+		float xr = buf[2 * i], xi = buf[m - 1 - 2 * i];
+		re[i] = xr * t[4 * i] - xi * t[4 * i + 1];
+		im[i] = xr * t[4 * i + 1] + xi * t[4 * i];
+	}
+	fft_forward(v->plan[blockflag], re, im);
+	float* u = v->dct;
+	for(unsigned int i=0; i<k; i++) {
+		u[2 * i] = re[i] * t[4 * i + 2] - im[i] * t[4 * i + 3];
+		u[m - 1 - 2 * i] = -(re[i] * t[4 * i + 3] + im[i] * t[4 * i + 2]);
+	}
+	for(unsigned int i=0; i<k; i++)
+		buf[i] = u[i + k];
+	for(unsigned int i=k; i<3*k; i++)
+		buf[i] = -u[3 * k - 1 - i];
+	for(unsigned int i=3*k; i<n; i++)
+		buf[i] = -u[i - 3 * k];
+}
+
+// decodes one audio packet into out, returns the frames it finished
+// or -1 when the packet is not audio or is broken
+static int vorbis_packet(VorbisFile* v, const unsigned char* data, size_t size) {
+	VorbisBits b = {data, size, 0};
+	if(size == 0 || vorbis_bits(&b, 1) != 0)
+		return -1;
+	unsigned int mode = vorbis_bits(&b, vorbis_ilog(v->mode_count - 1));
+	if(mode >= v->mode_count)
+		return -1;
+	int blockflag = v->modes[mode].blockflag;
+	int prev_long = 0, next_long = 0;
+	if(blockflag) {
+		prev_long = vorbis_bits(&b, 1);
+		next_long = vorbis_bits(&b, 1);
+	}
+	if(vorbis_overrun(&b))
+		return -1;
+	const VorbisMapping* m = &v->mappings[v->modes[mode].mapping];
+	unsigned int n = v->blocksize[blockflag], half = n / 2;
+	unsigned int channels = v->channels;
+	
+	int silent[VORBIS_MAX_CHANNELS], skip[VORBIS_MAX_CHANNELS];
+	for(unsigned int c=0; c<channels; c++) {
+		const VorbisFloor* f = &v->floors[m->submap_floor[m->mux[c]]];
+		silent[c] = !vorbis_floor_decode(&b, v, f, v->floor_y[c]);
+		skip[c] = silent[c];
+	}
+	for(unsigned int i=0; i<m->coupling_steps; i++)
+		if(!skip[m->magnitude[i]] || !skip[m->angle[i]])
+			skip[m->magnitude[i]] = skip[m->angle[i]] = 0;
+	
+	for(unsigned int c=0; c<channels; c++)
+		memset(v->block[c], 0, half * sizeof(float));
+	for(unsigned int s=0; s<m->submaps; s++) {
+		float* vecs[VORBIS_MAX_CHANNELS];
+		int sub_skip[VORBIS_MAX_CHANNELS];
+		unsigned int count = 0;
+		for(unsigned int c=0; c<channels; c++)
+			if(m->mux[c] == s) {
+				vecs[count] = v->block[c];
+				sub_skip[count++] = skip[c];
+			}
+		vorbis_residue_decode(v, &v->residues[m->submap_residue[s]], &b, vecs, count, sub_skip, half);
+	}
+	
+	for(unsigned int i=m->coupling_steps; i-->0; ) {
+		float* mag = v->block[m->magnitude[i]];
+		float* ang = v->block[m->angle[i]];
+		for(unsigned int j=0; j<half; j++) {
+			float mv = mag[j], av = ang[j];
+			if(mv > 0) {
+				if(av > 0) {
+					ang[j] = mv - av;
+				} else {
+					ang[j] = mv;
+					mag[j] = mv + av;
+				}
+			} else {
+				if(av > 0) {
+					ang[j] = mv + av;
+				} else {
+					ang[j] = mv;
+					mag[j] = mv - av;
+				}
+			}
+		}
+	}
+	
+  // the floor curve shapes the residue, then back to the time domain
+	unsigned int bs0 = v->blocksize[0];
+	unsigned int left = blockflag && !prev_long ? n / 4 - bs0 / 4 : 0;
+	unsigned int left_n = blockflag && !prev_long ? bs0 / 2 : half;
+	unsigned int right = blockflag && !next_long ? n * 3 / 4 - bs0 / 4 : half;
+	unsigned int right_n = blockflag && !next_long ? bs0 / 2 : half;
+	const float* left_slope = v->slope[left_n == half ? blockflag : 0];
+	const float* right_slope = v->slope[right_n == half ? blockflag : 0];
+	for(unsigned int c=0; c<channels; c++) {
+		float* x = v->block[c];
+		if(silent[c]) {
+			memset(x, 0, n * sizeof(float));
+		} else {
+			vorbis_floor_render(&v->floors[m->submap_floor[m->mux[c]]], v->floor_y[c], v->curve, half);
+			for(unsigned int j=0; j<half; j++)
+				x[j] *= v->curve[j];
+			vorbis_imdct(v, blockflag, x);
+		}
+		memset(x, 0, left * sizeof(float));
+		for(unsigned int j=0; j<left_n; j++)
+			x[left + j] *= left_slope[j];
+		for(unsigned int j=0; j<right_n; j++)
+			x[right + j] *= right_slope[right_n - 1 - j];
+		memset(x + right + right_n, 0, (n - right - right_n) * sizeof(float));
+	}
+	
+  // what is finished runs from the centre of the last block to this one's
+	int frames = 0;
+	if(v->prev_n != 0) {
+		unsigned int prev = v->prev_n;
+		frames = prev / 4 + n / 4;
+		for(unsigned int c=0; c<channels; c++) {
+			const float* x = v->block[c];
+			const float* o = v->overlap[c];
+			for(int j=0; j<frames; j++) {
+				float s = (unsigned int) j < prev / 2 ? o[j] : 0;
+				int i = j - (int) (prev / 4) + (int) (n / 4);
+				if(i >= 0)
+					s += x[i];
+				v->out[j * channels + c] = s;
+			}
+		}
+	}
+	for(unsigned int c=0; c<channels; c++)
+		memcpy(v->overlap[c], v->block[c] + half, half * sizeof(float));
+	v->prev_n = n;
+	return frames;
+}
+
+// refills the decoded frames, 0 at the end of the stream
+static int vorbis_next(VorbisFile* v) {
+	for(;;) {
+		int last = 0;
+		if(!ogg_packet(&v->ogg, &last))
+			return 0;
+		int frames = vorbis_packet(v, v->ogg.packet, v->ogg.packet_size);
+		if(frames < 0)
+			continue;
+		
+	  // the last granule position cuts the padding off the final block, one
+	  // that lands before the block is bogus and left alone
+		if(last && v->ogg.granule >= 0 && (uint64_t) v->ogg.granule >= v->produced
+			&& v->produced + frames > (uint64_t) v->ogg.granule)
+			frames = (int) (v->ogg.granule - v->produced);
+		v->out_frames = frames;
+		v->out_pos = 0;
+		v->produced += frames;
+		if(frames > 0)
+			return 1;
+		if(last)
+			return 0;
+	}
+}
+
+static size_t vorbis_read(VorbisFile* v, float* out, size_t frames) {
+	size_t done = 0;
+	while(done < frames) {
+		if(v->out_pos == v->out_frames && !vorbis_next(v))
+			break;
+		size_t n = v->out_frames - v->out_pos;
+		if(n > frames - done)
+			n = frames - done;
+		memcpy(out + done * v->channels, v->out + v->out_pos * v->channels, n * v->channels * sizeof(float));
+		v->out_pos += n;
+		done += n;
+	}
+	return done;
+}
+
+static void vorbis_free(VorbisFile* v) {
+	if(v == 0)
+		return;
+	if(v->ogg.f != 0)
+		fclose(v->ogg.f);
+	free(v->ogg.packet);
+	for(unsigned int i=0; i<v->book_count && v->books != 0; i++) {
+		free(v->books[i].lengths);
+		free(v->books[i].codes);
+		free(v->books[i].slow);
+		free(v->books[i].vectors);
+	}
+	free(v->books);
+	free(v->floors);
+	free(v->residues);
+	free(v->mappings);
+	for(int i=0; i<2; i++) {
+		fft_free(v->plan[i]);
+		free(v->twiddle[i]);
+		free(v->slope[i]);
+	}
+	for(unsigned int c=0; c<VORBIS_MAX_CHANNELS; c++) {
+		free(v->block[c]);
+		free(v->overlap[c]);
+		free(v->floor_y[c]);
+	}
+	free(v->curve);
+	free(v->dct);
+	free(v->re);
+	free(v->im);
+	free(v->interleave);
+	free(v->classes);
+	free(v->out);
+	free(v);
+}
+
+// takes the file, or borrows the memory
+static VorbisFile* vorbis_open(FILE* f, const unsigned char* data, size_t size) {
+	VorbisFile* v = calloc(1, sizeof(VorbisFile));
+	if(v == 0) {
+		puts("Could not allocate memory.");
+		if(f != 0)
+			fclose(f);
+		return 0;
+	}
+	v->ogg.f = f;
+	v->ogg.data = data;
+	v->ogg.size = size;
+	if(!vorbis_headers(v) || !vorbis_alloc(v)) {
+		vorbis_free(v);
+		return 0;
+	}
+	return v;
+}
+
+static int vorbis_rewind(VorbisFile* v) {
+	ogg_rewind(&v->ogg);
+	int last = 0;
+	for(int i=0; i<3; i++)
+		if(!ogg_packet(&v->ogg, &last))
+			return 0;
+	for(unsigned int c=0; c<v->channels; c++)
+		memset(v->overlap[c], 0, v->blocksize[1] / 2 * sizeof(float));
+	v->prev_n = 0;
+	v->out_frames = 0;
+	v->out_pos = 0;
+	v->produced = 0;
+	return 1;
+}
+
+
+WaveData* vorbis_parse(unsigned char* buffer, size_t size) {
+	
+	VorbisFile* v = vorbis_open(0, buffer, size);
+	if(v == 0) {
+		puts("Could not decode vorbis file.");
+		free(buffer);
+		return 0;
+	}
+	
+  // the length is only known at the end, grow as it decodes
+	size_t cap = v->sample_rate, frames = 0;
+	float* pcm = malloc(cap * v->channels * sizeof(float));
+	for(;;) {
+		if(pcm == 0)
+			break;
+		size_t got = vorbis_read(v, pcm + frames * v->channels, cap - frames);
+		frames += got;
+		if(frames < cap)
+			break;
+		float* grown = realloc(pcm, cap * 2 * v->channels * sizeof(float));
+		if(grown == 0) {
+			free(pcm);
+			pcm = 0;
+			break;
+		}
+		pcm = grown;
+		cap *= 2;
+	}
+	unsigned int channels = v->channels, sample_rate = v->sample_rate;
+	vorbis_free(v);
+	free(buffer);
+	
+	WaveData* data = pcm != 0 ? calloc(1, sizeof(WaveData)) : 0;
+	if(data == 0) {
+		puts("Could not allocate memory.");
+		free(pcm);
+		return 0;
+	}
+	data->format = WAVE_FORMAT_IEEE_FLOAT;
+	data->channels = channels;
+	data->bps = 32;
+	data->sample_rate = sample_rate;
+	data->block_align = channels * sizeof(float);
+	data->sound_size = frames * channels * sizeof(float);
+	data->data = (unsigned char*) pcm;
+	data->sound_data = (unsigned char*) pcm;
+	return data;
+}
+
+
+typedef struct VorbisDecoder {
+	Decoder base;
+	VorbisFile* v;
+	float scratch[1024 * VORBIS_MAX_CHANNELS];
+} VorbisDecoder;
+
+static size_t vorbis_decoder_read(Decoder* d, short* out, size_t frames) {
+	VorbisDecoder* vd = (VorbisDecoder*) d;
+	size_t done = 0;
+	while(done < frames) {
+		size_t want = frames - done < 1024 ? frames - done : 1024;
+		size_t got = vorbis_read(vd->v, vd->scratch, want);
+		for(size_t i=0; i<got * d->channels; i++) {
+			float s = vd->scratch[i] * 32768;
+			out[done * d->channels + i] = s >= 32767 ? 32767 : s <= -32768 ? -32768 : (short) lrintf(s);
+		}
+		done += got;
+		if(got < want)
+			break;
+	}
+	return done;
+}
+
+static int vorbis_decoder_rewind(Decoder* d) {
+	return vorbis_rewind(((VorbisDecoder*) d)->v);
+}
+
+static void vorbis_decoder_close(Decoder* d) {
+	VorbisDecoder* vd = (VorbisDecoder*) d;
+	vorbis_free(vd->v);
+	free(vd);
+}
+
+Decoder* vorbis_decoder_open(const char* path) {
+	
+	FILE* f = fopen(path, "rb");
+	VorbisFile* v = f != 0 ? vorbis_open(f, 0, 0) : 0;
+	if(v == 0) {
+		puts("Could not open vorbis file.");
+		return 0;
+	}
+	
+	VorbisDecoder* vd = calloc(1, sizeof(VorbisDecoder));
+	if(vd == 0) {
+		puts("Could not allocate memory.");
+		vorbis_free(v);
+		return 0;
+	}
+	
+	vd->v = v;
+	vd->base.channels = v->channels;
+	vd->base.sample_rate = v->sample_rate;
+	vd->base.read = vorbis_decoder_read;
+	vd->base.rewind = vorbis_decoder_rewind;
+	vd->base.close = vorbis_decoder_close;
+	return &vd->base;
+}
@@ -23,22 +23,99 @@ SOFTWARE.
 */
 
 #include "wave.h"
+#include "resample.h"
+#include "adpcm.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
+
+static inline unsigned int wave_u16(const unsigned char* p) {
+	return p[0] | (p[1] << 8);
+}
+
+static inline unsigned int wave_u32(const unsigned char* p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
+// swaps in a new sound buffer of size bytes at bps, freeing the old one
+static void wave_replace(WaveData* wd, unsigned char* out, size_t size, unsigned int bps, unsigned int format) {
+	free(wd->data);
+	wd->data = out;
+	wd->sound_data = out;
+	wd->sound_size = size;
+	wd->bps = bps;
+	wd->format = format;
+	wd->block_align = wd->channels * (bps / 8);
+}
+
+// widens any pcm, or narrows 64 bit float, into 32 bit float; AL has no
+// format for 24 and 32 bit integers so those always come through here
+static int wave_float(WaveData* wd) {
+	if(wd->format == WAVE_FORMAT_IEEE_FLOAT && wd->bps == 32)
+		return 1;
+	size_t width = wd->bps / 8;
+	size_t samples = width ? wd->sound_size / width : 0;
+	float* out = malloc(1 * (samples ? samples : 1) * sizeof(float));
+	if(out == 0) {
+		puts("Could not allocate memory.");
+		return 0;
+	}
+	
+	const unsigned char* p = wd->sound_data;
+	if(wd->format == WAVE_FORMAT_IEEE_FLOAT) {
+		for(size_t i=0; i<samples; i++) {
+			double d;
+			memcpy(&d, p + i * 8, sizeof(d));
+			out[i] = d;
+		}
+	} else if(wd->bps == 8) {
+		for(size_t i=0; i<samples; i++)
+			out[i] = (p[i] - 128) * (1.0f / 128);
+	} else if(wd->bps == 16) {
+		const short* in = (const short*) p;
+		for(size_t i=0; i<samples; i++)
+			out[i] = in[i] * (1.0f / 32768);
+	} else if(wd->bps == 24) {
+		for(size_t i=0; i<samples; i++, p+=3)
+			out[i] = (p[0] | (p[1] << 8) | ((signed char) p[2] * 65536)) * (1.0f / 8388608);
+	} else {
+		for(size_t i=0; i<samples; i++)
+			out[i] = (int) wave_u32(p + i * 4) * (1.0f / 2147483648.0f);
+	}
+	
+	wave_replace(wd, (unsigned char*) out, samples * sizeof(float), 32, WAVE_FORMAT_IEEE_FLOAT);
+	return 1;
+}
+
+// 32 bit float down to 16 bit pcm, clipping at full scale
+static int wave_s16(WaveData* wd) {
+	size_t samples = wd->sound_size / sizeof(float);
+	short* out = malloc(1 * (samples ? samples : 1) * sizeof(short));
+	if(out == 0) {
+		puts("Could not allocate memory.");
+		return 0;
+	}
+	const float* in = (const float*) wd->sound_data;
+	for(size_t i=0; i<samples; i++) {
+		float v = in[i] * 32768;
+		out[i] = v >= 32767 ? 32767 : v <= -32768 ? -32768 : (short) lrintf(v);
+	}
+	wave_replace(wd, (unsigned char*) out, samples * sizeof(short), 16, WAVE_FORMAT_PCM);
+	return 1;
+}
 
 // loads data stored in wave file into a struct, returns said struct
 WaveData* wave_load(const char* path) {
 	
-	WaveData* data = 0;
 	unsigned char* buffer = 0;
 	
   // open and read all file contents
 	FILE* f = 0;
 	if((f = fopen(path, "rb")) == 0) {
 		puts("Could not open file.");
-		goto exit;
+		return 0;
 	}
 	
 	fseek(f, 0, SEEK_END);
@@ -49,49 +126,377 @@ WaveData* wave_load(const char* path) {
 	if(buffer == 0) {
 		puts("Could not allocate memory.");
 		fclose(f);
-		goto exit;
+		return 0;
 	}
-	fread(buffer, 1, file_size, f);
+	size_t read = fread(buffer, 1, file_size, f);
 	fclose(f);
 	
+	return wave_parse(buffer, read);
+}
+
+// reads the cue chunk, labels are filled in later from adtl
+static int wave_read_cues(WaveData* data, const unsigned char* chunk, size_t size) {
+	if(size < 4 || data->cues != 0)
+		return 1;
+	size_t count = wave_u32(chunk);
+	if(count > (size - 4) / 24)
+		count = (size - 4) / 24;
+	if(count == 0)
+		return 1;
+	data->cues = calloc(count, sizeof(WaveCue));
+	if(data->cues == 0) {
+		puts("Could not allocate memory.");
+		return 0;
+	}
+	for(size_t i=0; i<count; i++) {
+		const unsigned char* c = chunk + 4 + i * 24;
+		data->cues[i].id = wave_u32(c);
+		data->cues[i].position = wave_u32(c + 20); // sample offset into data
+	}
+	data->cue_count = count;
+	return 1;
+}
+
+// copies labl entries of a LIST adtl chunk onto the cues they name
+static void wave_read_labels(WaveData* data, const unsigned char* chunk, size_t size) {
+	if(size < 4 || memcmp(chunk, "adtl", 4) != 0)
+		return;
+	size_t offset = 4;
+	while(offset + 8 <= size) {
+		const unsigned char* sub = chunk + offset;
+		size_t sub_size = wave_u32(sub + 4);
+		if(sub_size > size - offset - 8)
+			break;
+		if(memcmp(sub, "labl", 4) == 0 && sub_size > 4) {
+			unsigned int id = wave_u32(sub + 8);
+			for(unsigned int i=0; i<data->cue_count; i++) {
+				if(data->cues[i].id != id)
+					continue;
+				size_t len = sub_size - 4;
+				if(len > WAVE_CUE_NAME - 1)
+					len = WAVE_CUE_NAME - 1;
+				memcpy(data->cues[i].name, sub + 12, len);
+				data->cues[i].name[len] = 0;
+			}
+		}
+		offset += 8 + sub_size + (sub_size & 1);
+	}
+}
+
+WaveData* wave_parse(unsigned char* buffer, size_t file_size) {
+	
+	WaveData* data = 0;
+	
   // ensure the file type is a wave file, identified by RIFF
-	if(memcmp(buffer, "RIFF", 4) != 0) {
+	if(file_size < 12 || memcmp(buffer, "RIFF", 4) != 0 || memcmp(buffer + 8, "WAVE", 4) != 0) {
 		puts("Invalid file header!");
 		goto exit;
 	}
 	
-  // pull out different useful data parameters from buffer
-	unsigned int channels = buffer[22] | (buffer[23] << 8);
-	unsigned int sample_rate = buffer[24] | (buffer[25] << 8) | (buffer[26] << 16) | (buffer[27] << 24);
-	unsigned int bps = buffer[34] | (buffer[35] << 8);
+	data = calloc(1, sizeof(WaveData));
+	if(data == 0) {
+		puts("Could not allocate memory.");
+		goto exit;
+	}
 	
-  // skip `useless to us` chunks
-	size_t chunk_offset = 36;
-	while(memcmp(buffer + chunk_offset, "data", 4) != 0) {
-		chunk_offset += 4;
-		chunk_offset += buffer[chunk_offset] | (buffer[chunk_offset+1] << 8) | (buffer[chunk_offset+2] << 16) | (buffer[chunk_offset+3] << 24);
-		chunk_offset += 4;
+  // walk the chunks, skipping `useless to us` ones; smpl and cue often
+  // come after data so the walk goes on to the end
+	int have_fmt = 0;
+	const unsigned char* labels = 0;
+	size_t labels_size = 0;
+	size_t chunk_offset = 12;
+	while(chunk_offset + 8 <= file_size) {
+		const unsigned char* chunk = buffer + chunk_offset;
+		size_t chunk_size = wave_u32(chunk + 4);
+		size_t avail = file_size - chunk_offset - 8;
+		
+		if(memcmp(chunk, "fmt ", 4) == 0 && chunk_size >= 16 && avail >= 16) {
+			data->format = wave_u16(chunk + 8);
+			data->channels = wave_u16(chunk + 10);
+			data->sample_rate = wave_u32(chunk + 12);
+			data->block_align = wave_u16(chunk + 20);
+			data->bps = wave_u16(chunk + 22);
+			if(chunk_size >= 20 && avail >= 20)
+				data->samples_per_block = wave_u16(chunk + 26);
+			if(data->format == WAVE_FORMAT_EXTENSIBLE && chunk_size >= 40 && avail >= 40)
+				data->format = wave_u16(chunk + 8 + 24); // first two bytes of the sub format guid
+			have_fmt = 1;
+		} else if(memcmp(chunk, "data", 4) == 0 && data->sound_data == 0) {
+		  // the data chunk may be followed by other chunks, or be truncated
+			data->sound_data = buffer + chunk_offset + 8;
+			data->sound_size = chunk_size > avail ? avail : chunk_size;
+		} else if(memcmp(chunk, "smpl", 4) == 0 && chunk_size >= 36 + 24 && avail >= 36 + 24) {
+			if(wave_u32(chunk + 8 + 28) > 0) {
+				data->loop_start = wave_u32(chunk + 8 + 36 + 8);
+				data->loop_end = wave_u32(chunk + 8 + 36 + 12) + 1; // stored inclusive
+			}
+		} else if(memcmp(chunk, "cue ", 4) == 0) {
+			if(!wave_read_cues(data, chunk + 8, chunk_size > avail ? avail : chunk_size))
+				goto exit;
+		} else if(memcmp(chunk, "LIST", 4) == 0 && chunk_size <= avail
+			&& chunk_size >= 4 && memcmp(chunk + 8, "adtl", 4) == 0) {
+		  // editors often follow adtl with a LIST INFO, which must not replace it
+			labels = chunk + 8;
+			labels_size = chunk_size;
+		}
+		
+	  // chunks are word aligned
+		if(chunk_size > avail)
+			break;
+		chunk_offset += 8 + chunk_size + (chunk_size & 1);
 	}
-	unsigned char* b_data = &(buffer[chunk_offset+8]);
 	
-	data = malloc(1 * sizeof(WaveData));
-	if(data == 0) {
-		puts("Could not allocate memory.");
+	if(!have_fmt || data->sound_data == 0) {
+		puts("Missing fmt or data chunk!");
+		goto exit;
+	}
+	if(labels != 0)
+		wave_read_labels(data, labels, labels_size);
+	int pcm = data->format == WAVE_FORMAT_PCM
+		&& (data->bps == 8 || data->bps == 16 || data->bps == 24 || data->bps == 32);
+	int ieee = data->format == WAVE_FORMAT_IEEE_FLOAT && (data->bps == 32 || data->bps == 64);
+	if(!pcm && !ieee && data->format != WAVE_FORMAT_ADPCM && data->format != WAVE_FORMAT_IMA_ADPCM) {
+		puts("Unsupported wave format!");
 		goto exit;
 	}
-	data->channels = channels;
-	data->bps = bps;
-	data->sample_rate = sample_rate;
-	data->sound_size = file_size - chunk_offset;
+	if(data->channels == 0 || data->channels > 8) {
+		puts("Unsupported channel count!");
+		goto exit;
+	}
+	
+  // trust the block size over the optional header field
+	if(data->format == WAVE_FORMAT_IMA_ADPCM)
+		data->samples_per_block = adpcm_ima_block_frames(data->channels, data->block_align);
+	else if(data->format == WAVE_FORMAT_ADPCM)
+		data->samples_per_block = adpcm_ms_block_frames(data->channels, data->block_align);
+	else
+		data->samples_per_block = 0;
+	
 	data->data = buffer; // this needs to be free'd; it is leaked and cleaned by wave_free()
-	data->sound_data = b_data;
 	
+  // only 8 and 16 bit integers and 32 bit float are kept as they are
+	if((ieee || data->bps > 16) && !wave_float(data))
+		goto exit;
 	return data;
 	
 exit:
 	free(buffer);
+	if(data != 0)
+		free(data->cues);
 	free(data);
-	return data;
+	return 0;
+}
+
+
+// expands adpcm into 16 bit pcm, plain pcm and float are left alone
+int wave_decode(WaveData* wd) {
+	
+	if(wd->format != WAVE_FORMAT_ADPCM && wd->format != WAVE_FORMAT_IMA_ADPCM)
+		return 1;
+	
+	int ima = wd->format == WAVE_FORMAT_IMA_ADPCM;
+	size_t frames = ima
+		? adpcm_ima_frames(wd->sound_size, wd->channels, wd->block_align)
+		: adpcm_ms_frames(wd->sound_size, wd->channels, wd->block_align);
+	
+	short* out = malloc(1 * (frames ? frames : 1) * wd->channels * sizeof(short));
+	if(out == 0) {
+		puts("Could not allocate memory.");
+		return 0;
+	}
+	
+	frames = ima
+		? adpcm_ima_decode(wd->sound_data, wd->sound_size, wd->channels, wd->block_align, out)
+		: adpcm_ms_decode(wd->sound_data, wd->sound_size, wd->channels, wd->block_align, out);
+	
+	free(wd->data);
+	wd->data = (unsigned char*) out;
+	wd->sound_data = (unsigned char*) out;
+	wd->sound_size = frames * wd->channels * sizeof(short);
+	wd->format = WAVE_FORMAT_PCM;
+	wd->bps = 16;
+	wd->block_align = wd->channels * sizeof(short);
+	wd->samples_per_block = 0;
+	return 1;
+}
+
+
+// resamples 16 bit or float pcm as it is, leaves wd untouched on failure
+static int wave_resample(WaveData* wd, unsigned int sample_rate, int quality) {
+	size_t width = wd->bps / 8;
+	size_t frames = wd->sound_size / (wd->channels * width);
+	float* out32 = 0;
+	short* out16 = 0;
+	size_t out_frames = 0;
+	int ok = width == sizeof(float)
+		? resample_f32((const float*) wd->sound_data, frames, wd->channels, wd->sample_rate, sample_rate, quality, &out32, &out_frames)
+		: resample_s16((const short*) wd->sound_data, frames, wd->channels, wd->sample_rate, sample_rate, quality, &out16, &out_frames);
+	if(!ok)
+		return 0;
+	unsigned char* out = out32 != 0 ? (unsigned char*) out32 : (unsigned char*) out16;
+	
+  // loop and cue points move with the new rate
+	double ratio = (double) sample_rate / wd->sample_rate;
+	wd->loop_start = wd->loop_start * ratio + 0.5;
+	wd->loop_end = wd->loop_end * ratio + 0.5;
+	for(unsigned int i=0; i<wd->cue_count; i++)
+		wd->cues[i].position = wd->cues[i].position * ratio + 0.5;
+	
+	free(wd->data);
+	wd->data = (unsigned char*) out;
+	wd->sound_data = (unsigned char*) out;
+	wd->sound_size = out_frames * wd->channels * width;
+	wd->sample_rate = sample_rate;
+	return 1;
+}
+
+// converts between 8 bit unsigned, 16 bit signed and 32 bit float pcm and between rates, returns 1 on success
+int wave_convert(WaveData* wd, unsigned int bps, unsigned int sample_rate, int quality) {
+	
+	if(!wave_decode(wd))
+		return 0;
+	if(bps == 0)
+		bps = wd->bps;
+	if(sample_rate == 0)
+		sample_rate = wd->sample_rate;
+	
+	if((bps != 8 && bps != 16 && bps != 32) || (wd->bps != 8 && wd->bps != 16 && wd->bps != 32) || wd->channels == 0) {
+		puts("Unsupported bit depth conversion.");
+		return 0;
+	}
+	
+  // float is resampled as float, so is anything headed for float; 8 bit
+  // goes through 16 bit, which loses nothing
+	if(sample_rate != wd->sample_rate) {
+		unsigned int work = wd->bps == 32 || bps == 32 ? 32 : 16;
+		if(!wave_convert(wd, work, 0, quality) || !wave_resample(wd, sample_rate, quality))
+			return 0;
+	}
+	if(bps == wd->bps)
+		return 1;
+	if(bps == 32)
+		return wave_float(wd);
+	if(wd->bps == 32 && !wave_s16(wd))
+		return 0;
+	if(bps == wd->bps)
+		return 1;
+	
+	size_t samples = wd->sound_size / (wd->bps / 8);
+	unsigned char* out = malloc(samples * (bps / 8) * sizeof(unsigned char));
+	if(out == 0) {
+		puts("Could not allocate memory.");
+		return 0;
+	}
+	
+	if(bps == 16) {
+		short* o = (short*) out;
+		for(size_t i=0; i<samples; i++)
+			o[i] = (short) ((wd->sound_data[i] - 128) * 256);
+	} else {
+		const short* in = (const short*) wd->sound_data;
+		for(size_t i=0; i<samples; i++)
+			out[i] = (unsigned char) ((in[i] >> 8) + 128);
+	}
+	
+	free(wd->data);
+	wd->data = out;
+	wd->sound_data = out;
+	wd->sound_size = samples * (bps / 8);
+	wd->bps = bps;
+	wd->block_align = wd->channels * (bps / 8);
+	return 1;
+}
+
+
+// scales pcm in place with clipping, adpcm has to be decoded first; float
+// is left unclipped
+int wave_gain(WaveData* wd, float gain) {
+	if(wd->format == WAVE_FORMAT_IEEE_FLOAT) {
+		float* p = (float*) wd->sound_data;
+		size_t n = wd->sound_size / sizeof(float);
+		for(size_t i=0; i<n; i++)
+			p[i] *= gain;
+		return 1;
+	}
+	if(wd->format != WAVE_FORMAT_PCM || (wd->bps != 8 && wd->bps != 16)) {
+		puts("Gain needs 8 or 16 bit pcm.");
+		return 0;
+	}
+	
+	if(wd->bps == 16) {
+		short* p = (short*) wd->sound_data;
+		size_t n = wd->sound_size / 2;
+		for(size_t i=0; i<n; i++) {
+			float s = p[i] * gain;
+			p[i] = s >= 32767 ? 32767 : s <= -32768 ? -32768 : (short) lrintf(s);
+		}
+	} else {
+		unsigned char* p = wd->sound_data;
+		for(size_t i=0; i<wd->sound_size; i++) {
+			float s = (p[i] - 128) * gain;
+			p[i] = s >= 127 ? 255 : s <= -128 ? 0 : (unsigned char) (lrintf(s) + 128);
+		}
+	}
+	return 1;
+}
+
+
+// stereo weights of each channel in wave order (front left, front right,
+// center, lfe, back left, back right, side left, side right); 3, 4, 5 and 7
+// channels leave some of those out
+static const float wave_mix[9][8][2] = {
+	[3] = {{1, 0}, {0, 1}, {0.7071f, 0.7071f}},
+	[4] = {{1, 0}, {0, 1}, {0.7071f, 0}, {0, 0.7071f}},
+	[5] = {{1, 0}, {0, 1}, {0.7071f, 0.7071f}, {0.7071f, 0}, {0, 0.7071f}},
+	[6] = {{1, 0}, {0, 1}, {0.7071f, 0.7071f}, {0, 0}, {0.7071f, 0}, {0, 0.7071f}},
+	[7] = {{1, 0}, {0, 1}, {0.7071f, 0.7071f}, {0, 0}, {0.5f, 0.5f}, {0.7071f, 0}, {0, 0.7071f}},
+	[8] = {{1, 0}, {0, 1}, {0.7071f, 0.7071f}, {0, 0}, {0.7071f, 0}, {0, 0.7071f}, {0.7071f, 0}, {0, 0.7071f}}
+};
+
+// folds more than two channels down to stereo at the same bit depth, the
+// lfe is dropped and the sum scaled so a full scale mix cannot clip
+int wave_downmix(WaveData* wd) {
+	if(wd->channels <= 2)
+		return 1;
+	if(!wave_decode(wd) || (wd->bps == 8 && !wave_convert(wd, 16, 0, 0)))
+		return 0;
+	
+	unsigned int channels = wd->channels;
+	const float (*mix)[2] = wave_mix[channels];
+	float norm = 0;
+	for(unsigned int c=0; c<channels; c++)
+		norm += mix[c][0];
+	norm = 1 / norm;
+	
+	int is_float = wd->bps == 32;
+	size_t frames = wd->sound_size / (channels * (wd->bps / 8));
+	unsigned char* out = malloc(1 * (frames ? frames : 1) * 2 * (wd->bps / 8));
+	if(out == 0) {
+		puts("Could not allocate memory.");
+		return 0;
+	}
+	
+	for(size_t i=0; i<frames; i++) {
+		float l = 0, r = 0;
+		for(unsigned int c=0; c<channels; c++) {
+			float v = is_float
+				? ((const float*) wd->sound_data)[i * channels + c]
+				: ((const short*) wd->sound_data)[i * channels + c];
+			l += v * mix[c][0];
+			r += v * mix[c][1];
+		}
+		if(is_float) {
+			((float*) out)[i * 2] = l * norm;
+			((float*) out)[i * 2 + 1] = r * norm;
+		} else {
+			((short*) out)[i * 2] = (short) lrintf(l * norm);
+			((short*) out)[i * 2 + 1] = (short) lrintf(r * norm);
+		}
+	}
+	
+	wd->channels = 2;
+	wave_replace(wd, out, frames * 2 * (wd->bps / 8), wd->bps, wd->format);
+	return 1;
 }
 
 
@@ -99,5 +504,6 @@ void wave_free(void* wd) {
 	WaveData* wavedata = (WaveData*) wd;
 	
 	free(wavedata->data);
+	free(wavedata->cues);
 	free(wavedata);
 }
@@ -24,15 +24,52 @@ SOFTWARE.
 
 #pragma once
 
+#include <stddef.h>
+
+#define WAVE_CUE_NAME 64
+
+// a cue point and its label from the LIST adtl chunk, if it has one
+typedef struct WaveCue {
+	unsigned int id;
+	unsigned int position; // in frames
+	char name[WAVE_CUE_NAME];
+} WaveCue;
+
 typedef struct WaveData {
+	unsigned int format; // WAVE_FORMAT_ tag from adpcm.h
 	unsigned int channels;
-	unsigned int bps;
+	unsigned int bps; // 32 is always float, wider integers are widened to it
 	unsigned int sample_rate;
+	unsigned int block_align;
+	unsigned int samples_per_block; // adpcm only
 	unsigned int sound_size;
 	unsigned char* data;
 	unsigned char* sound_data;
+	
+	// first loop of the smpl chunk in frames, end is exclusive and 0 when
+	// there is no loop; both follow the sound through resampling
+	unsigned int loop_start;
+	unsigned int loop_end;
+	unsigned int cue_count;
+	WaveCue* cues;
 } WaveData;
 
 WaveData* wave_load(const char* path);
 
+// parses a wave file already in memory, takes ownership of buffer
+WaveData* wave_parse(unsigned char* buffer, size_t size);
+
+// expands compressed formats into 16 bit pcm in place
+int wave_decode(WaveData* wd);
+
+// converts wd in place to bps (8, 16 or 32 for float) and sample_rate, 0
+// keeps the current value, quality is one of the RESAMPLE_ levels
+int wave_convert(WaveData* wd, unsigned int bps, unsigned int sample_rate, int quality);
+
+// scales 8 or 16 bit pcm in place, clipping at full scale, or float
+int wave_gain(WaveData* wd, float gain);
+
+// folds 3 to 8 channels down to stereo in place
+int wave_downmix(WaveData* wd);
+
 void wave_free(void* wd);